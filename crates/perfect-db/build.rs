@@ -17,9 +17,13 @@ fn build_cpp_oracle() {
     println!("cargo:rerun-if-changed=build.rs");
 
     let sources = [
+        "perfect_alloc.cpp",
         "perfect_api.cpp",
+        "perfect_async.cpp",
+        "perfect_bulk.cpp",
         "perfect_c_api.cpp",
         "perfect_common.cpp",
+        "perfect_compressed.cpp",
         "perfect_debug.cpp",
         "perfect_errors.cpp",
         "perfect_eval_elem.cpp",
@@ -27,15 +31,26 @@ fn build_cpp_oracle() {
         "perfect_game_state.cpp",
         "perfect_hash.cpp",
         "perfect_init.cpp",
+        "perfect_load_trace.cpp",
         "perfect_log.cpp",
         "perfect_move.cpp",
+        "perfect_opening.cpp",
         "perfect_player.cpp",
+        "perfect_retro.cpp",
         "perfect_rules.cpp",
+        "perfect_scan.cpp",
+        "perfect_search.cpp",
         "perfect_sec_val.cpp",
         "perfect_sector.cpp",
         "perfect_sector_graph.cpp",
+        "perfect_solve.cpp",
+        "perfect_stats.cpp",
+        "perfect_summary.cpp",
         "perfect_symmetries.cpp",
         "perfect_symmetries_slow.cpp",
+        "perfect_trace.cpp",
+        "perfect_verify.cpp",
+        "perfect_wdl_plane.cpp",
         "perfect_wrappers.cpp",
         "option.cpp",
         "rule.cpp",
@@ -60,6 +75,13 @@ fn build_cpp_oracle() {
     let mut build = cc::Build::new();
     build.cpp(true).include(&csrc).warnings(false);
 
+    // zstd.h for the .sec2z reader. zstd-sys exports its header directory
+    // when it builds the bundled library; a pkg-config zstd is expected on
+    // the system include path.
+    if let Some(root) = env::var_os("DEP_ZSTD_ROOT") {
+        build.include(PathBuf::from(root).join("include"));
+    }
+
     if cfg!(target_env = "msvc") {
         build.std("c++20");
         build.flag("/EHsc");
@@ -76,6 +98,16 @@ fn build_cpp_oracle() {
     for src in sources {
         build.file(csrc.join(src));
     }
+    if env::var_os("CARGO_FEATURE_ORACLE_BENCH").is_some() {
+        for src in ["perfect_bench.cpp", "perfect_bench_replay.cpp"] {
+            println!("cargo:rerun-if-changed={}", csrc.join(src).display());
+            build.file(csrc.join(src));
+        }
+    }
+    if env::var_os("CARGO_FEATURE_ORACLE_SOLVE").is_some() {
+        println!("cargo:rerun-if-changed={}", csrc.join("perfect_batch.cpp").display());
+        build.file(csrc.join("perfect_batch.cpp"));
+    }
 
     build.compile("perfect_db");
 
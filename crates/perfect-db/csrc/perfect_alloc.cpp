@@ -0,0 +1,301 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_alloc.cpp
+
+#include "perfect_alloc.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+enum class RegionKind { heap, thp, hugetlb };
+
+struct Region
+{
+    void *base; // what has to be handed back to munmap/free
+    size_t mapped;
+    size_t bytes;
+    RegionKind kind;
+    bool replica;
+};
+
+std::atomic<int> g_mode(static_cast<int>(LargePageMode::none));
+std::atomic<bool> g_numa_replicas(false);
+
+std::mutex g_regions_mutex;
+std::map<uintptr_t, Region> g_regions;
+uint64_t g_hugetlb_fallbacks = 0;
+
+const size_t huge_page_size = 2 * 1024 * 1024;
+
+size_t round_up(size_t x, size_t a)
+{
+    return (x + a - 1) / a * a;
+}
+
+#if defined(__linux__)
+
+void bind_to_node(void *p, size_t len, int node)
+{
+#if defined(SYS_mbind)
+    if (node < 0 || node >= 64)
+        return;
+    const int mpol_bind = 2;
+    unsigned long mask = 1UL << node;
+    syscall(SYS_mbind, p, len, mpol_bind, &mask, 64, 0);
+#endif
+}
+
+// mmap with 2 MB alignment, so that THP can back the whole range.
+void *map_aligned(size_t len, size_t &mapped, void *&base)
+{
+    size_t over = len + huge_page_size;
+    void *p = mmap(nullptr, over, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return nullptr;
+    uintptr_t start = reinterpret_cast<uintptr_t>(p);
+    uintptr_t aligned = round_up(start, huge_page_size);
+    size_t head = aligned - start;
+    size_t tail = over - head - len;
+    if (head)
+        munmap(p, head);
+    if (tail)
+        munmap(reinterpret_cast<void *>(aligned + len), tail);
+    mapped = len;
+    base = reinterpret_cast<void *>(aligned);
+    return base;
+}
+
+#endif
+
+} // namespace
+
+namespace LargeAlloc {
+
+void set_mode(LargePageMode m)
+{
+    g_mode = static_cast<int>(m);
+}
+
+LargePageMode mode()
+{
+    return static_cast<LargePageMode>(g_mode.load());
+}
+
+void set_numa_replicas(bool enable)
+{
+    g_numa_replicas = enable;
+}
+
+bool numa_replicas_enabled()
+{
+    return g_numa_replicas && numa_node_count() > 1;
+}
+
+namespace {
+
+int read_numa_node_count()
+{
+    int n = 1;
+#if defined(__linux__)
+    // The format is a list of ranges, e.g. "0-1" or "0,2-3".
+    FILE *f = fopen("/sys/devices/system/node/online", "r");
+    if (f) {
+        int a, b;
+        char sep;
+        while (fscanf(f, "%d", &a) == 1) {
+            b = a;
+            if (fscanf(f, "%c", &sep) == 1 && sep == '-') {
+                if (fscanf(f, "%d", &b) != 1)
+                    break;
+                if (fscanf(f, "%c", &sep) != 1)
+                    sep = '\n';
+            }
+            if (b + 1 > n)
+                n = b + 1;
+            if (sep != ',')
+                break;
+        }
+        fclose(f);
+    }
+#endif
+    return n;
+}
+
+} // namespace
+
+int numa_node_count()
+{
+    static const int nodes = read_numa_node_count();
+    return nodes;
+}
+
+int current_numa_node()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+    // Threads rarely migrate between nodes, so only re-query occasionally.
+    thread_local int node = -1;
+    thread_local unsigned calls = 0;
+    if (node < 0 || (++calls & 4095) == 0) {
+        unsigned cpu = 0, n = 0;
+        node = syscall(SYS_getcpu, &cpu, &n, nullptr) == 0 ? (int)n : 0;
+    }
+    return node;
+#else
+    return 0;
+#endif
+}
+
+void *allocate(size_t bytes, int node)
+{
+    if (bytes == 0)
+        return nullptr;
+
+    Region r {nullptr, 0, bytes, RegionKind::heap, node > 0};
+    void *p = nullptr;
+
+#if defined(__linux__)
+    LargePageMode m = mode();
+    if (m == LargePageMode::hugetlb) {
+        size_t len = round_up(bytes, huge_page_size);
+        void *q = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (q != MAP_FAILED) {
+            p = r.base = q;
+            r.mapped = len;
+            r.kind = RegionKind::hugetlb;
+        } else {
+            std::lock_guard<std::mutex> lock(g_regions_mutex);
+            g_hugetlb_fallbacks++;
+        }
+    }
+    // Memory bound to a node has to be mapped, as mbind needs whole pages.
+    if (!p && (m != LargePageMode::none || node >= 0)) {
+        p = map_aligned(round_up(bytes, huge_page_size), r.mapped, r.base);
+        if (p && m == LargePageMode::none) {
+            r.kind = RegionKind::heap;
+        } else if (p) {
+            r.kind = RegionKind::thp;
+#if defined(MADV_HUGEPAGE)
+            if (madvise(p, r.mapped, MADV_HUGEPAGE) != 0)
+                r.kind = RegionKind::heap;
+#else
+            r.kind = RegionKind::heap;
+#endif
+        }
+    }
+    if (p && node >= 0)
+        bind_to_node(p, r.mapped, node);
+#endif
+
+    if (!p) {
+        p = r.base = std::calloc(bytes, 1);
+        r.mapped = 0;
+        r.kind = RegionKind::heap;
+        if (!p)
+            return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(g_regions_mutex);
+    g_regions[reinterpret_cast<uintptr_t>(p)] = r;
+    return p;
+}
+
+void release(void *p, size_t bytes)
+{
+    if (!p)
+        return;
+
+    Region r;
+    {
+        std::lock_guard<std::mutex> lock(g_regions_mutex);
+        auto it = g_regions.find(reinterpret_cast<uintptr_t>(p));
+        if (it == g_regions.end())
+            return;
+        r = it->second;
+        g_regions.erase(it);
+    }
+
+#if defined(__linux__)
+    if (r.mapped) {
+        munmap(r.base, r.mapped);
+        return;
+    }
+#endif
+    std::free(r.base);
+}
+
+#if defined(__linux__)
+// Sums AnonHugePages of the mappings that overlap our THP regions.
+static uint64_t thp_backed_bytes(const std::map<uintptr_t, Region> &regions)
+{
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f)
+        return 0;
+
+    uint64_t total = 0;
+    uintptr_t lo = 0, hi = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long a, b, kb;
+        if (sscanf(line, "%lx-%lx ", &a, &b) == 2) {
+            lo = a;
+            hi = b;
+        } else if (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1 && kb) {
+            uint64_t overlap = 0;
+            for (const auto &it : regions) {
+                const Region &r = it.second;
+                if (r.kind != RegionKind::thp)
+                    continue;
+                uintptr_t s = reinterpret_cast<uintptr_t>(r.base);
+                uintptr_t e = s + r.mapped;
+                if (s < hi && lo < e)
+                    overlap += (e < hi ? e : hi) - (s > lo ? s : lo);
+            }
+            total += overlap < kb * 1024 ? overlap : kb * 1024;
+        }
+    }
+    fclose(f);
+    return total;
+}
+#endif
+
+void get_stats(LargeAllocStats *out)
+{
+    if (!out)
+        return;
+
+    std::lock_guard<std::mutex> lock(g_regions_mutex);
+    *out = LargeAllocStats {};
+    for (const auto &it : g_regions) {
+        const Region &r = it.second;
+        out->allocations++;
+        out->bytes += r.bytes;
+        if (r.kind == RegionKind::hugetlb)
+            out->hugetlb_bytes += r.bytes;
+        else if (r.kind == RegionKind::thp)
+            out->thp_bytes += r.bytes;
+        if (r.replica)
+            out->numa_replicas++;
+    }
+    out->hugetlb_fallbacks = g_hugetlb_fallbacks;
+    out->numa_nodes = numa_node_count();
+#if defined(__linux__)
+    if (out->thp_bytes)
+        out->thp_backed_bytes = thp_backed_bytes(g_regions);
+#endif
+}
+
+} // namespace LargeAlloc
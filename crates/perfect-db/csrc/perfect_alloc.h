@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_alloc.h
+//
+// Allocation layer for the large, randomly accessed lookup tables of the
+// oracle (the f/g tables of Hash). Lookups into these tables are dominated by
+// TLB misses when they sit on ordinary 4 KB pages, so they can optionally be
+// placed on transparent or explicit huge pages, and replicated per NUMA node.
+
+#ifndef PERFECT_ALLOC_H_INCLUDED
+#define PERFECT_ALLOC_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+enum class LargePageMode {
+    none = 0,        // plain heap memory (historical behaviour)
+    transparent = 1, // mmap + madvise(MADV_HUGEPAGE)
+    hugetlb = 2      // mmap(MAP_HUGETLB), falls back to transparent
+};
+
+struct LargeAllocStats
+{
+    uint64_t allocations;     // live allocations
+    uint64_t bytes;           // live bytes handed out
+    uint64_t hugetlb_bytes;   // live bytes backed by MAP_HUGETLB pages
+    uint64_t thp_bytes;       // live bytes advised with MADV_HUGEPAGE
+    uint64_t thp_backed_bytes; // of those, bytes the kernel actually backs
+                               // with huge pages (from /proc/self/smaps)
+    uint64_t hugetlb_fallbacks; // MAP_HUGETLB requests that had to fall back
+    uint64_t numa_replicas;   // live replicas beyond the primary copy
+    int numa_nodes;
+};
+
+namespace LargeAlloc {
+
+// These only affect allocations made after the call.
+void set_mode(LargePageMode m);
+LargePageMode mode();
+void set_numa_replicas(bool enable);
+bool numa_replicas_enabled();
+
+int numa_node_count();
+// NUMA node of the calling thread (0 if unknown). Cached per thread.
+int current_numa_node();
+
+// Returns zero-filled memory, or nullptr. node >= 0 binds the pages to that
+// NUMA node where the platform supports it.
+void *allocate(size_t bytes, int node = -1);
+void release(void *p, size_t bytes);
+
+void get_stats(LargeAllocStats *out);
+
+} // namespace LargeAlloc
+
+// A fixed-size array allocated through LargeAlloc. Filled through data(),
+// then publish() copies it to one replica per NUMA node (if enabled), after
+// which local() returns the copy closest to the calling thread.
+template <class T>
+class LargeArray
+{
+    static const int max_replicas = 8;
+
+    T *replicas[max_replicas] {nullptr};
+    int replica_count {0};
+    size_t n {0};
+
+public:
+    LargeArray() { }
+    LargeArray(const LargeArray &) = delete;
+    LargeArray &operator=(const LargeArray &) = delete;
+    ~LargeArray() { reset(); }
+
+    bool allocate(size_t count)
+    {
+        reset();
+        n = count;
+        replicas[0] = static_cast<T *>(LargeAlloc::allocate(n * sizeof(T)));
+        replica_count = replicas[0] ? 1 : 0;
+        return replicas[0] != nullptr;
+    }
+
+    void publish()
+    {
+        if (!replicas[0] || !LargeAlloc::numa_replicas_enabled())
+            return;
+        // The array was filled wherever the building thread ran, so the
+        // copy of node 0 is made like the others and replaces it.
+        T *copies[max_replicas] {nullptr};
+        int count = 0;
+        int nodes = LargeAlloc::numa_node_count();
+        for (int node = 0; node < nodes && node < max_replicas; node++) {
+            T *r = static_cast<T *>(LargeAlloc::allocate(n * sizeof(T), node));
+            if (!r)
+                break;
+            std::memcpy(r, replicas[0], n * sizeof(T));
+            copies[count++] = r;
+        }
+        if (count == 0)
+            return;
+        LargeAlloc::release(replicas[0], n * sizeof(T));
+        for (int i = 0; i < count; i++)
+            replicas[i] = copies[i];
+        replica_count = count;
+    }
+
+    void reset()
+    {
+        for (int i = 0; i < replica_count; i++)
+            LargeAlloc::release(replicas[i], n * sizeof(T));
+        for (int i = 0; i < max_replicas; i++)
+            replicas[i] = nullptr;
+        replica_count = 0;
+        n = 0;
+    }
+
+    T *data() const { return replicas[0]; }
+
+    const T *local() const
+    {
+        if (replica_count <= 1)
+            return replicas[0];
+        int node = LargeAlloc::current_numa_node();
+        return node < replica_count ? replicas[node] : replicas[0];
+    }
+
+    size_t size() const { return n; }
+    size_t bytes() const { return n * sizeof(T) * replica_count; }
+
+    T &operator[](size_t i) { return replicas[0][i]; }
+    const T &operator[](size_t i) const { return replicas[0][i]; }
+};
+
+#endif // PERFECT_ALLOC_H_INCLUDED
@@ -6,12 +6,21 @@
 
 #include "perfect_api.h"
 #include "option.h"
+#include "perfect_bulk.h"
 #include "perfect_errors.h"
 #include "perfect_game_state.h"
 #include "perfect_player.h"
 #include "perfect_init.h"
+#include "perfect_opening.h"
+#include "perfect_search.h"
+#include "perfect_solve.h"
+#include "perfect_stats.h"
 
+#include "perfect_hash.h"
+
+#include <algorithm>
 #include <cctype>
+#include <random>
 #include <string>
 #include <regex>
 #include <mutex>
@@ -36,10 +45,12 @@ int MalomSolutionAccess::get_best_move(int whiteBitboard, int blackBitboard,
                                        int whiteStonesToPlace,
                                        int blackStonesToPlace, int playerToMove,
                                        bool onlyStoneTaking, Value &value,
-                                       const Move &refMove)
+                                       const Move &refMove, bool *exact)
 {
     using namespace PerfectErrors;
-    std::lock_guard<std::recursive_mutex> lock(g_pd_mutex);
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    Stats::add(Stat::best_move_calls);
 
     clearError();
 
@@ -47,18 +58,28 @@ int MalomSolutionAccess::get_best_move(int whiteBitboard, int blackBitboard,
         return 0; // Error already set by initialize_if_needed
     }
 
-    GameState s;
-    const int W = 0;
-    const int B = 1;
-
     // Check for bitboard overlap
     if ((whiteBitboard & blackBitboard) != 0) {
-        SET_ERROR_AND_RETURN(PE_INVALID_ARGUMENT,
-                             "whiteBitboard and blackBitboard shouldn't have "
-                             "any overlap",
-                             0);
+        SET_STATIC_ERROR(PE_INVALID_ARGUMENT,
+                         "whiteBitboard and blackBitboard shouldn't have "
+                         "any overlap");
+        return 0;
     }
 
+    // Range checks using error system (before the GameState, so that a
+    // rejected query allocates nothing)
+    if (!CHECK_RANGE("whiteStonesToPlace", whiteStonesToPlace, 0,
+                     Rules::maxKSZ) ||
+        !CHECK_RANGE("blackStonesToPlace", blackStonesToPlace, 0,
+                     Rules::maxKSZ) ||
+        !CHECK_RANGE("playerToMove", playerToMove, 0, 1)) {
+        return 0; // Error already set by CHECK_RANGE
+    }
+
+    GameState s;
+    const int W = 0;
+    const int B = 1;
+
     // Set up board state
     for (int i = 0; i < 24; i++) {
         if ((whiteBitboard & (1 << i)) != 0) {
@@ -73,15 +94,6 @@ int MalomSolutionAccess::get_best_move(int whiteBitboard, int blackBitboard,
 
     s.phase = ((whiteStonesToPlace == 0 && blackStonesToPlace == 0) ? 2 : 1);
 
-    // Range checks using error system
-    if (!checkRange("whiteStonesToPlace", whiteStonesToPlace, 0,
-                    Rules::maxKSZ) ||
-        !checkRange("blackStonesToPlace", blackStonesToPlace, 0,
-                    Rules::maxKSZ) ||
-        !checkRange("playerToMove", playerToMove, 0, 1)) {
-        return 0; // Error already set by checkRange
-    }
-
     s.setStoneCount[W] = Rules::maxKSZ - whiteStonesToPlace;
     s.setStoneCount[B] = Rules::maxKSZ - blackStonesToPlace;
     s.kle = onlyStoneTaking;
@@ -90,33 +102,34 @@ int MalomSolutionAccess::get_best_move(int whiteBitboard, int blackBitboard,
 
     // Validate stone counts
     if (s.get_future_piece_count(W) > Rules::maxKSZ) {
-        SET_ERROR_AND_RETURN(PE_INVALID_ARGUMENT,
-                             "Number of stones in whiteBitboard + "
-                             "whiteStonesToPlace > " +
-                                 std::to_string(Rules::maxKSZ),
-                             0);
+        SET_ERROR_VALUES(PE_INVALID_ARGUMENT,
+                         "Number of stones in whiteBitboard + "
+                         "whiteStonesToPlace > %lld",
+                         Rules::maxKSZ);
+        return 0;
     }
     if (s.get_future_piece_count(B) > Rules::maxKSZ) {
-        SET_ERROR_AND_RETURN(PE_INVALID_ARGUMENT,
-                             "Number of stones in blackBitboard + "
-                             "blackStonesToPlace > " +
-                                 std::to_string(Rules::maxKSZ),
-                             0);
+        SET_ERROR_VALUES(PE_INVALID_ARGUMENT,
+                         "Number of stones in blackBitboard + "
+                         "blackStonesToPlace > %lld",
+                         Rules::maxKSZ);
+        return 0;
     }
 
     // Check game state validity
-    std::string errorMsg = s.set_over_and_check_valid_setup();
-    if (errorMsg != "") {
-        SET_ERROR_AND_RETURN(PE_INVALID_ARGUMENT, errorMsg, 0);
+    if (const char *reason = s.set_over_and_check_valid_setup()) {
+        setStaticError(PE_INVALID_ARGUMENT, reason, __FILE__, __LINE__);
+        return 0;
     }
     if (s.over) {
-        SET_ERROR_AND_RETURN(PE_GAME_OVER, "Game is already over.", 0);
+        SET_STATIC_ERROR(PE_GAME_OVER, "Game is already over.");
+        return 0;
     }
 
     s.lastIrrev = 0;
 
     // Get the best move - this may fail if database entry not found
-    int ret = get_move_from_database(s, value, refMove);
+    int ret = get_move_from_database(s, value, refMove, exact);
     if (ret == 0 && hasError()) {
         return 0; // Error already set by get_move_from_database
     }
@@ -128,7 +141,7 @@ int MalomSolutionAccess::get_best_move(int whiteBitboard, int blackBitboard,
     // PROBLEM: The original design called deinitialize_if_needed() after every
     // get_best_move() call, which causes severe thread safety issues:
     // - In multi-threaded benchmark, one thread calls deinitialize_if_needed()
-    // - This deletes perfectPlayer and calls Rules::cleanup_rules()
+    // - This deletes perfectPlayer
     // - Other threads are still using these resources, causing memory
     // corruption
     //
@@ -164,7 +177,8 @@ int MalomSolutionAccess::get_best_move(int whiteBitboard, int blackBitboard,
 bool MalomSolutionAccess::initialize_if_needed()
 {
     using namespace PerfectErrors;
-    std::lock_guard<std::recursive_mutex> lock(g_pd_mutex);
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
 
     // Fast path: if already initialized, return immediately
     if (perfectPlayer != nullptr) {
@@ -180,7 +194,6 @@ bool MalomSolutionAccess::initialize_if_needed()
 
         perfect_init();
         secValPath = gameOptions.getPerfectDatabasePath();
-        Rules::init_rules();
         set_variant_stripped();
 
         if (!Sectors::has_database()) {
@@ -226,7 +239,8 @@ bool MalomSolutionAccess::initialize_if_needed()
 bool MalomSolutionAccess::initialize_if_needed()
 {
     using namespace PerfectErrors;
-    std::lock_guard<std::recursive_mutex> lock(g_pd_mutex);
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
 
     if (perfectPlayer != nullptr) {
         return true;
@@ -234,7 +248,6 @@ bool MalomSolutionAccess::initialize_if_needed()
 
     perfect_init();
     secValPath = gameOptions.getPerfectDatabasePath();
-    Rules::init_rules();
     set_variant_stripped();
 
     if (!Sectors::has_database()) {
@@ -266,22 +279,46 @@ bool MalomSolutionAccess::initialize_if_needed()
 // Helper function to get move from database without exceptions
 int MalomSolutionAccess::get_move_from_database(const GameState &s,
                                                 Value &value,
-                                                const Move &refMove)
+                                                const Move &refMove,
+                                                bool *exact)
 {
     using namespace PerfectErrors;
-    std::lock_guard<std::recursive_mutex> lock(g_pd_mutex);
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
 
+    if (exact)
+        *exact = true;
     if (perfectPlayer == nullptr) {
-        SET_ERROR_CODE(PE_RUNTIME_ERROR, "Perfect player not initialized");
+        SET_STATIC_ERROR(PE_RUNTIME_ERROR, "Perfect player not initialized");
         return 0;
     }
 
-    // Get good moves from database - no exceptions expected
-    std::vector<AdvancedMove> goodMoves = perfectPlayer->get_good_moves(s,
-                                                                        value);
+    // Early placement positions come from the opening table
+    // (perfect_opening.h) without touching the sectors.
+    std::vector<AdvancedMove> goodMoves;
+    if (!OpeningTable::lookup(*perfectPlayer, s, goodMoves, value)) {
+        goodMoves = perfectPlayer->get_good_moves(s, value);
+    }
+
+    // Missing sectors (those the solver of perfect_solve.h cannot solve
+    // included): search down to the ones that are present
+    // (perfect_search.h). Any other error, or a missing sector without the
+    // search, leaves goodMoves incomplete.
+    if (hasError()) {
+        if (getLastErrorCode() != PE_DATABASE_NOT_FOUND ||
+            !DbSearch::enabled())
+            return 0;
+        clearError();
+        bool searched_exact;
+        if (!DbSearch::best_moves(*perfectPlayer, s, goodMoves, value,
+                                  searched_exact))
+            return 0;
+        if (exact)
+            *exact = searched_exact;
+    }
 
     if (goodMoves.empty()) {
-        SET_ERROR_CODE(PE_RUNTIME_ERROR, "No good moves found in database");
+        SET_STATIC_ERROR(PE_RUNTIME_ERROR, "No good moves found in database");
         return 0;
     }
 
@@ -297,10 +334,11 @@ PerfectEvaluation
 MalomSolutionAccess::get_detailed_evaluation(const GameState &gameState)
 {
     using namespace PerfectErrors;
-    std::lock_guard<std::recursive_mutex> lock(g_pd_mutex);
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
 
     if (perfectPlayer == nullptr) {
-        SET_ERROR_CODE(PE_RUNTIME_ERROR, "Perfect player not initialized");
+        SET_STATIC_ERROR(PE_RUNTIME_ERROR, "Perfect player not initialized");
         return PerfectEvaluation(); // Invalid result
     }
 
@@ -385,91 +423,38 @@ MalomSolutionAccess::get_detailed_evaluation(const GameState &gameState)
 
 void MalomSolutionAccess::deinitialize_if_needed()
 {
-    std::lock_guard<std::recursive_mutex> lock(g_pd_mutex);
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
 
     if (perfectPlayer == nullptr) {
         return;
     }
 
-    Rules::cleanup_rules();
-
     delete perfectPlayer;
 
     perfectPlayer = nullptr;
+    OpeningTable::reset();
 }
 
 void MalomSolutionAccess::set_variant_stripped()
 {
-    switch (ruleVariant) {
-    case (int)Wrappers::Constants::Variants::std:
-        std::memcpy(Rules::millPos, Rules::stdLaskerMillPos,
-                    sizeof(Rules::stdLaskerMillPos));
-        std::memcpy(Rules::invMillPos, Rules::stdLaskerInvMillPos,
-                    sizeof(Rules::stdLaskerInvMillPos));
-        std::memcpy(Rules::boardGraph, Rules::stdLaskerBoardGraph,
-                    sizeof(Rules::stdLaskerBoardGraph));
-        std::memcpy(Rules::aLBoardGraph, Rules::stdLaskerALBoardGraph,
-                    sizeof(Rules::stdLaskerALBoardGraph));
-        Rules::maxKSZ = 9;
-        Rules::variantName = "std";
-        break;
-    case (int)Wrappers::Constants::Variants::lask:
-        std::memcpy(Rules::millPos, Rules::stdLaskerMillPos,
-                    sizeof(Rules::stdLaskerMillPos));
-        std::memcpy(Rules::invMillPos, Rules::stdLaskerInvMillPos,
-                    sizeof(Rules::stdLaskerInvMillPos));
-        std::memcpy(Rules::boardGraph, Rules::stdLaskerBoardGraph,
-                    sizeof(Rules::stdLaskerBoardGraph));
-        std::memcpy(Rules::aLBoardGraph, Rules::stdLaskerALBoardGraph,
-                    sizeof(Rules::stdLaskerALBoardGraph));
-        Rules::maxKSZ = 10;
-        Rules::variantName = "lask";
-        break;
-    case (int)Wrappers::Constants::Variants::mora:
-        std::memcpy(Rules::millPos, Rules::moraMillPos,
-                    sizeof(Rules::moraMillPos));
-        std::memcpy(Rules::invMillPos, Rules::moraInvMillPos,
-                    sizeof(Rules::moraInvMillPos));
-        std::memcpy(Rules::boardGraph, Rules::moraBoardGraph,
-                    sizeof(Rules::moraBoardGraph));
-        std::memcpy(Rules::aLBoardGraph, Rules::moraALBoardGraph,
-                    sizeof(Rules::moraALBoardGraph));
-        Rules::maxKSZ = 12;
-        Rules::variantName = "mora";
-        break;
-    }
-
-    if (Wrappers::Constants::extended) {
-        Rules::maxKSZ = 12;
-    }
+    Rules::set_variant();
 }
 
-PerfectEvaluation MalomSolutionAccess::get_detailed_evaluation(
-    int whiteBitboard, int blackBitboard, int whiteStonesToPlace,
-    int blackStonesToPlace, int playerToMove, bool onlyStoneTaking)
+bool MalomSolutionAccess::make_query_state(int whiteBitboard,
+                                           int blackBitboard,
+                                           int whiteStonesToPlace,
+                                           int blackStonesToPlace,
+                                           int playerToMove,
+                                           bool onlyStoneTaking,
+                                           GameState &gameState)
 {
-    using namespace PerfectErrors;
-
-    clearError(); // Clear any previous errors
-
-    // Initialize without exceptions for performance
-    if (!initialize_if_needed()) {
-        return PerfectEvaluation(); // Invalid result - error already set
-    }
-
-    if (perfectPlayer == nullptr) {
-        return PerfectEvaluation(); // Invalid result
-    }
-
-    // Create GameState for perfect database query
-    GameState gameState;
-
     const int W = 0;
     const int B = 1;
 
     // Validate input parameters
     if ((whiteBitboard & blackBitboard) != 0) {
-        return PerfectEvaluation(); // Invalid: overlapping bitboards
+        return false; // Invalid: overlapping bitboards
     }
 
     // Set up board state
@@ -495,8 +480,31 @@ PerfectEvaluation MalomSolutionAccess::get_detailed_evaluation(
     gameState.lastIrrev = 0;
 
     // Validate game state
-    std::string errorMsg = gameState.set_over_and_check_valid_setup();
-    if (errorMsg != "" || gameState.over) {
+    return !gameState.set_over_and_check_valid_setup() && !gameState.over;
+}
+
+PerfectEvaluation MalomSolutionAccess::get_detailed_evaluation(
+    int whiteBitboard, int blackBitboard, int whiteStonesToPlace,
+    int blackStonesToPlace, int playerToMove, bool onlyStoneTaking)
+{
+    using namespace PerfectErrors;
+
+    clearError(); // Clear any previous errors
+
+    // Initialize without exceptions for performance
+    if (!initialize_if_needed()) {
+        return PerfectEvaluation(); // Invalid result - error already set
+    }
+
+    if (perfectPlayer == nullptr) {
+        return PerfectEvaluation(); // Invalid result
+    }
+
+    // Create GameState for perfect database query
+    GameState gameState;
+    if (!make_query_state(whiteBitboard, blackBitboard, whiteStonesToPlace,
+                          blackStonesToPlace, playerToMove, onlyStoneTaking,
+                          gameState)) {
         return PerfectEvaluation(); // Invalid result
     }
 #if 0
@@ -526,6 +534,375 @@ PerfectEvaluation MalomSolutionAccess::get_detailed_evaluation(
     return result;
 }
 
+bool MalomSolutionAccess::get_wdl(int whiteBitboard, int blackBitboard,
+                                  int whiteStonesToPlace,
+                                  int blackStonesToPlace, int playerToMove,
+                                  bool onlyStoneTaking, int &wdl)
+{
+    using namespace PerfectErrors;
+
+    clearError();
+
+    if (!initialize_if_needed() || perfectPlayer == nullptr) {
+        return false;
+    }
+
+    GameState gameState;
+    if (!make_query_state(whiteBitboard, blackBitboard, whiteStonesToPlace,
+                          blackStonesToPlace, playerToMove, onlyStoneTaking,
+                          gameState)) {
+        return false;
+    }
+
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    return perfectPlayer->evaluate_wdl(gameState, wdl) && !hasError();
+}
+
+void MalomSolutionAccess::get_sector_residency(
+    std::vector<std::pair<Id, Sector::Residency>> &out)
+{
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    out.clear();
+    for (Sector *sec : sector_objs) {
+        Sector::Residency r = sec->residency();
+        if (r.total() > 0)
+            out.emplace_back(sec->id, r);
+    }
+}
+
+bool MalomSolutionAccess::preload_sector(const Id &id)
+{
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    if (!perfectPlayer)
+        return false;
+
+    auto iter = perfectPlayer->secs.find(Wrappers::WID(id));
+    if (iter == perfectPlayer->secs.end())
+        return false;
+
+    iter->second.preload();
+    return iter->second.s->hash != nullptr;
+}
+
+void MalomSolutionAccess::get_sector_ids(std::vector<Id> &out)
+{
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    out.clear();
+    if (!perfectPlayer)
+        return;
+    for (auto &entry : perfectPlayer->secs)
+        out.push_back(entry.second.s->id);
+}
+
+// The game-theoretic result, classified like pd_evaluate_wdl does, and the
+// step count as pd_evaluate reports it (-1 for count entries).
+static void sector_entry_wdl(Sector *sec, const eval_elem2 &e, int &wdl,
+                             int &steps)
+{
+    sec_val v = Wrappers::gui_eval_elem2(e, sec).akey1();
+    wdl = v == virt_win_val ? 1 : (v == virt_loss_val ? -1 : 0);
+    steps = e.key1 == 0 ? -1 : e.key2;
+}
+
+static bool sample_filter_matches(const SampleFilter &f, const Id &id)
+{
+    return (f.W < 0 || f.W == id.W) && (f.B < 0 || f.B == id.B) &&
+           (f.WF < 0 || f.WF == id.WF) && (f.BF < 0 || f.BF == id.BF);
+}
+
+bool MalomSolutionAccess::sample(uint64_t seed, int n,
+                                 const SampleFilter &filter,
+                                 std::vector<SampledPosition> &out)
+{
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    out.clear();
+    if (!perfectPlayer)
+        return false;
+
+    // prefix[k] is the first global index of strata[k]
+    std::vector<Wrappers::WSector *> strata;
+    std::vector<int64_t> prefix;
+    int64_t total = 0;
+    for (auto &entry : perfectPlayer->secs) {
+        Id id = entry.second.s->id;
+        if (!sample_filter_matches(filter, id))
+            continue;
+        int count = hash_count_of(id.W, id.B);
+        if (count <= 0)
+            continue;
+        strata.push_back(&entry.second);
+        prefix.push_back(total);
+        total += count;
+    }
+    if (total == 0 || n <= 0)
+        return true;
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> dist(0, total - 1);
+    int64_t budget = (int64_t)n * 64;
+
+    // Each round draws a batch and visits it sorted by index, so every
+    // sector is loaded once per round and its file is read front to back;
+    // accepted draws are then taken in draw order to stay unbiased.
+    std::vector<std::pair<int64_t, int>> draws;
+    std::vector<SampledPosition> results;
+    std::vector<char> accepted;
+    BulkSchedule::Pin pin;
+    while ((int)out.size() < n && budget > 0) {
+        int64_t m = std::min<int64_t>(
+            budget, std::max<int64_t>(2 * (n - (int64_t)out.size()), 1024));
+        m = std::min<int64_t>(m, 1 << 20);
+        budget -= m;
+
+        draws.resize(m);
+        for (int i = 0; i < m; i++)
+            draws[i] = std::make_pair(dist(rng), i);
+        std::sort(draws.begin(), draws.end());
+
+        results.resize(m);
+        accepted.assign(m, 0);
+        int k = -1;
+        Sector *sec = nullptr;
+        for (const auto &d : draws) {
+            int s = (int)(std::upper_bound(prefix.begin(), prefix.end(),
+                                           d.first) -
+                          prefix.begin()) -
+                    1;
+            if (s != k) {
+                k = s;
+                // The strata go W by W (the order of secs).
+                pin.hold(strata[k]->s->id.W);
+                sec = strata[k]->load();
+            }
+            if (!sec)
+                continue;
+
+            int index = (int)(d.first - prefix[k]);
+            eval_elem_sym2 e = sec->get_eval_inner(index);
+            if (e.cas() == eval_elem_sym2::Sym)
+                continue;
+
+            SampledPosition &p = results[d.second];
+            sector_entry_wdl(sec, eval_elem2(e), p.wdl, p.steps);
+            if (filter.wdl_mask && !(filter.wdl_mask & (1 << (p.wdl + 1))))
+                continue;
+            if (filter.max_steps >= 0 &&
+                (p.steps < filter.min_steps || p.steps > filter.max_steps))
+                continue;
+            p.id = sec->id;
+            p.b = sec->hash->inverse_hash(index);
+            accepted[d.second] = 1;
+        }
+
+        for (int i = 0; i < m && (int)out.size() < n; i++)
+            if (accepted[i])
+                out.push_back(results[i]);
+    }
+    return true;
+}
+
+bool MalomSolutionAccess::verify(const std::vector<Id> &ids, int threads,
+                                 bool retrograde, int max_issues,
+                                 DatabaseVerify::Report &report)
+{
+    std::vector<Id> all;
+    {
+        TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                                  Stat::pd_mutex_wait_ns);
+        if (!perfectPlayer)
+            return false;
+        if (ids.empty()) {
+            for (auto &entry : perfectPlayer->secs)
+                all.push_back(entry.second.s->id);
+        }
+    }
+    // Takes the lock per sector, so queries are not held up for the whole
+    // run.
+    return DatabaseVerify::run(g_pd_mutex, perfectPlayer,
+                               ids.empty() ? all : ids, threads, retrograde,
+                               max_issues, report);
+}
+
+bool MalomSolutionAccess::summarize_sector(const Id &id,
+                                           SectorSummary::Summary &out)
+{
+    return SectorSummary::get(g_pd_mutex, id, out);
+}
+
+bool MalomSolutionAccess::solve_sector(const Id &id)
+{
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    if (!perfectPlayer)
+        return false;
+    return SectorSolver::solve(*perfectPlayer, id);
+}
+
+int64_t MalomSolutionAccess::build_opening_table(int plies,
+                                                 const std::string &path)
+{
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    if (!perfectPlayer)
+        return -1;
+    return OpeningTable::generate(*perfectPlayer, plies, path);
+}
+
+bool MalomSolutionAccess::principal_variation(
+    int whiteBitboard, int blackBitboard, int whiteStonesToPlace,
+    int blackStonesToPlace, int playerToMove, bool onlyStoneTaking,
+    int max_plies, std::vector<PvPly> &line)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!initialize_if_needed() || perfectPlayer == nullptr) {
+        return false;
+    }
+
+    GameState s;
+    if (!make_query_state(whiteBitboard, blackBitboard, whiteStonesToPlace,
+                          blackStonesToPlace, playerToMove, onlyStoneTaking,
+                          s)) {
+        SET_STATIC_ERROR(PE_INVALID_ARGUMENT, "Invalid position");
+        return false;
+    }
+
+    // One lock for the whole line; the sectors it walks through stay loaded
+    // in the hash cache from one ply to the next.
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    for (int ply = 0; ply < max_plies && !s.over; ply++) {
+        PvPly p {};
+        for (int i = 0; i < 24; i++) {
+            if (s.board[i] == 0)
+                p.whiteBits |= 1 << i;
+            else if (s.board[i] == 1)
+                p.blackBits |= 1 << i;
+        }
+        p.sideToMove = s.sideToMove;
+
+        std::vector<AdvancedMove> moves = perfectPlayer->get_move_list(s);
+        if (moves.empty()) {
+            break;
+        }
+        size_t best = 0;
+        Wrappers::gui_eval_elem2 bestValue = perfectPlayer->move_value(
+            s, moves[0]);
+        for (size_t i = 1; i < moves.size() && !hasError(); i++) {
+            Wrappers::gui_eval_elem2 v = perfectPlayer->move_value(s,
+                                                                   moves[i]);
+            if (v > bestValue) {
+                bestValue = v;
+                best = i;
+            }
+        }
+        if (hasError()) {
+            return false;
+        }
+
+        // The value of the position is that of its best move, which is
+        // defined in stone-removal positions as well.
+        const sec_val v = bestValue.akey1();
+        p.wdl = v == virt_win_val ? 1 : (v == virt_loss_val ? -1 : 0);
+        p.steps = p.wdl != 0 ? bestValue.keys().key2 : -1;
+        p.move = moves[best].toBitBoard();
+        line.push_back(p);
+        s = perfectPlayer->make_move_in_state(s, moves[best]);
+        if (hasError()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int MalomSolutionAccess::canonical_index(const std::vector<GameState> &states,
+                                         std::vector<CanonicalIndex> &out)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!initialize_if_needed() || perfectPlayer == nullptr) {
+        return -1;
+    }
+
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    out.assign(states.size(), CanonicalIndex());
+
+    // The sector of each state, as get_sector finds it, to visit the states
+    // in the order of the sectors (W first).
+    std::vector<std::pair<Id, size_t>> order;
+    order.reserve(states.size());
+    for (size_t i = 0; i < states.size(); i++) {
+        const GameState &s = states[i];
+        Id id(s.stoneCount[0], s.stoneCount[1],
+              Rules::maxKSZ - s.setStoneCount[0],
+              Rules::maxKSZ - s.setStoneCount[1]);
+        if (s.sideToMove == 1)
+            id.negate_id();
+        order.emplace_back(id, i);
+    }
+    std::sort(order.begin(), order.end());
+
+    int resolved = 0;
+    BulkSchedule::Pin pin;
+    for (const auto &o : order) {
+        pin.hold(o.first.W);
+        CanonicalIndex &c = out[o.second];
+        if (perfectPlayer->canonical_index(states[o.second], c.id, c.index,
+                                           c.op)) {
+            resolved++;
+            continue;
+        }
+        c = CanonicalIndex();
+        clearError();
+    }
+    return resolved;
+}
+
+void MalomSolutionAccess::set_hash_cache_capacity(int sectors)
+{
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    Wrappers::set_hash_cache_capacity(sectors);
+}
+
+Sector *MalomSolutionAccess::open_sector(const Id &id)
+{
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    Sector *sector = sectors(id);
+    if (!sector) {
+        sector = new Sector(id);
+        sectors(id) = sector;
+    }
+
+    // Ensure hash and evals are loaded
+    if (!sector->hash || !sector->evals_loaded) {
+        sector->allocate_hash();
+    }
+
+    if (!sector->hash || !sector->hash->is_initialized()) {
+        return nullptr;
+    }
+
+    sector->pins++;
+    return sector;
+}
+
+void MalomSolutionAccess::close_sector(Sector *sector)
+{
+    TimedLockGuard<std::recursive_mutex> lock(g_pd_mutex,
+                                              Stat::pd_mutex_wait_ns);
+    sector->pins--;
+}
+
 #if 0 // Position-based API removed with legacy C++ engine; use pd_* C API.
 namespace PerfectAPI {
 Value getValue(const Position &pos)
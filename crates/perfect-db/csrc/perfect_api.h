@@ -8,6 +8,8 @@
 #define PERFECT_MALOM_SOLUTION_H_INCLUDED
 
 #include "perfect_player.h"
+#include "perfect_summary.h"
+#include "perfect_verify.h"
 #include "types.h"
 
 // Forward declarations
@@ -33,34 +35,164 @@ struct PerfectEvaluation
     { }
 };
 
+// Restricts MalomSolutionAccess::sample. Negative sector fields match any
+// sector; wdl_mask has bit 0 for losses, 1 for draws, 2 for wins (0 = all).
+struct SampleFilter
+{
+    int W {-1}, B {-1}, WF {-1}, BF {-1};
+    int wdl_mask {0};
+    int min_steps {0};
+    int max_steps {-1}; // < 0: no steps filter
+};
+
+struct SampledPosition
+{
+    Id id;   // the sector; its white stones are the side to move
+    board b; // as Hash::inverse_hash returns it
+    int wdl;
+    int steps;
+};
+
+// A ply of MalomSolutionAccess::principal_variation: the position before
+// the move, its game-theoretic value (1, 0 or -1 for the side to move) with
+// the plies to the result (-1 for draws), and the move, as get_best_move
+// returns it.
+struct PvPly
+{
+    int whiteBits, blackBits, sideToMove;
+    int wdl, steps;
+    int move;
+};
+
+// A position as MalomSolutionAccess::canonical_index resolves it: its
+// sector, the index of its entry (-1 if it has none) and the symmetry op
+// taking its board, in the frame of the sector, to the board of the entry.
+struct CanonicalIndex
+{
+    Id id;
+    int index {-1};
+    int op {-1};
+};
+
 class MalomSolutionAccess
 {
 private:
     static PerfectPlayer *perfectPlayer;
 
 public:
-    // Error-code based implementation (no exceptions for performance)
+    // Error-code based implementation (no exceptions for performance).
+    // exact, if given, is set to whether the move is proven by the database:
+    // false only when the search fallback (perfect_search.h) had to estimate.
     static int get_best_move(int whiteBitboard, int blackBitboard,
                              int whiteStonesToPlace, int blackStonesToPlace,
                              int playerToMove, bool onlyStoneTaking,
-                             Value &value, const Move &refMove);
+                             Value &value, const Move &refMove,
+                             bool *exact = nullptr);
 
     static void deinitialize_if_needed();
 
     // Error-code based helper functions
     static bool initialize_if_needed();
     static int get_move_from_database(const GameState &s, Value &value,
-                                      const Move &refMove);
+                                      const Move &refMove,
+                                      bool *exact = nullptr);
     static PerfectEvaluation
     get_detailed_evaluation(const GameState &gameState);
 
     static void set_variant_stripped();
 
+    // Builds the GameState of a pd_* style query. Returns false for
+    // overlapping bitboards and finished or invalid positions.
+    static bool make_query_state(int whiteBitboard, int blackBitboard,
+                                 int whiteStonesToPlace, int blackStonesToPlace,
+                                 int playerToMove, bool onlyStoneTaking,
+                                 GameState &gameState);
+
     // Method to get detailed evaluation information
     static PerfectEvaluation
     get_detailed_evaluation(int whiteBitboard, int blackBitboard,
                             int whiteStonesToPlace, int blackStonesToPlace,
                             int playerToMove, bool onlyStoneTaking);
+
+    // Game-theoretic win/draw/loss only (see pd_evaluate_wdl). Reads the
+    // sector's .wdl2 plane when there is one.
+    static bool get_wdl(int whiteBitboard, int blackBitboard,
+                        int whiteStonesToPlace, int blackStonesToPlace,
+                        int playerToMove, bool onlyStoneTaking, int &wdl);
+
+    // Memory held by every sector that currently has something loaded.
+    static void get_sector_residency(
+        std::vector<std::pair<Id, Sector::Residency>> &out);
+
+    // Builds the hash tables of a sector and prefetches its file, as a
+    // first lookup would. Returns false if the sector is not in the database
+    // or could not be loaded.
+    static bool preload_sector(const Id &id);
+
+    // The sectors of the database.
+    static void get_sector_ids(std::vector<Id> &out);
+
+    // Draws up to n positions uniformly (with replacement) from the sectors
+    // that pass the filter, weighting each sector by its hash_count, without
+    // enumerating any sector. Symmetric redirect entries and entries that
+    // fail the WDL/steps filter are redrawn, up to a budget of 64 draws per
+    // requested position. Returns false if the database is not initialized.
+    static bool sample(uint64_t seed, int n, const SampleFilter &filter,
+                       std::vector<SampledPosition> &out);
+
+    // Runs the integrity checks of perfect_verify.h on the given sectors (all
+    // of them if ids is empty). Queries wait while the retrograde pass
+    // checks a sector and run between the sectors. Returns false if the
+    // database is not initialized.
+    static bool verify(const std::vector<Id> &ids, int threads,
+                       bool retrograde, int max_issues,
+                       DatabaseVerify::Report &report);
+
+    // The statistics of perfect_summary.h for a sector, computed without
+    // holding up the queries. Returns false, with an error set, if the
+    // sector file is missing or damaged.
+    static bool summarize_sector(const Id &id, SectorSummary::Summary &out);
+
+    // Makes the sector available, solving it if it is missing from the
+    // database (see perfect_solve.h). Queries wait while it runs. Returns
+    // false, with an error set, if it cannot be solved or the database is
+    // not initialized.
+    static bool solve_sector(const Id &id);
+
+    // Writes the opening table of perfect_opening.h for the positions
+    // reached in fewer than plies plies. Queries wait while it runs. Returns
+    // the number of positions, or -1 (with an error set unless the database
+    // is not initialized).
+    static int64_t build_opening_table(int plies, const std::string &path);
+
+    // The perfect-play line from a pd_* style query, up to max_plies plies:
+    // at every ply the best move by gui_eval_elem2::compare (the quickest
+    // win, the slowest loss), the first in move order among equals, so that
+    // the line is reproducible. It ends early when the game is over. Returns
+    // false, with an error set, for an invalid position or a failed lookup.
+    static bool principal_variation(int whiteBitboard, int blackBitboard,
+                                    int whiteStonesToPlace,
+                                    int blackStonesToPlace, int playerToMove,
+                                    bool onlyStoneTaking, int max_plies,
+                                    std::vector<PvPly> &line);
+
+    // The entries of states (see PerfectPlayer::canonical_index), without
+    // reading any sector file; symmetric positions get the same sector and
+    // index. The states are taken sector by sector, W by W, so that the hash
+    // tables are built once per batch. A state without an entry (a
+    // stone-removal position, a missing sector) gets index -1. Returns the
+    // number of states resolved, or -1 if the database is not initialized.
+    static int canonical_index(const std::vector<GameState> &states,
+                               std::vector<CanonicalIndex> &out);
+
+    // Wrappers::set_hash_cache_capacity, waiting for the queries in flight.
+    static void set_hash_cache_capacity(int sectors);
+
+    // The sector with its hash and evals loaded and pinned (see
+    // Sector::pins), for pd_open_sector; nullptr if it cannot be loaded.
+    // close_sector lets it go again.
+    static Sector *open_sector(const Id &id);
+    static void close_sector(Sector *sector);
 };
 
 #if 0 // Position-based API removed with legacy C++ engine; use pd_* C API.
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_async.cpp
+
+#include "perfect_async.h"
+#include "perfect_errors.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PdAsync {
+
+namespace {
+
+struct Pending
+{
+    pd_query query;
+    long long tag;
+};
+
+std::mutex g_mutex;
+std::condition_variable g_cv;
+std::deque<Pending> g_queue;
+std::deque<pd_completion> g_done;
+int g_worker_count = 1;
+bool g_stopping = false;
+pd_completion_callback g_callback = nullptr;
+void *g_callback_user = nullptr;
+
+pd_completion make_completion(long long tag, int status)
+{
+    pd_completion c;
+    memset(&c, 0, sizeof(c));
+    c.tag = tag;
+    c.status = status;
+    c.steps = -1;
+    return c;
+}
+
+void deliver(const pd_completion &c)
+{
+    pd_completion_callback callback;
+    void *user;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        callback = g_callback;
+        user = g_callback_user;
+        if (!callback) {
+            g_done.push_back(c);
+            return;
+        }
+    }
+    callback(&c, user);
+}
+
+pd_completion run(const Pending &p)
+{
+    const pd_query &q = p.query;
+    pd_completion c = make_completion(p.tag, 0);
+    switch (q.kind) {
+    case 0:
+        c.status = pd_evaluate(q.whiteBits, q.blackBits, q.whiteStonesToPlace,
+                               q.blackStonesToPlace, q.playerToMove,
+                               q.onlyStoneTaking, &c.wdl, &c.steps);
+        break;
+    case 1:
+        c.status = pd_evaluate_wdl(q.whiteBits, q.blackBits,
+                                   q.whiteStonesToPlace, q.blackStonesToPlace,
+                                   q.playerToMove, q.onlyStoneTaking, &c.wdl);
+        break;
+    case 2:
+        c.status = pd_best_move(q.whiteBits, q.blackBits, q.whiteStonesToPlace,
+                                q.blackStonesToPlace, q.playerToMove,
+                                q.onlyStoneTaking, c.move, sizeof(c.move));
+        break;
+    }
+    if (c.status != 1)
+        c.errorCode = static_cast<int>(PerfectErrors::getLastErrorCode());
+    return c;
+}
+
+void worker()
+{
+    for (;;) {
+        Pending p;
+        {
+            std::unique_lock<std::mutex> lock(g_mutex);
+            g_cv.wait(lock, [] { return g_stopping || !g_queue.empty(); });
+            if (g_queue.empty())
+                return;
+            p = g_queue.front();
+            g_queue.pop_front();
+        }
+        deliver(run(p));
+    }
+}
+
+// The worker threads. If the process exits without pd_deinit, the
+// destructor stops them: destroying a joinable std::thread would call
+// std::terminate. Defined after the state the workers use, so that it is
+// destroyed first.
+struct Workers
+{
+    std::vector<std::thread> threads;
+
+    ~Workers() { stop(); }
+};
+
+Workers g_workers;
+
+} // namespace
+
+void set_workers(int threads)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_worker_count = threads;
+}
+
+bool submit(const pd_query &query, long long tag)
+{
+    if (query.kind < 0 || query.kind > 2)
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_queue.push_back(Pending {query, tag});
+        while ((int)g_workers.threads.size() < g_worker_count)
+            g_workers.threads.emplace_back(worker);
+    }
+    g_cv.notify_one();
+    return true;
+}
+
+int poll(pd_completion *out, int max_count)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    int n = 0;
+    while (n < max_count && !g_done.empty()) {
+        out[n++] = g_done.front();
+        g_done.pop_front();
+    }
+    return n;
+}
+
+int cancel(long long tag)
+{
+    std::vector<pd_completion> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        for (auto it = g_queue.begin(); it != g_queue.end();) {
+            if (tag < 0 || it->tag == tag) {
+                cancelled.push_back(make_completion(it->tag, -1));
+                it = g_queue.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (const pd_completion &c : cancelled)
+        deliver(c);
+    return (int)cancelled.size();
+}
+
+void set_callback(pd_completion_callback callback, void *user)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_callback = callback;
+    g_callback_user = user;
+}
+
+void stop()
+{
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_stopping = true;
+        g_queue.clear();
+        workers.swap(g_workers.threads);
+    }
+    g_cv.notify_all();
+    for (std::thread &t : workers)
+        t.join();
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_done.clear();
+    g_stopping = false;
+}
+
+} // namespace PdAsync
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_async.h
+//
+// Worker threads behind pd_submit/pd_poll. Queries are queued in submission
+// order and run through the synchronous pd_* entry points, so a cold sector
+// load blocks a worker instead of the caller. Completions are either queued
+// for pd_poll or handed to the completion callback: on the worker thread, or
+// on the caller's thread for the queries that cancel takes off the queue.
+
+#ifndef PERFECT_ASYNC_H_INCLUDED
+#define PERFECT_ASYNC_H_INCLUDED
+
+#include "perfect_c_api.h"
+
+namespace PdAsync {
+
+// Number of workers started by the next submit (default 1). The oracle
+// serializes queries on its API mutex, so more workers mainly help when
+// callbacks or callers are slow to drain completions.
+void set_workers(int threads);
+
+// Queues a query; the workers are started on first use. Returns false for an
+// unknown query kind.
+bool submit(const pd_query &query, long long tag);
+
+// Moves up to max_count completions to out, oldest first. Returns the count.
+int poll(pd_completion *out, int max_count);
+
+// Completes the queued (not yet started) queries with the given tag, or all
+// of them if tag < 0, as cancelled. Returns the number cancelled.
+int cancel(long long tag);
+
+void set_callback(pd_completion_callback callback, void *user);
+
+// Cancels the queued queries, waits for the running ones and joins the
+// workers. Undelivered completions are dropped.
+void stop();
+
+} // namespace PdAsync
+
+#endif // PERFECT_ASYNC_H_INCLUDED
@@ -0,0 +1,708 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_batch.cpp
+
+#include "perfect_batch.h"
+
+#include "perfect_common.h"
+#include "perfect_errors.h"
+#include "perfect_hash.h"
+#include "perfect_init.h"
+#include "perfect_log.h"
+#include "perfect_retro.h"
+#include "perfect_sec_val.h"
+#include "perfect_sector.h"
+#include "perfect_sector_graph.h"
+#include "perfect_variant.h"
+#include "perfect_wrappers.h"
+#include "rule.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+struct SolveOptions
+{
+    std::string out;
+    std::string variant {"std"};
+    std::string name; // the variant by default
+    std::string secval;
+    std::string scratch; // out by default
+    int fly {3};
+    bool diagonal {false};
+    bool remove_from_mills {false};
+    int threads {0};
+    int64_t memory_mb {0}; // 0: no limit
+    std::vector<Id> sectors;
+};
+
+// The rules of the move generator, as bitboards of squares 0..23.
+struct MoveRules
+{
+    bool mixed; // placing and sliding mix (Lasker)
+    int fly;    // a side with at most this many stones flies; 0: never
+    bool remove_from_mills;
+    int mill_count;
+    uint32_t mills[20];
+    int through_count[24];
+    uint32_t through[24][4]; // the mills through a square
+    uint32_t adjacent[24];
+};
+
+MoveRules make_rules(const VariantTables &t, bool mixed, int fly,
+                     bool remove_from_mills)
+{
+    MoveRules r {};
+    r.mixed = mixed;
+    r.fly = fly;
+    r.remove_from_mills = remove_from_mills;
+    r.mill_count = t.millCount;
+    for (int j = 0; j < t.millCount; j++)
+        for (int k = 0; k < 3; k++)
+            r.mills[j] |= 1u << t.millPos[j][k];
+    for (int i = 0; i < 24; i++) {
+        r.through_count[i] = t.invMillPosLengths[i];
+        for (int k = 0; k < t.invMillPosLengths[i]; k++)
+            r.through[i][k] = r.mills[t.invMillPos[i][k]];
+        for (int k = 1; k <= t.aLBoardGraph[i][0]; k++)
+            r.adjacent[i] |= 1u << t.aLBoardGraph[i][k];
+    }
+    return r;
+}
+
+bool closes_mill(const MoveRules &r, uint32_t stones, int to)
+{
+    for (int k = 0; k < r.through_count[to]; k++)
+        if ((stones & r.through[to][k]) == r.through[to][k])
+            return true;
+    return false;
+}
+
+uint32_t in_mills(const MoveRules &r, uint32_t stones)
+{
+    uint32_t m = 0;
+    for (int j = 0; j < r.mill_count; j++)
+        if ((stones & r.mills[j]) == r.mills[j])
+            m |= r.mills[j];
+    return m;
+}
+
+// Calls f(child sector, child) for every move of white in position a of
+// sector id; the child is seen from black, like in PerfectPlayer::
+// sector_child. No calls means white is blocked.
+template <class F>
+void for_each_child(const MoveRules &r, const Id &id, board a, F f)
+{
+    const uint32_t w = (uint32_t)(a & mask24);
+    const uint32_t b = (uint32_t)((a >> 24) & mask24);
+    const uint32_t empty = ~(w | b) & (uint32_t)mask24;
+    uint32_t removable = b;
+    if (!r.remove_from_mills) {
+        const uint32_t free = b & ~in_mills(r, b);
+        if (free)
+            removable = free;
+    }
+
+    // Closing a mill with no stone to remove is not a move, as in
+    // PerfectPlayer::with_taking_moves.
+    auto emit = [&](Id cid, uint32_t w2, int to) {
+        if (!closes_mill(r, w2, to)) {
+            cid.negate_id();
+            f(cid, (board)b | ((board)w2 << 24));
+            return;
+        }
+        cid.B--;
+        cid.negate_id();
+        for (uint32_t m = removable; m; m &= m - 1)
+            f(cid, (board)(b & ~(m & (0u - m))) | ((board)w2 << 24));
+    };
+    auto slides = [&] {
+        const bool flying = r.fly > 0 && id.W + id.WF <= r.fly;
+        for (uint32_t s = w; s; s &= s - 1) {
+            const int from = std::countr_zero(s);
+            const uint32_t rest = w & ~(1u << from);
+            for (uint32_t t = (flying ? empty : r.adjacent[from] & empty); t;
+                 t &= t - 1) {
+                const int to = std::countr_zero(t);
+                emit(id, rest | (1u << to), to);
+            }
+        }
+    };
+    auto sets = [&] {
+        Id cid = id;
+        cid.W++;
+        cid.WF--;
+        for (uint32_t t = empty; t; t &= t - 1) {
+            const int to = std::countr_zero(t);
+            emit(cid, w | (1u << to), to);
+        }
+    };
+
+    if (id.WF > 0 && !r.mixed) {
+        sets();
+    } else {
+        slides();
+        if (id.WF > 0)
+            sets();
+    }
+}
+
+std::string path_of(const std::string &dir, const std::string &file)
+{
+#ifdef _WIN32
+    return dir + "\\" + file;
+#else
+    return dir + "/" + file;
+#endif
+}
+
+bool file_exists(const std::string &path)
+{
+    FILE *file = nullptr;
+    if (FOPEN(&file, path.c_str(), "rb") == -1 || !file)
+        return false;
+    fclose(file);
+    return true;
+}
+
+// One object per sector. The solved sectors are read as successors by the
+// units that need them, with the hash tables and the mapped file kept for as
+// long as any of those runs.
+class Store
+{
+public:
+    Sector *get(const Id &id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return object(id);
+    }
+
+    Sector *acquire(const Id &id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Sector *s = object(id);
+        if (users[id]++ == 0) {
+            s->allocate_hash(true);
+            if (!s->hash || (!s->f && !s->z)) {
+                release_locked(id);
+                SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                                  "Cannot read " + Id(id).file_name());
+                return nullptr;
+            }
+            s->map_file();
+        }
+        return s;
+    }
+
+    void release(const Id &id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release_locked(id);
+    }
+
+private:
+    Sector *object(const Id &id)
+    {
+        Sector *&s = sectors[id];
+        if (!s)
+            s = new Sector(id);
+        return s;
+    }
+
+    void release_locked(const Id &id)
+    {
+        if (--users[id] == 0)
+            sectors[id]->release_hash();
+    }
+
+    std::mutex mutex;
+    std::map<Id, Sector *> sectors;
+    std::map<Id, int> users;
+};
+
+struct Job
+{
+    wu *w;
+    std::vector<Id> ids;
+    std::vector<Job *> parents;
+    int waiting {0}; // children not solved yet
+    bool done {false};
+};
+
+struct Batch
+{
+    const SolveOptions &o;
+    MoveRules rules;
+    Retro::Storage storage;
+    Store store;
+};
+
+bool parse_sector(const char *s, Id &id)
+{
+    int v[4];
+    if (sscanf(s, "%d,%d,%d,%d", &v[0], &v[1], &v[2], &v[3]) != 4)
+        return false;
+    id = Id(v[0], v[1], v[2], v[3]);
+    return true;
+}
+
+bool parse_options(int argc, char **argv, SolveOptions &o)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        Id id;
+        if (a == "--out" && v) {
+            o.out = v;
+        } else if (a == "--variant" && v) {
+            o.variant = v;
+        } else if (a == "--name" && v) {
+            o.name = v;
+        } else if (a == "--secval" && v) {
+            o.secval = v;
+        } else if (a == "--scratch" && v) {
+            o.scratch = v;
+        } else if (a == "--fly" && v) {
+            o.fly = atoi(v);
+        } else if (a == "--diagonal") {
+            o.diagonal = true;
+            continue;
+        } else if (a == "--remove-from-mills") {
+            o.remove_from_mills = true;
+            continue;
+        } else if (a == "--threads" && v) {
+            o.threads = atoi(v);
+        } else if (a == "--memory" && v) {
+            o.memory_mb = atoll(v);
+        } else if (a == "--sector" && v && parse_sector(v, id)) {
+            o.sectors.push_back(id);
+        } else {
+            o.out.clear();
+            break;
+        }
+        i++;
+    }
+    if (o.out.empty() ||
+        (o.variant != "std" && o.variant != "lask" && o.variant != "mora") ||
+        o.fly < 0 || o.memory_mb < 0) {
+        fprintf(stderr, "usage: perfect-db-solve --out DIR [--variant "
+                        "std|lask|mora] [--fly N] [--diagonal] "
+                        "[--remove-from-mills] [--name NAME] [--secval FILE] "
+                        "[--sector W,B,WF,BF]... [--threads N] [--memory MB] "
+                        "[--scratch DIR]\n");
+        return false;
+    }
+    if (o.name.empty())
+        o.name = o.variant;
+    if (o.scratch.empty())
+        o.scratch = o.out;
+    return true;
+}
+
+// Unique values, opposite for a sector and its partner and 0 for the
+// sectors that are their own partner, increasing with the material of the
+// side to move.
+bool write_generated_sec_vals(const std::string &path)
+{
+    std::vector<Id> ahead;
+    for (const Id &s : sector_list) {
+        const int material = s.W + s.WF - s.B - s.BF;
+        if (material > 0 || (material == 0 && s.W > s.B))
+            ahead.push_back(s);
+    }
+    std::sort(ahead.begin(), ahead.end(), [](const Id &a, const Id &b) {
+        return std::make_tuple(a.W + a.WF - a.B - a.BF, a.W - a.B, a.W,
+                               a.WF) < std::make_tuple(b.W + b.WF - b.B - b.BF,
+                                                       b.W - b.B, b.W, b.WF);
+    });
+    std::map<Id, int> value;
+    for (size_t k = 0; k < ahead.size(); k++) {
+        value[ahead[k]] = (int)k + 1;
+        value[-ahead[k]] = -((int)k + 1);
+    }
+    const int virt = (int)ahead.size() + 1;
+
+    FILE *file = nullptr;
+    if (FOPEN(&file, path.c_str(), "wt") == -1 || !file)
+        return false;
+    fprintf(file, "virt_loss_val: %d\nvirt_win_val: %d\n%d\n", -virt, virt,
+            (int)sector_list.size());
+    for (const Id &s : sector_list) {
+        auto it = value.find(s);
+        fprintf(file, "%d %d %d %d  %d\n", s.W, s.B, s.WF, s.BF,
+                it == value.end() ? 0 : it->second);
+    }
+    return fclose(file) == 0;
+}
+
+bool copy_file(const std::string &from, const std::string &to)
+{
+    FILE *in = nullptr, *out = nullptr;
+    if (FOPEN(&in, from.c_str(), "rb") == -1 || !in)
+        return false;
+    if (FOPEN(&out, to.c_str(), "wb") == -1 || !out) {
+        fclose(in);
+        return false;
+    }
+    char buffer[1 << 16];
+    size_t n;
+    bool ok = true;
+    while (ok && (n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        ok = fwrite(buffer, 1, n, out) == n;
+    fclose(in);
+    return fclose(out) == 0 && ok;
+}
+
+template <class Inside>
+bool expand(Batch &batch, Retro::Unit &u, int64_t i, bool exits,
+            Inside inside, Wrappers::gui_eval_elem2 &best, bool &has_exit)
+{
+    Retro::Part &p = u.part_of(i);
+    const board a = p.ws->s->hash->inverse_hash((int)(i - p.base));
+    bool moves = false, ok = true;
+    has_exit = false;
+    for_each_child(batch.rules, p.id, a, [&](const Id &cid, board c) {
+        moves = true;
+        if (!ok)
+            return;
+        if (const Retro::Part *q = u.find(cid)) {
+            inside(q->base + q->ws->s->hash->index(c));
+            return;
+        }
+        Wrappers::gui_eval_elem2 v = Wrappers::gui_eval_elem2::virt_loss_val();
+        if (!exits || !(ok = Retro::exit_value(u, p, cid, c, v)))
+            return;
+        if (!has_exit || v > best)
+            best = v;
+        has_exit = true;
+    });
+    if (!moves) {
+        // A side without moves has lost.
+        best = Wrappers::gui_eval_elem2(
+            static_cast<sec_val>(virt_loss_val - p.ws->sval()), 0, p.ws->s);
+        has_exit = true;
+    }
+    return ok;
+}
+
+// Writes the .sec2 file of a part through a temporary file.
+bool write_part(Batch &batch, const Retro::Unit &u, const Retro::Part &p,
+                int threads)
+{
+    const std::string path = path_of(batch.o.out, Id(p.id).file_name());
+    const std::string tmp = path + ".tmp";
+    FILE *file = nullptr;
+    if (FOPEN(&file, tmp.c_str(), "wb") == -1 || !file) {
+        SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                          "Cannot create " + tmp);
+        return false;
+    }
+    bool ok = Retro::encode(u.graph, p.base, p.count, threads,
+                            [&](const void *data, size_t size) {
+                                if (fwrite(data, 1, size, file) == size)
+                                    return true;
+                                SET_ERROR_MESSAGE(
+                                    PerfectErrors::PE_FILE_IO_ERROR,
+                                    "Cannot write " + tmp);
+                                return false;
+                            });
+    ok = fclose(file) == 0 && ok;
+    if (ok) {
+        remove(path.c_str());
+        ok = rename(tmp.c_str(), path.c_str()) == 0;
+        if (!ok)
+            SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                              "Cannot rename " + tmp);
+    }
+    if (!ok)
+        remove(tmp.c_str());
+    return ok;
+}
+
+bool solve_job(Batch &batch, const Job &job, int threads)
+{
+    const auto start = std::chrono::steady_clock::now();
+    int64_t total = 0;
+    for (const Id &x : job.ids)
+        total += hash_count_of(x.W, x.B);
+    if (total > INT32_MAX) {
+        SET_ERROR_MESSAGE(PerfectErrors::PE_OUT_OF_RANGE,
+                          Id(job.ids[0]).to_string() + " is too large");
+        return false;
+    }
+
+    std::vector<Id> needed;
+    for (const Id &x : job.ids)
+        for (const Id &c : graph_func(x))
+            if (std::find(job.ids.begin(), job.ids.end(), c) ==
+                    job.ids.end() &&
+                std::find(needed.begin(), needed.end(), c) == needed.end())
+                needed.push_back(c);
+
+    std::vector<Wrappers::WSector> ws;
+    ws.reserve(job.ids.size());
+    std::vector<Id> acquired;
+    bool ok = true;
+    {
+        Retro::Unit u;
+        for (const Id &x : job.ids) {
+            ws.emplace_back(batch.store.get(x));
+            ws.back().s->allocate_hash(false);
+            if (!ws.back().s->hash) {
+                SET_ERROR_MESSAGE(PerfectErrors::PE_OUT_OF_MEMORY,
+                                  "Cannot build the hash of " +
+                                      Id(x).to_string());
+                ok = false;
+                break;
+            }
+            u.parts.push_back(Retro::Part {x, &ws.back(), u.n,
+                                           ws.back().s->hash->hash_count});
+            u.n += u.parts.back().count;
+        }
+        for (size_t k = 0; ok && k < needed.size(); k++) {
+            Sector *s = batch.store.acquire(needed[k]);
+            ok = s != nullptr;
+            if (ok) {
+                acquired.push_back(needed[k]);
+                u.loaded[needed[k]] = s;
+            }
+        }
+
+        auto each = [&](int64_t i, bool exits, auto inside,
+                        Wrappers::gui_eval_elem2 &best, bool &has_exit) {
+            return expand(batch, u, i, exits, inside, best, has_exit);
+        };
+        ok = ok &&
+             Retro::build(u.graph, batch.storage, u.n, threads, each) &&
+             Retro::solve_levels(u.graph, batch.storage) &&
+             Retro::solve_steps(u.graph, batch.storage);
+        for (size_t k = 0; ok && k < u.parts.size(); k++)
+            ok = write_part(batch, u, u.parts[k], threads);
+
+        if (ok) {
+            const double seconds =
+                std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+            LOG("Solved %s%s: %lld positions, %lld moves inside, in %.1f s\n",
+                Id(job.ids[0]).to_string().c_str(),
+                job.ids.size() > 1 ?
+                    (" with " + Id(job.ids[1]).to_string()).c_str() :
+                    "",
+                (long long)u.n, (long long)u.graph.edges(), seconds);
+        }
+    }
+
+    for (const Id &c : acquired)
+        batch.store.release(c);
+    for (Wrappers::WSector &w : ws)
+        w.s->release_hash();
+    return ok;
+}
+
+// The wus to solve: all of them, or the ones of the targets and of the
+// sectors they lead to.
+std::vector<wu *> select_wus(const SolveOptions &o)
+{
+    std::set<wu *> seen;
+    std::vector<wu *> r;
+    std::vector<Id> stack = o.sectors.empty() ? sector_list : o.sectors;
+    while (!stack.empty()) {
+        Id s = stack.back();
+        stack.pop_back();
+        wu *w = wus[s];
+        if (!seen.insert(w).second)
+            continue;
+        r.push_back(w);
+        if (!o.sectors.empty()) {
+            for (const Id &c : graph_func(w->id))
+                stack.push_back(c);
+            if (w->is_twine)
+                for (const Id &c : graph_func(-w->id))
+                    stack.push_back(c);
+        }
+    }
+    return r;
+}
+
+bool check_sectors(const SolveOptions &o)
+{
+    std::set<Id> known(sector_list.begin(), sector_list.end());
+    for (const Id &s : o.sectors) {
+        if (!known.count(s)) {
+            fprintf(stderr, "[perfect-db-solve] %s is not a sector of %s\n",
+                    Id(s).to_string().c_str(), o.variant.c_str());
+            return false;
+        }
+    }
+    for (const Id &s : sector_list) {
+        if (!has_sec_val(s)) {
+            fprintf(stderr, "[perfect-db-solve] no sector value for %s\n",
+                    Id(s).to_string().c_str());
+            return false;
+        }
+        if (wus[s]->is_twine && get_sec_val(s) + get_sec_val(-s) != 0) {
+            fprintf(stderr,
+                    "[perfect-db-solve] the sector values of %s and its "
+                    "partner are not opposite\n",
+                    Id(s).to_string().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+int run(const SolveOptions &o)
+{
+    rule.pieceCount = o.variant == "mora" ? 12 : (o.variant == "lask" ? 10 :
+                                                                        9);
+    perfect_init();
+    ruleVariantName = o.name;
+    secValPath = o.out;
+    if (o.fly > maxKsz) {
+        fprintf(stderr, "[perfect-db-solve] --fly is above the piece count\n");
+        return 2;
+    }
+    init_sector_graph();
+
+    const std::string secval = path_of(o.out, o.name + ".secval");
+    if (!(o.secval.empty() ? write_generated_sec_vals(secval) :
+                             copy_file(o.secval, secval))) {
+        fprintf(stderr, "[perfect-db-solve] cannot write %s\n",
+                secval.c_str());
+        return 1;
+    }
+    reset_sec_vals();
+    init_sec_vals();
+    if (PerfectErrors::hasError() || !check_sectors(o)) {
+        if (PerfectErrors::hasError())
+            fprintf(stderr, "[perfect-db-solve] %s\n",
+                    PerfectErrors::getLastErrorMessage().c_str());
+        return 1;
+    }
+
+    const VariantTables &tables = o.diagonal || o.variant == "mora" ?
+                                      moraTables :
+                                      stdLaskerTables;
+    Batch batch {o,
+                 make_rules(tables, o.variant == "lask", o.fly,
+                            o.remove_from_mills),
+                 Retro::Storage(o.memory_mb ? o.memory_mb << 20 : INT64_MAX,
+                                o.scratch),
+                 {}};
+
+    // The jobs, and the order they can run in: a job is ready when the
+    // jobs of the sectors its moves lead to are done.
+    std::vector<wu *> selected = select_wus(o);
+    std::map<wu *, Job> jobs;
+    for (wu *w : selected) {
+        Job &job = jobs[w];
+        job.w = w;
+        job.ids.push_back(w->id);
+        if (w->is_twine)
+            job.ids.push_back(-w->id);
+        job.waiting = w->child_count;
+        job.done = true;
+        for (const Id &x : job.ids)
+            job.done = job.done &&
+                       file_exists(path_of(o.out, Id(x).file_name()));
+    }
+    for (auto &entry : jobs)
+        for (wu *p : entry.first->parents)
+            if (jobs.count(p))
+                entry.second.parents.push_back(&jobs[p]);
+    std::deque<Job *> ready;
+    int left = 0;
+    for (auto &entry : jobs)
+        if (entry.second.done)
+            for (Job *p : entry.second.parents)
+                p->waiting--;
+    for (auto &entry : jobs) {
+        if (entry.second.done)
+            continue;
+        left++;
+        if (entry.second.waiting == 0)
+            ready.push_back(&entry.second);
+    }
+    LOG("%d sectors, %zu work units, %d to solve\n", (int)sector_list.size(),
+        jobs.size(), left);
+
+    const int threads = o.threads > 0 ?
+                            o.threads :
+                            (int)std::max(1u,
+                                          std::thread::hardware_concurrency());
+    std::mutex mutex;
+    std::condition_variable changed;
+    int running = 0;
+    bool failed = false;
+    auto work = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            changed.wait(lock, [&] {
+                return failed || !ready.empty() || (running == 0 && !left);
+            });
+            if (failed || ready.empty())
+                return;
+            Job *job = ready.front();
+            ready.pop_front();
+            running++;
+            // The threads are shared among the units running at the time.
+            const int share = std::max(1, threads / running);
+            lock.unlock();
+            const bool ok = solve_job(batch, *job, share);
+            if (!ok)
+                fprintf(stderr, "[perfect-db-solve] %s: %s\n",
+                        Id(job->ids[0]).to_string().c_str(),
+                        PerfectErrors::getLastErrorMessage().c_str());
+            PerfectErrors::clearError();
+            lock.lock();
+            running--;
+            left--;
+            failed = failed || !ok;
+            for (Job *p : job->parents)
+                if (--p->waiting == 0 && !p->done)
+                    ready.push_back(p);
+            changed.notify_all();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int k = 1; k < threads; k++)
+        workers.emplace_back(work);
+    work();
+    for (auto &w : workers)
+        w.join();
+
+    if (failed)
+        return 1;
+    LOG("Done: %s\n", o.out.c_str());
+    return 0;
+}
+
+} // namespace
+
+PD_API int pd_solve_main(int argc, char **argv)
+{
+    SolveOptions o;
+    if (!parse_options(argc, argv, o))
+        return 2;
+    try {
+        return run(o);
+    } catch (...) {
+        fprintf(stderr, "[perfect-db-solve] unexpected exception\n");
+        return 1;
+    }
+}
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_batch.h
+//
+// Batch retrograde solver for rule sets the shipped databases do not cover,
+// only compiled with the `oracle-solve` feature of the perfect-db crate and
+// run through its `perfect-db-solve` binary:
+//
+//   cargo run --release -p perfect-db --features oracle-solve
+//       --bin perfect-db-solve -- --out DIR --variant std --fly 0
+//
+// A rule set keeps the sector structure of its base variant (std, lask or
+// mora: the piece count, and whether placing and sliding mix) and may change
+//
+// - flying (Rule::mayFly, Rule::flyPieceCount): --fly N lets a side with at
+//   most N stones on the board and in hand fly, --fly 0 never; 3 by default;
+// - the lines (Rule::hasDiagonalLines): --diagonal plays std or lask on the
+//   Morabaraba board, with its diagonal mills and adjacency (moraTables);
+// - removal (Rule::mayRemoveFromMillsAlways): --remove-from-mills allows any
+//   stone to be removed, not only the ones outside mills.
+//
+// The positions are generated with bitboards from these options, not with
+// the move generator of the oracle, which has the rules of the shipped
+// databases built in; a database solved here can be read with the file
+// format of the oracle, but not queried with its move generator unless the
+// rules are the standard ones.
+//
+// The output directory gets NAME.secval (sector values ordered by material,
+// or a copy of --secval FILE) and NAME_W_B_WF_BF.sec2 for every sector, in
+// the format of Sector::write_header, with no symmetry redirects. The work
+// units of the sector graph (wus: a sector, or twines solved together) are
+// solved once the ones their moves lead to are done, in reverse topological
+// order, several at a time on the worker threads; sectors whose files exist
+// already count as done, so an interrupted run can be resumed. The graph of
+// a unit stays on the heap up to --memory MB and goes to scratch files
+// (--scratch DIR, the output directory by default) beyond that; the hash
+// tables of the sectors being solved and read are not counted.
+
+#ifndef PERFECT_BATCH_H_INCLUDED
+#define PERFECT_BATCH_H_INCLUDED
+
+#include "perfect_c_api.h"
+
+extern "C" {
+
+// Solves the sectors of a rule set into a directory. Returns the process
+// exit code. Sets the globals of the oracle (variant, sector values), so it
+// must not run in a process that also queries a database.
+PD_API int pd_solve_main(int argc, char **argv);
+}
+
+#endif // PERFECT_BATCH_H_INCLUDED
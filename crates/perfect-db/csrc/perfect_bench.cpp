@@ -0,0 +1,407 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_bench.cpp
+
+#include "perfect_bench.h"
+
+#include "perfect_api.h"
+#include "perfect_common.h"
+#include "perfect_errors.h"
+#include "perfect_game_state.h"
+#include "perfect_hash.h"
+#include "perfect_player.h"
+#include "perfect_sector.h"
+#include "perfect_stats.h"
+#include "perfect_symmetries.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Bench;
+
+namespace {
+
+struct BenchOptions
+{
+    std::string db;
+    std::string variant {"std"};
+    std::string out;
+    uint64_t seed {1};
+    int samples {4096};
+    int repeat {5};
+    int sector[4] {-1, -1, -1, -1};
+    std::vector<int> hash_w {0, 2, 4};
+};
+
+struct BenchResult
+{
+    std::string name;
+    std::string params;
+    uint64_t ops;
+    double ns_min;
+    double ns_median;
+    uint64_t checksum;
+};
+
+// A sector position in the sector's frame (white to move).
+struct BenchPosition
+{
+    int white, black, wf, bf;
+};
+
+// The largest sector of the sample databases shipped with the app.
+void default_sector(const std::string &variant, int out[4])
+{
+    static const int std_id[4] = {3, 4, 0, 0};
+    static const int lask_id[4] = {1, 2, 9, 8};
+    static const int mora_id[4] = {1, 3, 10, 9};
+    const int *id = variant == "mora" ? mora_id :
+                                        (variant == "lask" ? lask_id : std_id);
+    std::copy(id, id + 4, out);
+}
+
+bool parse_options(int argc, char **argv, BenchOptions &o)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        std::vector<int> ints;
+        if (a == "--db" && v) {
+            o.db = v;
+        } else if (a == "--variant" && v) {
+            o.variant = v;
+        } else if (a == "--out" && v) {
+            o.out = v;
+        } else if (a == "--seed" && v) {
+            o.seed = strtoull(v, nullptr, 10);
+        } else if (a == "--samples" && v) {
+            o.samples = atoi(v);
+        } else if (a == "--repeat" && v) {
+            o.repeat = atoi(v);
+        } else if (a == "--sector" && v && parse_ints(v, ints) &&
+                   ints.size() == 4) {
+            std::copy(ints.begin(), ints.end(), o.sector);
+        } else if (a == "--hash-w" && v && parse_ints(v, ints)) {
+            o.hash_w = ints;
+        } else {
+            fprintf(stderr,
+                    "[perfect-db-bench] unknown or incomplete option %s\n",
+                    a.c_str());
+            return false;
+        }
+        i++;
+    }
+    if (o.db.empty() || piece_count_of(o.variant) == 0 || o.samples < 1 ||
+        o.repeat < 1) {
+        fprintf(stderr, "usage: perfect-db-bench --db DIR [--variant "
+                        "std|lask|mora] [--seed N] [--samples N] [--repeat N] "
+                        "[--sector W,B,WF,BF] [--hash-w 0,2,4] [--out FILE]\n");
+        return false;
+    }
+    if (o.sector[0] < 0)
+        default_sector(o.variant, o.sector);
+    return true;
+}
+
+// Runs body once to warm up, then repeat times, and reports the per-op
+// time of the fastest and the median run. body returns a checksum of its
+// results so the work cannot be optimized away; it is identical across
+// runs and seeds the output for reproducibility checks.
+template <class F>
+BenchResult measure(const std::string &name, const std::string &params,
+                    int repeat, uint64_t ops, bool warmup, F &&body)
+{
+    if (warmup)
+        body();
+
+    std::vector<double> per_op;
+    uint64_t checksum = 0;
+    for (int r = 0; r < repeat; r++) {
+        uint64_t start = Stats::now_ns();
+        checksum = body();
+        per_op.push_back((double)(Stats::now_ns() - start) / (double)ops);
+    }
+    std::sort(per_op.begin(), per_op.end());
+    return BenchResult {name,       params, ops, per_op.front(),
+                        per_op[per_op.size() / 2], checksum};
+}
+
+void write_json(FILE *out, const BenchOptions &o,
+                const std::vector<BenchResult> &results)
+{
+    pd_stats st;
+    pd_get_stats(&st);
+
+    fprintf(out,
+            "{\"schema\":\"perfect-db-bench/1\",\"db\":\"%s\","
+            "\"variant\":\"%s\",\"seed\":%llu,\"samples\":%d,\"repeat\":%d,"
+            "\"sector\":[%d,%d,%d,%d],\"results\":[",
+            json_escape(o.db).c_str(), o.variant.c_str(),
+            (unsigned long long)o.seed, o.samples, o.repeat, o.sector[0],
+            o.sector[1], o.sector[2], o.sector[3]);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        fprintf(out,
+                "%s{\"name\":\"%s\",\"params\":\"%s\",\"ops\":%llu,"
+                "\"ns_per_op_min\":%.2f,\"ns_per_op_median\":%.2f,"
+                "\"checksum\":%llu}",
+                i ? "," : "", r.name.c_str(), r.params.c_str(),
+                (unsigned long long)r.ops, r.ns_min, r.ns_median,
+                (unsigned long long)r.checksum);
+    }
+    fprintf(out,
+            "],\"stats\":{\"evaluations\":%lld,\"hash_builds\":%lld,"
+            "\"bytes_read\":%lld,\"em_set_lookups\":%lld,"
+            "\"sym_redirects\":%lld}}\n",
+            st.evaluations, st.hashBuilds, st.bytesRead, st.emSetLookups,
+            st.symRedirects);
+}
+
+int run(const BenchOptions &o)
+{
+    using namespace PerfectErrors;
+
+    if (!pd_init_variant(o.db.c_str(), piece_count_of(o.variant))) {
+        fprintf(stderr, "[perfect-db-bench] cannot open %s database in %s\n",
+                o.variant.c_str(), o.db.c_str());
+        return 1;
+    }
+
+    PerfectPlayer player;
+    Wrappers::WID wid(o.sector[0], o.sector[1], o.sector[2], o.sector[3]);
+    auto it = player.secs.find(wid);
+    if (it == player.secs.end()) {
+        fprintf(stderr, "[perfect-db-bench] sector %s is not in the database\n",
+                wid.ToString().c_str());
+        pd_deinit();
+        return 1;
+    }
+    ::Sector *sec = it->second.s;
+    sec->allocate_hash();
+    if (!sec->hash || !sec->evals_loaded) {
+        fprintf(stderr, "[perfect-db-bench] cannot load sector %s\n",
+                wid.ToString().c_str());
+        pd_deinit();
+        return 1;
+    }
+    Hash *hash = sec->hash;
+
+    // Inputs. std::mt19937_64 output is fully specified by the standard, and
+    // only its raw output is used, so a seed gives the same inputs on every
+    // platform.
+    std::mt19937_64 rng(o.seed);
+    const int n = o.samples;
+    std::vector<board> boards(n), collapsed(n);
+    std::vector<int> ops(n), indices(n);
+    for (int i = 0; i < n; i++) {
+        int w = (int)(rng() & mask24);
+        int b = (int)(rng() & mask24) & ~w;
+        boards[i] = w | ((board)b << 24);
+        collapsed[i] = ((board)collapse(boards[i]) << 24) | w;
+        ops[i] = (int)(rng() & 15);
+        indices[i] = (int)(rng() % (uint64_t)hash->hash_count);
+    }
+
+    std::vector<board> sector_boards(n);
+    std::vector<BenchPosition> positions;
+    for (int i = 0; i < n; i++) {
+        sector_boards[i] = hash->inverse_hash(indices[i]);
+        positions.push_back({(int)(sector_boards[i] & mask24),
+                             (int)(sector_boards[i] >> 24), o.sector[2],
+                             o.sector[3]});
+    }
+
+    std::vector<GameState> states;
+    for (const BenchPosition &p : positions) {
+        GameState s;
+        if (MalomSolutionAccess::make_query_state(p.white, p.black, p.wf, p.bf,
+                                                  0, false, s))
+            states.push_back(s);
+    }
+
+    std::vector<BenchResult> results;
+    const int r = o.repeat;
+
+    results.push_back(measure("collapse", "", r, n, true, [&] {
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++)
+            sum += (uint64_t)collapse(boards[i]);
+        return sum;
+    }));
+    results.push_back(measure("uncollapse", "", r, n, true, [&] {
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++)
+            sum ^= (uint64_t)uncollapse(collapsed[i]) * (i + 1);
+        return sum;
+    }));
+    results.push_back(measure("sym48_transform", "", r, n, true, [&] {
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++)
+            sum ^= (uint64_t)sym48_transform(ops[i], boards[i]) * (i + 1);
+        return sum;
+    }));
+
+    for (int w : o.hash_w) {
+        if (w < 0 || w > 12)
+            continue;
+        results.push_back(measure("hash_construct", "W=" + std::to_string(w),
+                                  r, 1, false, [&] {
+                                      Hash h(w, w, nullptr);
+                                      return (uint64_t)h.hash_count;
+                                  }));
+    }
+
+    const std::string sector_param = "sector=" + wid.ToString();
+    results.push_back(measure("hash_index", sector_param, r, n, true, [&] {
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++)
+            sum += (uint64_t)hash->index(sector_boards[i]);
+        return sum;
+    }));
+    results.push_back(measure("hash_hash", sector_param, r, n, true, [&] {
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++)
+            sum += (uint64_t)hash->hash(sector_boards[i]).first;
+        return sum;
+    }));
+    results.push_back(measure("inverse_hash", sector_param, r, n, true, [&] {
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++)
+            sum ^= (uint64_t)hash->inverse_hash(indices[i]) * (i + 1);
+        return sum;
+    }));
+#ifdef DD
+    results.push_back(measure("extract_value", sector_param, r, n, true, [&] {
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++) {
+            auto v = sec->extract_value(indices[i]);
+            sum = sum * 31 + (uint64_t)(v.first * 65536 + v.second);
+        }
+        return sum;
+    }));
+#endif
+
+    // The kernels below go through the hash LRU, which may release the
+    // tables used directly above.
+    hash = nullptr;
+
+    // get_good_moves also reads the successor sectors, which the sample
+    // databases only partly contain; keep the positions it can answer.
+    std::vector<GameState> good_states;
+    for (const GameState &s : states) {
+        clearError();
+        Value v = VALUE_NONE;
+        player.get_good_moves(s, v);
+        if (!hasError())
+            good_states.push_back(s);
+    }
+    clearError();
+
+    if (!states.empty()) {
+        const uint64_t m = states.size();
+        results.push_back(
+            measure("get_move_list", sector_param, r, m, true, [&] {
+                uint64_t sum = 0;
+                for (const GameState &s : states)
+                    sum += player.get_move_list(s).size();
+                return sum;
+            }));
+    }
+    if (!good_states.empty()) {
+        const uint64_t m = good_states.size();
+        results.push_back(
+            measure("get_good_moves", sector_param, r, m, true, [&] {
+                uint64_t sum = 0;
+                for (const GameState &s : good_states) {
+                    Value v = VALUE_NONE;
+                    sum = sum * 31 + player.get_good_moves(s, v).size() +
+                          (uint64_t)(v + 1024);
+                }
+                return sum;
+            }));
+    }
+    results.push_back(measure("pd_evaluate", sector_param, r, n, true, [&] {
+        uint64_t sum = 0;
+        for (const BenchPosition &p : positions) {
+            int wdl = 0, steps = 0;
+            if (pd_evaluate(p.white, p.black, p.wf, p.bf, 0, 0, &wdl, &steps))
+                sum = sum * 31 + (uint64_t)(wdl + 1) * 1024 + steps;
+        }
+        return sum;
+    }));
+
+    FILE *out = stdout;
+    if (!o.out.empty() && FOPEN(&out, o.out.c_str(), "w") == -1) {
+        fprintf(stderr, "[perfect-db-bench] cannot write %s\n", o.out.c_str());
+        pd_deinit();
+        return 1;
+    }
+    write_json(out, o, results);
+    if (out != stdout)
+        fclose(out);
+
+    pd_deinit();
+    return 0;
+}
+
+} // namespace
+
+int Bench::piece_count_of(const std::string &variant)
+{
+    if (variant == "std")
+        return 9;
+    if (variant == "lask")
+        return 10;
+    if (variant == "mora")
+        return 12;
+    return 0;
+}
+
+bool Bench::parse_ints(const char *s, std::vector<int> &out)
+{
+    out.clear();
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        char *end = nullptr;
+        long v = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0')
+            return false;
+        out.push_back((int)v);
+    }
+    return !out.empty();
+}
+
+std::string Bench::json_escape(const std::string &s)
+{
+    std::string r;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            r += '\\';
+        r += c;
+    }
+    return r;
+}
+
+PD_API int pd_bench_main(int argc, char **argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "replay")
+        return replay_main(argc - 1, argv + 1);
+
+    BenchOptions o;
+    if (!parse_options(argc, argv, o))
+        return 2;
+    try {
+        return run(o);
+    } catch (...) {
+        fprintf(stderr, "[perfect-db-bench] unexpected exception\n");
+        return 1;
+    }
+}
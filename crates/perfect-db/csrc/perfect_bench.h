@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_bench.h
+//
+// Benchmark drivers of the oracle, only compiled with the `oracle-bench`
+// feature of the perfect-db crate and run through its `perfect-db-bench`
+// binary:
+//
+//   cargo run --release -p perfect-db --features oracle-bench
+//       --bin perfect-db-bench -- --db src/ui/flutter_app/assets/databases
+//
+// `perfect-db-bench replay ...` runs the end-to-end replay benchmark instead
+// (perfect_bench_replay.cpp). Results are written as a single JSON object (to
+// --out, or stdout).
+
+#ifndef PERFECT_BENCH_H_INCLUDED
+#define PERFECT_BENCH_H_INCLUDED
+
+#include "perfect_c_api.h"
+
+#include <string>
+#include <vector>
+
+extern "C" {
+
+// Times the oracle kernels (collapse, symmetries, hash construction and
+// lookup, sector reads, move generation, pd_evaluate) on positions drawn
+// with a fixed seed from the sample sectors. Returns the process exit code.
+PD_API int pd_bench_main(int argc, char **argv);
+}
+
+namespace Bench {
+
+// 9 for "std", 10 for "lask", 12 for "mora", 0 otherwise
+int piece_count_of(const std::string &variant);
+// "1,2,3" -> {1, 2, 3}
+bool parse_ints(const char *s, std::vector<int> &out);
+std::string json_escape(const std::string &s);
+
+// The replay benchmark; argv[0] is "replay".
+int replay_main(int argc, char **argv);
+
+} // namespace Bench
+
+#endif // PERFECT_BENCH_H_INCLUDED
@@ -0,0 +1,492 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_bench_replay.cpp
+//
+// End-to-end latency of the oracle as a player sees it: recorded games are
+// replayed ply by ply through MalomSolutionAccess::get_best_move and
+// get_detailed_evaluation, and the latency distribution of every ply phase
+// is reported for a cold start (fresh sector objects, no hash tables) and a
+// warm second pass, for each hash cache size of the sweep.
+//
+// Games file: one game per line, moves as in pd_best_move ("d6", "d6-d5",
+// "xg7" for the removal after a mill), separated by blanks. A line may start
+// with "start=white,black,whiteInHand,blackInHand,playerToMove" (bitboards in
+// perfect indices) to replay from a set-up position; '#' starts a comment.
+// Without --games, games are generated with a fixed seed by random playouts
+// from the initial position and from the endgame sectors of the database.
+
+#include "perfect_bench.h"
+
+#include "perfect_api.h"
+#include "perfect_common.h"
+#include "perfect_errors.h"
+#include "perfect_game_state.h"
+#include "perfect_init.h"
+#include "perfect_player.h"
+#include "perfect_rules.h"
+#include "perfect_stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Bench;
+
+namespace {
+
+struct ReplayOptions
+{
+    std::string db;
+    std::string variant {"std"};
+    std::string games;
+    std::string write_games;
+    std::string out;
+    uint64_t seed {1};
+    int generate {64};
+    int max_plies {40};
+    std::vector<int> cache_sizes {8};
+};
+
+// Position of a replayed game, in the terms of the pd_* queries.
+struct ReplayPosition
+{
+    int bits[2] {0, 0};
+    int hand[2] {0, 0};
+    int side {0};
+    bool kle {false};
+};
+
+struct ReplayGame
+{
+    ReplayPosition start;
+    std::vector<std::string> moves;
+};
+
+enum Phase { placing, moving, flying, kle, phase_count };
+const char *const phase_names[phase_count] = {"placing", "moving", "flying",
+                                              "kle"};
+
+enum Op { best_move, evaluation, op_count };
+const char *const op_names[op_count] = {"best_move", "evaluation"};
+
+// Same square names as pd_best_move, indexed by Square.
+const char *const square_names[32] = {
+    "",   "",   "",   "",   "",   "",   "",   "",   "d5", "e5", "e4",
+    "e3", "d3", "c3", "c4", "c5", "d6", "f6", "f4", "f2", "d2", "b2",
+    "b4", "b6", "d7", "g7", "g4", "g1", "d1", "a1", "a4", "a7"};
+
+std::string square_name(int idx)
+{
+    Square sq = from_perfect_square((uint32_t)idx);
+    return sq >= 0 && sq < 32 ? square_names[sq] : "";
+}
+
+int square_index(const std::string &name)
+{
+    for (int i = 0; i < 24; i++)
+        if (square_name(i) == name)
+            return i;
+    return -1;
+}
+
+ReplayPosition initial_position()
+{
+    ReplayPosition p;
+    p.hand[0] = p.hand[1] = Rules::maxKSZ;
+    return p;
+}
+
+int popcount24(int x)
+{
+    int c = 0;
+    for (; x; x &= x - 1)
+        c++;
+    return c;
+}
+
+Phase phase_of(const ReplayPosition &p)
+{
+    if (p.kle)
+        return kle;
+    if (p.hand[p.side] > 0)
+        return placing;
+    return popcount24(p.bits[p.side]) == 3 ? flying : moving;
+}
+
+bool closes_mill(const ReplayPosition &p, int to)
+{
+    GameState s;
+    for (int i = 0; i < 24; i++) {
+        if (p.bits[0] & (1 << i))
+            s.board[i] = 0;
+        if (p.bits[1] & (1 << i))
+            s.board[i] = 1;
+    }
+    return Rules::check_mill(to, s) != -1;
+}
+
+// Applies one move token. next is the following token (or empty): a mill
+// leads to a removal position only if the game continues with one.
+bool apply_move(ReplayPosition &p, const std::string &token,
+                const std::string &next)
+{
+    int &own = p.bits[p.side];
+    int &opp = p.bits[1 - p.side];
+    const int occupied = own | opp;
+
+    if (token[0] == 'x') {
+        int sq = square_index(token.substr(1));
+        if (!p.kle || sq < 0 || !(opp & (1 << sq)))
+            return false;
+        opp &= ~(1 << sq);
+        p.kle = false;
+        p.side = 1 - p.side;
+        return true;
+    }
+    if (p.kle)
+        return false;
+
+    int to;
+    size_t dash = token.find('-');
+    if (dash == std::string::npos) {
+        to = square_index(token);
+        if (to < 0 || (occupied & (1 << to)) || p.hand[p.side] == 0)
+            return false;
+        own |= 1 << to;
+        p.hand[p.side]--;
+    } else {
+        int from = square_index(token.substr(0, dash));
+        to = square_index(token.substr(dash + 1));
+        if (from < 0 || to < 0 || !(own & (1 << from)) ||
+            (occupied & (1 << to)))
+            return false;
+        own = (own & ~(1 << from)) | (1 << to);
+    }
+
+    if (closes_mill(p, to) && !next.empty() && next[0] == 'x')
+        p.kle = true;
+    else
+        p.side = 1 - p.side;
+    return true;
+}
+
+bool parse_game(const std::string &line, ReplayGame &g)
+{
+    std::stringstream ss(line.substr(0, line.find('#')));
+    std::string token;
+    g.start = initial_position();
+    g.moves.clear();
+    while (ss >> token) {
+        if (token.rfind("start=", 0) == 0) {
+            std::vector<int> v;
+            if (!g.moves.empty() || !parse_ints(token.c_str() + 6, v) ||
+                v.size() != 5)
+                return false;
+            g.start.bits[0] = v[0];
+            g.start.bits[1] = v[1];
+            g.start.hand[0] = v[2];
+            g.start.hand[1] = v[3];
+            g.start.side = v[4];
+        } else {
+            g.moves.push_back(token);
+        }
+    }
+    return true;
+}
+
+std::string move_tokens(const AdvancedMove &m)
+{
+    std::string t;
+    if (!m.onlyTaking) {
+        if (m.moveType == CMoveType::SlideMove)
+            t = square_name(m.from) + "-";
+        t += square_name(m.to);
+        if (!m.withTaking)
+            return t;
+        t += " ";
+    }
+    return t + "x" + square_name(m.takeHon);
+}
+
+// Random playouts with a fixed seed: every other game starts from the
+// initial position, the others from a random position of an endgame sector
+// (no stones in hand) that the database contains.
+std::vector<std::string> generate_games(const ReplayOptions &o)
+{
+    using namespace PerfectErrors;
+
+    std::vector<std::string> lines;
+    if (!pd_init_variant(o.db.c_str(), piece_count_of(o.variant)))
+        return lines;
+
+    PerfectPlayer player;
+    std::vector<Wrappers::WID> endgames;
+    for (auto &entry : player.secs) {
+        Wrappers::WID id = entry.first;
+        if (id.WF == 0 && id.BF == 0)
+            endgames.push_back(id);
+    }
+
+    std::mt19937_64 rng(o.seed);
+    for (int g = 0; g < o.generate; g++) {
+        int white = 0, black = 0, wh = Rules::maxKSZ, bh = Rules::maxKSZ;
+        std::string line;
+        if (g % 2 == 1 && !endgames.empty()) {
+            Wrappers::WID id = endgames[rng() % endgames.size()];
+            while (popcount24(white) < id.W)
+                white |= 1 << (rng() % 24);
+            while (popcount24(black) < id.B)
+                black |= (1 << (rng() % 24)) & ~white;
+            wh = bh = 0;
+            line = "start=" + std::to_string(white) + "," +
+                   std::to_string(black) + ",0,0,0";
+        }
+
+        GameState s;
+        if (!MalomSolutionAccess::make_query_state(white, black, wh, bh, 0,
+                                                   false, s))
+            continue;
+        for (int ply = 0; ply < o.max_plies && !s.over; ply++) {
+            std::vector<AdvancedMove> moves = player.get_move_list(s);
+            if (moves.empty())
+                break;
+            AdvancedMove m = moves[rng() % moves.size()];
+            clearError();
+            GameState next = player.make_move_in_state(s, m);
+            if (hasError())
+                break;
+            line += (line.empty() ? "" : " ") + move_tokens(m);
+            s = next;
+        }
+        lines.push_back(line);
+    }
+    clearError();
+    pd_deinit();
+    return lines;
+}
+
+struct PassResult
+{
+    int cache_size;
+    const char *pass;
+    std::vector<uint64_t> latency_ns[phase_count][op_count];
+    uint64_t queries {0};
+    uint64_t truncated {0};
+    pd_stats stats {};
+};
+
+// Replays every game once; a game is cut at its first query the database
+// cannot answer (the sample databases only hold a few sectors).
+void replay_pass(const std::vector<ReplayGame> &games, PassResult &r)
+{
+    using namespace PerfectErrors;
+
+    pd_reset_stats();
+    for (const ReplayGame &g : games) {
+        ReplayPosition p = g.start;
+        for (size_t i = 0; i < g.moves.size(); i++) {
+            Phase phase = phase_of(p);
+
+            Value v = VALUE_NONE;
+            uint64_t t0 = Stats::now_ns();
+            MalomSolutionAccess::get_best_move(p.bits[0], p.bits[1],
+                                               p.hand[0], p.hand[1], p.side,
+                                               p.kle, v, MOVE_NONE);
+            uint64_t t1 = Stats::now_ns();
+            bool failed = hasError();
+            MalomSolutionAccess::get_detailed_evaluation(
+                p.bits[0], p.bits[1], p.hand[0], p.hand[1], p.side, p.kle);
+            uint64_t t2 = Stats::now_ns();
+            failed = failed || hasError();
+            clearError();
+            if (failed) {
+                r.truncated++;
+                break;
+            }
+            r.latency_ns[phase][best_move].push_back(t1 - t0);
+            r.latency_ns[phase][evaluation].push_back(t2 - t1);
+            r.queries++;
+
+            const std::string next = i + 1 < g.moves.size() ? g.moves[i + 1] :
+                                                              "";
+            if (!apply_move(p, g.moves[i], next))
+                break;
+        }
+    }
+    pd_get_stats(&r.stats);
+}
+
+double percentile_us(const std::vector<uint64_t> &sorted, double q)
+{
+    if (sorted.empty())
+        return 0;
+    size_t rank = (size_t)(q * (double)sorted.size() + 0.999999);
+    rank = std::min(std::max(rank, (size_t)1), sorted.size());
+    return (double)sorted[rank - 1] / 1000.0;
+}
+
+void write_json(FILE *out, const ReplayOptions &o, size_t game_count,
+                std::vector<PassResult> &runs)
+{
+    fprintf(out,
+            "{\"schema\":\"perfect-db-replay/1\",\"db\":\"%s\","
+            "\"variant\":\"%s\",\"games\":%zu,\"seed\":%llu,\"runs\":[",
+            json_escape(o.db).c_str(), o.variant.c_str(), game_count,
+            (unsigned long long)o.seed);
+    for (size_t i = 0; i < runs.size(); i++) {
+        PassResult &r = runs[i];
+        fprintf(out,
+                "%s{\"cache_sectors\":%d,\"pass\":\"%s\",\"queries\":%llu,"
+                "\"truncated_games\":%llu,\"hash_misses\":%lld,"
+                "\"hash_evictions\":%lld,\"hash_build_ms\":%.1f,"
+                "\"bytes_read\":%lld,\"phases\":[",
+                i ? "," : "", r.cache_size, r.pass,
+                (unsigned long long)r.queries,
+                (unsigned long long)r.truncated, r.stats.hashMisses,
+                r.stats.hashEvictions, r.stats.hashBuildNs / 1e6,
+                r.stats.bytesRead);
+        bool first = true;
+        for (int ph = 0; ph < phase_count; ph++) {
+            for (int op = 0; op < op_count; op++) {
+                std::vector<uint64_t> &l = r.latency_ns[ph][op];
+                if (l.empty())
+                    continue;
+                std::sort(l.begin(), l.end());
+                fprintf(out,
+                        "%s{\"phase\":\"%s\",\"op\":\"%s\",\"count\":%zu,"
+                        "\"p50_us\":%.1f,\"p95_us\":%.1f,\"p99_us\":%.1f,"
+                        "\"max_us\":%.1f}",
+                        first ? "" : ",", phase_names[ph], op_names[op],
+                        l.size(), percentile_us(l, 0.50),
+                        percentile_us(l, 0.95), percentile_us(l, 0.99),
+                        (double)l.back() / 1000.0);
+                first = false;
+            }
+        }
+        fprintf(out, "]}");
+    }
+    fprintf(out, "]}\n");
+}
+
+bool parse_options(int argc, char **argv, ReplayOptions &o)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (a == "--db" && v) {
+            o.db = v;
+        } else if (a == "--variant" && v) {
+            o.variant = v;
+        } else if (a == "--games" && v) {
+            o.games = v;
+        } else if (a == "--write-games" && v) {
+            o.write_games = v;
+        } else if (a == "--out" && v) {
+            o.out = v;
+        } else if (a == "--seed" && v) {
+            o.seed = strtoull(v, nullptr, 10);
+        } else if (a == "--generate" && v) {
+            o.generate = atoi(v);
+        } else if (a == "--max-plies" && v) {
+            o.max_plies = atoi(v);
+        } else if (a == "--cache-sizes" && v &&
+                   parse_ints(v, o.cache_sizes)) {
+        } else {
+            fprintf(stderr,
+                    "[perfect-db-bench] unknown or incomplete option %s\n",
+                    a.c_str());
+            return false;
+        }
+        i++;
+    }
+    bool sizes_ok = std::all_of(o.cache_sizes.begin(), o.cache_sizes.end(),
+                                [](int n) { return n >= 1; });
+    if (o.db.empty() || piece_count_of(o.variant) == 0 || !sizes_ok) {
+        fprintf(stderr,
+                "usage: perfect-db-bench replay --db DIR [--variant "
+                "std|lask|mora] [--games FILE | --generate N --seed N "
+                "--max-plies N [--write-games FILE]] [--cache-sizes 2,4,8] "
+                "[--out FILE]\n");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int Bench::replay_main(int argc, char **argv)
+{
+    ReplayOptions o;
+    if (!parse_options(argc, argv, o))
+        return 2;
+
+    std::vector<std::string> lines;
+    if (!o.games.empty()) {
+        std::ifstream in(o.games);
+        if (!in) {
+            fprintf(stderr, "[perfect-db-bench] cannot read %s\n",
+                    o.games.c_str());
+            return 1;
+        }
+        for (std::string line; std::getline(in, line);)
+            lines.push_back(line);
+    } else {
+        lines = generate_games(o);
+        if (!o.write_games.empty()) {
+            std::ofstream w(o.write_games);
+            for (const std::string &line : lines)
+                w << line << '\n';
+        }
+    }
+
+    // Rules::maxKSZ is only known once a variant is loaded.
+    if (!pd_init_variant(o.db.c_str(), piece_count_of(o.variant))) {
+        fprintf(stderr, "[perfect-db-bench] cannot open %s database in %s\n",
+                o.variant.c_str(), o.db.c_str());
+        return 1;
+    }
+    std::vector<ReplayGame> games;
+    for (const std::string &line : lines) {
+        ReplayGame g;
+        if (!parse_game(line, g)) {
+            fprintf(stderr, "[perfect-db-bench] bad game line: %s\n",
+                    line.c_str());
+            pd_deinit();
+            return 1;
+        }
+        if (!g.moves.empty())
+            games.push_back(g);
+    }
+    pd_deinit();
+
+    std::vector<PassResult> runs;
+    for (int size : o.cache_sizes) {
+        pd_set_hash_cache_size(size);
+        if (!pd_init_variant(o.db.c_str(), piece_count_of(o.variant)))
+            return 1;
+        for (const char *pass : {"cold", "warm"}) {
+            runs.emplace_back();
+            runs.back().cache_size = size;
+            runs.back().pass = pass;
+            replay_pass(games, runs.back());
+        }
+        pd_deinit();
+    }
+    pd_set_hash_cache_size(8);
+
+    FILE *out = stdout;
+    if (!o.out.empty() && FOPEN(&out, o.out.c_str(), "w") == -1) {
+        fprintf(stderr, "[perfect-db-bench] cannot write %s\n", o.out.c_str());
+        return 1;
+    }
+    write_json(out, o, games.size(), runs);
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
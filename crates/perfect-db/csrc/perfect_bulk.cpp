@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_bulk.cpp
+
+#include "perfect_bulk.h"
+#include "perfect_sector_graph.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <set>
+
+namespace BulkSchedule {
+
+namespace {
+
+bool before(const Id &a, const Id &b)
+{
+    if (a.W != b.W)
+        return a.W < b.W;
+    if (a.B != b.B)
+        return a.B < b.B;
+    if (a.WF != b.WF)
+        return a.WF < b.WF;
+    return a.BF < b.BF;
+}
+
+std::mutex pinned_mutex;
+std::shared_ptr<const HashTables> pinned[25];
+
+} // namespace
+
+std::vector<Id> order(std::vector<Id> ids)
+{
+    std::sort(ids.begin(), ids.end(), before);
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    // Each (W, B) group in post-order of a depth-first walk over the
+    // successors inside the group, starting from its sectors in WF, BF
+    // order.
+    std::vector<Id> out;
+    out.reserve(ids.size());
+    for (size_t lo = 0, hi; lo < ids.size(); lo = hi) {
+        for (hi = lo + 1; hi < ids.size() && ids[hi].W == ids[lo].W &&
+                          ids[hi].B == ids[lo].B;
+             hi++) { }
+        const std::set<Id> group(ids.begin() + lo, ids.begin() + hi);
+        std::set<Id> visited;
+        std::function<void(const Id &)> visit = [&](const Id &u) {
+            if (!visited.insert(u).second)
+                return;
+            for (const Id &c : graph_func(u))
+                if (group.count(c))
+                    visit(c);
+            out.push_back(u);
+        };
+        for (size_t i = lo; i < hi; i++)
+            visit(ids[i]);
+    }
+    return out;
+}
+
+void Pin::hold(int W)
+{
+    if (W == held)
+        return;
+    release();
+    if (Hash::index_mode != HashIndexMode::tables || W < 0 || W > 24)
+        return;
+    // A failed allocation is reported by the Hash that needs the tables.
+    tables = HashTables::get(W);
+    held = W;
+}
+
+void Pin::release()
+{
+    tables.reset();
+    held = -1;
+}
+
+bool pin_tables(int W, bool pin)
+{
+    if (W < 0 || W > 24)
+        return false;
+    std::lock_guard<std::mutex> lock(pinned_mutex);
+    if (!pin) {
+        pinned[W].reset();
+        return true;
+    }
+    if (Hash::index_mode != HashIndexMode::tables)
+        return true;
+    if (!pinned[W])
+        pinned[W] = HashTables::get(W);
+    return pinned[W] != nullptr;
+}
+
+} // namespace BulkSchedule
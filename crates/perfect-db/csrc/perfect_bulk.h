@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_bulk.h
+//
+// Scheduling of work over many sectors (verification, sampling, external
+// loops over pd_open_sector) so that the hash tables are built as few times
+// as possible.
+//
+// In the tables mode every Hash needs the f tables of its W (about 112 MB,
+// shared through HashTables) and a g_inv table of its (W, B). The sectors
+// are therefore taken W by W, and B by B within a W; the sectors of one
+// (W, B) come successors first (graph_func), so that a sector finds the
+// successors it reads still in the hash cache, and otherwise by WF, BF.
+// While the sectors of a W are worked on, its tables are pinned, so that
+// evicting one of them from the hash cache does not free the tables under
+// the next one.
+
+#ifndef PERFECT_BULK_H_INCLUDED
+#define PERFECT_BULK_H_INCLUDED
+
+#include "perfect_common.h"
+#include "perfect_hash.h"
+
+#include <memory>
+#include <vector>
+
+namespace BulkSchedule {
+
+// ids in the order described above, each once.
+std::vector<Id> order(std::vector<Id> ids);
+
+// Holds the shared hash tables of one W (nothing in the compact mode).
+class Pin
+{
+    int held {-1};
+    std::shared_ptr<const HashTables> tables;
+
+public:
+    // Switches to the tables of W, building them if needed; the ones of the
+    // previous W are let go.
+    void hold(int W);
+    void release();
+};
+
+// Pins (pin) or unpins the tables of W for the callers outside the library
+// that open sectors one by one. Returns false if W is out of range or the
+// tables cannot be allocated.
+bool pin_tables(int W, bool pin);
+
+} // namespace BulkSchedule
+
+#endif // PERFECT_BULK_H_INCLUDED
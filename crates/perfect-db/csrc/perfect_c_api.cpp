@@ -2,8 +2,13 @@
 
 #include "perfect_c_api.h"
 
+#include "perfect_alloc.h"
+#include "perfect_compressed.h"
 #include "perfect_api.h"
+#include "perfect_async.h"
+#include "perfect_bulk.h"
 #include "perfect_init.h"
+#include "perfect_load_trace.h"
 #include "rule.h"
 #include "perfect_common.h"
 #include "perfect_errors.h"
@@ -11,13 +16,25 @@
 #include "perfect_player.h"
 #include "perfect_sec_val.h"
 #include "perfect_wrappers.h"
+#include "perfect_scan.h"
+#include "perfect_search.h"
 #include "perfect_sector.h"
+#include "perfect_solve.h"
+#include "perfect_stats.h"
+#include "perfect_summary.h"
+#include "perfect_trace.h"
+#include "perfect_verify.h"
 #include "perfect_hash.h"
 #include "option.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <exception>
+#include <thread>
 
 // TODO: ENABLE_BENCHMARK is not required
 #if defined(ENABLE_BENCHMARK)
@@ -31,10 +48,50 @@ static std::atomic<bool> g_pd_inited(false);
 static bool g_pd_inited = false;
 #endif // ENABLE_BENCHMARK
 
+namespace {
+
+// The pd_preload_profile worker. Each sector is loaded under the API mutex,
+// so queries interleave with the preload between sectors. g_preload_mutex
+// guards the thread handle against concurrent start, wait and stop.
+std::mutex g_preload_mutex;
+std::thread g_preload_thread;
+std::atomic<bool> g_preload_cancel(false);
+std::atomic<int> g_preloaded(0);
+
+void preload_sectors(std::vector<Id> ids)
+{
+    for (const Id &id : ids) {
+        if (g_preload_cancel.load(std::memory_order_relaxed))
+            break;
+        if (MalomSolutionAccess::preload_sector(id))
+            g_preloaded.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void stop_preload()
+{
+    std::lock_guard<std::mutex> lock(g_preload_mutex);
+    g_preload_cancel.store(true);
+    if (g_preload_thread.joinable())
+        g_preload_thread.join();
+    g_preload_cancel.store(false);
+}
+
+// Stops a preload still running when the process exits without pd_deinit:
+// destroying the joinable g_preload_thread would call std::terminate.
+struct PreloadAtExit
+{
+    ~PreloadAtExit() { stop_preload(); }
+} g_preload_at_exit;
+
+} // namespace
+
 extern "C" {
 
 static void reset_perfect_database_oracle()
 {
+    stop_preload();
+    PdAsync::stop();
     MalomSolutionAccess::deinitialize_if_needed();
     Sectors::reset();
     reset_sec_vals();
@@ -138,27 +195,41 @@ PD_API int pd_evaluate(int whiteBits, int blackBits, int whiteStonesToPlace,
     }
 }
 
-PD_API int pd_best_move(int whiteBits, int blackBits, int whiteStonesToPlace,
-                        int blackStonesToPlace, int playerToMove,
-                        int onlyStoneTaking, char *outBuf, int outBufLen)
+PD_API int pd_evaluate_wdl(int whiteBits, int blackBits,
+                           int whiteStonesToPlace, int blackStonesToPlace,
+                           int playerToMove, int onlyStoneTaking, int *outWdl)
 {
     try {
         using namespace PerfectErrors;
         clearError();
+
         if (!g_pd_inited)
             return 0;
-        if (!outBuf || outBufLen <= 4)
+
+        if (!outWdl)
             return 0;
 
-    // Ask C++ API for a best move bitboard
-    Value v = VALUE_UNKNOWN;
-    Move ref = MOVE_NONE;
-    int bb = MalomSolutionAccess::get_best_move(
-        whiteBits, blackBits, whiteStonesToPlace, blackStonesToPlace,
-        playerToMove, onlyStoneTaking != 0, v, ref);
-    if (bb == 0 && hasError())
+        int wdl = 0;
+        if (!MalomSolutionAccess::get_wdl(whiteBits, blackBits,
+                                          whiteStonesToPlace,
+                                          blackStonesToPlace, playerToMove,
+                                          onlyStoneTaking != 0, wdl))
+            return 0;
+
+        *outWdl = wdl;
+        return 1;
+    } catch (...) {
         return 0;
+    }
+}
 
+// The engine-style token of a move bitboard of get_best_move ("a1", "a1-a4"
+// or "xg7"), or "" if the bitboard is not a move of the side to move. A
+// removal after placing or moving is left out unless with_removal is set
+// ("a1xg7", "a1-a4xg7").
+static std::string move_token(int bb, int whiteBits, int blackBits,
+                              int playerToMove, bool with_removal = false)
+{
     auto popcnt = [](unsigned int x) {
         unsigned int c = 0;
         while (x) {
@@ -228,31 +299,74 @@ PD_API int pd_best_move(int whiteBits, int blackBits, int whiteStonesToPlace,
         } else if (fromIdx < 0 && toIdx >= 0 && remIdx >= 0) {
             // place + remove -> return place only
             token = idx_to_token(toIdx);
+            if (with_removal)
+                token += std::string("x") + idx_to_token(remIdx);
         }
     } else if (cnt == 3) {
         // move + remove -> return move token
         if (fromIdx >= 0 && toIdx >= 0) {
             token = idx_to_token(fromIdx) + std::string("-") +
                     idx_to_token(toIdx);
+            if (with_removal && remIdx >= 0)
+                token += std::string("x") + idx_to_token(remIdx);
         }
     }
 
-    if (token.empty())
-        return 0;
-    if ((int)token.size() + 1 > outBufLen)
-        return 0;
+    return token;
+}
+
+// pd_best_move, and pd_best_move_exact with outExact
+static int best_move(int whiteBits, int blackBits, int whiteStonesToPlace,
+                     int blackStonesToPlace, int playerToMove,
+                     int onlyStoneTaking, char *outBuf, int outBufLen,
+                     int *outExact)
+{
+    try {
+        using namespace PerfectErrors;
+        clearError();
+        if (!g_pd_inited)
+            return 0;
+        if (!outBuf || outBufLen <= 4)
+            return 0;
+
+        // Ask C++ API for a best move bitboard
+        Value v = VALUE_UNKNOWN;
+        Move ref = MOVE_NONE;
+        bool exact = true;
+        int bb = MalomSolutionAccess::get_best_move(
+            whiteBits, blackBits, whiteStonesToPlace, blackStonesToPlace,
+            playerToMove, onlyStoneTaking != 0, v, ref, &exact);
+        if (bb == 0 || hasError())
+            return 0;
+
+        std::string token = move_token(bb, whiteBits, blackBits, playerToMove);
+        if (token.empty())
+            return 0;
+        if ((int)token.size() + 1 > outBufLen)
+            return 0;
 #ifdef _WIN32
-    strncpy_s(outBuf, outBufLen, token.c_str(), _TRUNCATE);
+        strncpy_s(outBuf, outBufLen, token.c_str(), _TRUNCATE);
 #else
-    std::strncpy(outBuf, token.c_str(), outBufLen - 1);
-    outBuf[outBufLen - 1] = '\0';
+        std::strncpy(outBuf, token.c_str(), outBufLen - 1);
+        outBuf[outBufLen - 1] = '\0';
 #endif
+        if (outExact)
+            *outExact = exact ? 1 : 0;
         return 1;
     } catch (...) {
         return 0;
     }
 }
 
+PD_API int pd_best_move(int whiteBits, int blackBits, int whiteStonesToPlace,
+                        int blackStonesToPlace, int playerToMove,
+                        int onlyStoneTaking, char *outBuf, int outBufLen)
+{
+    return best_move(whiteBits, blackBits, whiteStonesToPlace,
+                     blackStonesToPlace, playerToMove, onlyStoneTaking, outBuf,
+                     outBufLen, nullptr);
+}
+
 // Structure for maintaining sector iteration state
 struct SectorIteratorState
 {
@@ -262,6 +376,8 @@ struct SectorIteratorState
     int total_count;
     Id sector_id;
     bool is_valid;
+    // Reads the evaluations ahead when opened in scan mode.
+    std::shared_ptr<SectorScan> scan;
 
     SectorIteratorState()
         : sector(nullptr)
@@ -275,6 +391,7 @@ struct SectorIteratorState
 // Global table for managing sector iterator handles
 static std::map<int, SectorIteratorState> g_sector_handles;
 static int g_next_handle_id = 1;
+static std::atomic<bool> g_sector_scan(false);
 
 PD_API int pd_open_sector(int W, int B, int WF, int BF)
 {
@@ -291,23 +408,12 @@ PD_API int pd_open_sector(int W, int B, int WF, int BF)
     sector_id.WF = WF;
     sector_id.BF = BF;
 
-    // Get or create sector
-    Sector *sector = sectors(sector_id);
-    if (!sector) {
-        // Try to create new sector
-        sector = new Sector(sector_id);
-        if (!sector) {
-            return 0;
-        }
-        sectors(sector_id) = sector;
-    }
-
-    // Ensure hash is allocated
-    if (!sector->hash) {
-        sector->allocate_hash();
-    }
+    AccessTrace::record(sector_id);
 
-    if (!sector->hash || !sector->hash->is_initialized()) {
+    // Loaded and pinned until pd_close_sector, so that queries and the
+    // preload do not evict it under the iterator.
+    Sector *sector = MalomSolutionAccess::open_sector(sector_id);
+    if (!sector) {
         return 0;
     }
 
@@ -319,6 +425,8 @@ PD_API int pd_open_sector(int W, int B, int WF, int BF)
     state.total_count = sector->hash->hash_count;
     state.sector_id = sector_id;
     state.is_valid = true;
+    if (g_sector_scan.load())
+        state.scan = std::make_shared<SectorScan>(sector);
 
     // Assign handle
     int handle = g_next_handle_id++;
@@ -331,7 +439,10 @@ PD_API int pd_close_sector(int handle)
 {
     auto it = g_sector_handles.find(handle);
     if (it != g_sector_handles.end()) {
+        Sector *sector = it->second.sector;
+        // The scan's reader thread stops before the pin is let go.
         g_sector_handles.erase(it);
+        MalomSolutionAccess::close_sector(sector);
         return 1; // Success
     }
     return 0; // Handle not found
@@ -383,8 +494,12 @@ PD_API int pd_sector_next(int handle, int *outWhiteBits, int *outBlackBits,
         int blackBits = (int)((b >> 24) & local_mask24); // High 24 bits
 
         // Get evaluation from sector (handle symmetry correctly)
-        eval_elem_sym2 eval_sym = state.sector->get_eval_inner(
-            state.current_index);
+        eval_elem_sym2 eval_sym {0, 0};
+        if (!state.scan) {
+            eval_sym = state.sector->get_eval_inner(state.current_index);
+        } else if (!state.scan->get(state.current_index, eval_sym)) {
+            return 0;
+        }
 
         // Handle symmetry cases like in perfect_hash.cpp
         if (eval_sym.cas() != eval_elem_sym2::Sym) {
@@ -432,4 +547,616 @@ PD_API int pd_sector_next(int handle, int *outWhiteBits, int *outBlackBits,
     // Reached end of iteration
     return 0;
 }
+
+PD_API int pd_set_large_pages(int mode, int numaReplicas)
+{
+    if (mode < (int)LargePageMode::none || mode > (int)LargePageMode::hugetlb)
+        return 0;
+
+    LargeAlloc::set_mode(static_cast<LargePageMode>(mode));
+    LargeAlloc::set_numa_replicas(numaReplicas != 0);
+    return 1;
+}
+
+PD_API int pd_get_alloc_stats(pd_alloc_stats *out)
+{
+    if (!out)
+        return 0;
+
+    LargeAllocStats st;
+    LargeAlloc::get_stats(&st);
+    out->allocations = (long long)st.allocations;
+    out->bytes = (long long)st.bytes;
+    out->hugetlbBytes = (long long)st.hugetlb_bytes;
+    out->thpAdvisedBytes = (long long)st.thp_bytes;
+    out->thpBackedBytes = (long long)st.thp_backed_bytes;
+    out->hugetlbFallbacks = (long long)st.hugetlb_fallbacks;
+    out->numaReplicas = (long long)st.numa_replicas;
+    out->numaNodes = st.numa_nodes;
+    return 1;
+}
+
+PD_API int pd_set_compressed_block_cache(int blocks)
+{
+    if (blocks < 1)
+        return 0;
+
+    CompressedSectorFile::cache_blocks = blocks;
+    return 1;
+}
+
+PD_API int pd_set_hash_cache_size(int sectors)
+{
+    if (sectors < 1)
+        return 0;
+
+    MalomSolutionAccess::set_hash_cache_capacity(sectors);
+    return 1;
+}
+
+PD_API int pd_get_stats(pd_stats *out)
+{
+    if (!out)
+        return 0;
+
+    uint64_t v[Stats::stat_count];
+    Stats::snapshot(v);
+    auto at = [&](Stat st) { return (long long)v[static_cast<int>(st)]; };
+    out->evaluations = at(Stat::evaluations);
+    out->bestMoveCalls = at(Stat::best_move_calls);
+    out->movesGenerated = at(Stat::moves_generated);
+    out->hashHits = at(Stat::hash_hits);
+    out->hashMisses = at(Stat::hash_misses);
+    out->hashEvictions = at(Stat::hash_evictions);
+    out->hashBuilds = at(Stat::hash_builds);
+    out->hashBuildNs = at(Stat::hash_build_ns);
+    out->bytesRead = at(Stat::bytes_read);
+    out->emSetLookups = at(Stat::em_set_lookups);
+    out->symRedirects = at(Stat::sym_redirects);
+    out->wdlPlaneLookups = at(Stat::wdl_plane_lookups);
+    out->pdMutexWaitNs = at(Stat::pd_mutex_wait_ns);
+    out->evalLockWaitNs = at(Stat::eval_lock_wait_ns);
+
+    out->loadedSectors = 0;
+    out->residentBytes = 0;
+    try {
+        std::vector<std::pair<Id, Sector::Residency>> loaded;
+        MalomSolutionAccess::get_sector_residency(loaded);
+        out->loadedSectors = (int)loaded.size();
+        for (const auto &entry : loaded)
+            out->residentBytes += (long long)entry.second.total();
+    } catch (...) {
+        return 0;
+    }
+    return 1;
+}
+
+PD_API int pd_reset_stats()
+{
+    Stats::reset();
+    return 1;
+}
+
+PD_API int pd_get_sector_residency(pd_sector_residency *out, int maxCount)
+{
+    if (maxCount > 0 && !out)
+        return -1;
+
+    try {
+        std::vector<std::pair<Id, Sector::Residency>> loaded;
+        MalomSolutionAccess::get_sector_residency(loaded);
+        for (int i = 0; i < (int)loaded.size() && i < maxCount; i++) {
+            const Id &id = loaded[i].first;
+            const Sector::Residency &r = loaded[i].second;
+            out[i].W = id.W;
+            out[i].B = id.B;
+            out[i].WF = id.WF;
+            out[i].BF = id.BF;
+            out[i].hashTableBytes = (long long)r.hash_bytes;
+            out[i].emSetEntries = (long long)r.em_set_entries;
+            out[i].emSetBytes = (long long)r.em_set_bytes;
+            out[i].wdlPlaneBytes = (long long)r.wdl_plane_bytes;
+            out[i].blockCacheBytes = (long long)r.block_cache_bytes;
+            out[i].totalBytes = (long long)r.total();
+        }
+        return (int)loaded.size();
+    } catch (...) {
+        return -1;
+    }
+}
+
+PD_API int pd_trace_enable(int enable)
+{
+    AccessTrace::set_enabled(enable != 0);
+    return 1;
+}
+
+PD_API int pd_trace_reset()
+{
+    AccessTrace::reset();
+    return 1;
+}
+
+PD_API int pd_trace_save(const char *path)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!path || !*path)
+        return -1;
+
+    try {
+        return AccessTrace::save_profile(path);
+    } catch (...) {
+        return -1;
+    }
+}
+
+PD_API int pd_preload_profile(const char *path, int topN, int background)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!g_pd_inited || !path || !*path)
+        return -1;
+
+    try {
+        std::vector<Id> ids;
+        if (!AccessTrace::load_profile(path, ids))
+            return -1;
+
+        // Loading more sectors than the hash cache holds would evict the
+        // hottest ones again.
+        int limit = Wrappers::hash_cache_capacity();
+        if (topN > 0)
+            limit = std::min(limit, topN);
+        if ((int)ids.size() > limit)
+            ids.resize(limit);
+
+        stop_preload();
+        std::lock_guard<std::mutex> lock(g_preload_mutex);
+        g_preloaded.store(0);
+        int queued = (int)ids.size();
+        if (background)
+            g_preload_thread = std::thread(preload_sectors, std::move(ids));
+        else
+            preload_sectors(std::move(ids));
+        return queued;
+    } catch (...) {
+        return -1;
+    }
+}
+
+PD_API int pd_preload_wait()
+{
+    try {
+        std::lock_guard<std::mutex> lock(g_preload_mutex);
+        if (g_preload_thread.joinable())
+            g_preload_thread.join();
+    } catch (...) {
+        return -1;
+    }
+    return g_preloaded.load();
+}
+
+PD_API int pd_set_hash_index_mode(int mode)
+{
+    if (mode < (int)HashIndexMode::tables ||
+        mode > (int)HashIndexMode::compact)
+        return 0;
+
+    Hash::index_mode = static_cast<HashIndexMode>(mode);
+    return 1;
+}
+
+PD_API int pd_submit(const pd_query *query, long long tag)
+{
+    if (!query)
+        return 0;
+
+    try {
+        return PdAsync::submit(*query, tag) ? 1 : 0;
+    } catch (...) {
+        return 0;
+    }
+}
+
+PD_API int pd_poll(pd_completion *out, int maxCount)
+{
+    if (!out)
+        return -1;
+
+    return PdAsync::poll(out, maxCount);
+}
+
+PD_API int pd_cancel(long long tag)
+{
+    try {
+        return PdAsync::cancel(tag);
+    } catch (...) {
+        return 0;
+    }
+}
+
+PD_API int pd_set_completion_callback(pd_completion_callback callback,
+                                      void *user)
+{
+    PdAsync::set_callback(callback, user);
+    return 1;
+}
+
+PD_API int pd_set_async_workers(int threads)
+{
+    if (threads < 1)
+        return 0;
+
+    PdAsync::set_workers(threads);
+    return 1;
+}
+
+PD_API int pd_sample(unsigned long long seed, int n,
+                     const pd_sample_filter *filter, pd_sample_entry *out)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!g_pd_inited || n < 0 || (n > 0 && !out))
+        return -1;
+
+    try {
+        SampleFilter f;
+        if (filter) {
+            f.W = filter->W;
+            f.B = filter->B;
+            f.WF = filter->WF;
+            f.BF = filter->BF;
+            f.wdl_mask = filter->wdlMask;
+            f.min_steps = filter->minSteps;
+            f.max_steps = filter->maxSteps;
+        }
+
+        std::vector<SampledPosition> samples;
+        if (!MalomSolutionAccess::sample(seed, n, f, samples))
+            return -1;
+
+        for (int i = 0; i < (int)samples.size(); i++) {
+            const SampledPosition &p = samples[i];
+            out[i].whiteBits = (int)(p.b & mask24);
+            out[i].blackBits = (int)((p.b >> 24) & mask24);
+            out[i].whiteStonesToPlace = p.id.WF;
+            out[i].blackStonesToPlace = p.id.BF;
+            out[i].W = p.id.W;
+            out[i].B = p.id.B;
+            out[i].WF = p.id.WF;
+            out[i].BF = p.id.BF;
+            out[i].wdl = p.wdl;
+            out[i].steps = p.steps;
+        }
+        return (int)samples.size();
+    } catch (...) {
+        return -1;
+    }
+}
+
+static void to_pd_summary(const Id &id, const SectorSummary::Summary &s,
+                          pd_summary *out)
+{
+    static_assert(sizeof(out->steps) == sizeof(s.steps), "");
+    out->W = id.W;
+    out->B = id.B;
+    out->WF = id.WF;
+    out->BF = id.BF;
+    out->entries = s.entries;
+    out->wins = s.wins;
+    out->draws = s.draws;
+    out->losses = s.losses;
+    out->symEntries = s.sym_entries;
+    out->countEntries = s.count_entries;
+    out->emSetEntries = s.em_set_entries;
+    for (int r = 0; r < 3; r++)
+        for (int i = 0; i < SectorSummary::step_buckets; i++)
+            out->steps[r][i] = s.steps[r][i];
+}
+
+PD_API int pd_sector_summary(int W, int B, int WF, int BF, pd_summary *out)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!g_pd_inited || !out)
+        return 0;
+
+    try {
+        Id id(W, B, WF, BF);
+        SectorSummary::Summary s;
+        if (!MalomSolutionAccess::summarize_sector(id, s))
+            return 0;
+        to_pd_summary(id, s, out);
+        return 1;
+    } catch (...) {
+        return 0;
+    }
+}
+
+PD_API int pd_database_summary(pd_summary *out, int maxCount)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!g_pd_inited || (maxCount > 0 && !out))
+        return -1;
+
+    try {
+        std::vector<Id> ids;
+        MalomSolutionAccess::get_sector_ids(ids);
+        SectorSummary::Summary s;
+        for (int i = 0; i < (int)ids.size(); i++) {
+            if (!MalomSolutionAccess::summarize_sector(ids[i], s))
+                return -1;
+            if (i < maxCount)
+                to_pd_summary(ids[i], s, &out[i]);
+        }
+        return (int)ids.size();
+    } catch (...) {
+        return -1;
+    }
+}
+
+static int run_verify(const std::vector<Id> &ids, int threads, int retrograde,
+                      pd_verify_report *report, pd_verify_issue *issues,
+                      int maxIssues)
+{
+    DatabaseVerify::Report r;
+    if (!MalomSolutionAccess::verify(ids, threads, retrograde != 0,
+                                     std::max(maxIssues, 0), r))
+        return -1;
+
+    for (int i = 0; i < (int)r.issues.size(); i++) {
+        const DatabaseVerify::Issue &e = r.issues[i];
+        pd_verify_issue &out = issues[i];
+        out.W = e.id.W;
+        out.B = e.id.B;
+        out.WF = e.id.WF;
+        out.BF = e.id.BF;
+        out.kind = static_cast<int>(e.kind);
+        out.index = e.index;
+        out.whiteBits = (int)(e.b & mask24);
+        out.blackBits = (int)((e.b >> 24) & mask24);
+        strncpy(out.message, e.message.c_str(), sizeof(out.message) - 1);
+        out.message[sizeof(out.message) - 1] = '\0';
+    }
+    if (report) {
+        report->sectorsChecked = r.sectors_checked;
+        report->sectorsSkipped = r.sectors_skipped;
+        report->positionsChecked = r.positions_checked;
+        report->mismatches = r.mismatches;
+    }
+    return (int)r.issues.size();
+}
+
+PD_API int pd_verify_sector(int W, int B, int WF, int BF, int threads,
+                            int retrograde, pd_verify_report *report,
+                            pd_verify_issue *issues, int maxIssues)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!g_pd_inited || (maxIssues > 0 && !issues))
+        return -1;
+
+    try {
+        return run_verify({Id(W, B, WF, BF)}, threads, retrograde, report,
+                          issues, maxIssues);
+    } catch (...) {
+        return -1;
+    }
+}
+
+PD_API int pd_verify_database(int threads, int retrograde,
+                              pd_verify_report *report,
+                              pd_verify_issue *issues, int maxIssues)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!g_pd_inited || (maxIssues > 0 && !issues))
+        return -1;
+
+    try {
+        return run_verify({}, threads, retrograde, report, issues, maxIssues);
+    } catch (...) {
+        return -1;
+    }
+}
+
+PD_API int pd_set_sector_solving(int onLookup, long long maxEntries,
+                                 int threads, int writeFiles)
+{
+    if (maxEntries < 1)
+        return 0;
+
+    SectorSolver::configure(onLookup != 0, maxEntries, threads,
+                            writeFiles != 0);
+    return 1;
+}
+
+PD_API int pd_solve_sector(int W, int B, int WF, int BF)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!g_pd_inited)
+        return 0;
+
+    try {
+        return MalomSolutionAccess::solve_sector(Id(W, B, WF, BF)) ? 1 : 0;
+    } catch (...) {
+        return 0;
+    }
+}
+
+PD_API void pd_set_search_fallback(int enabled, long long maxNodes, int maxMs)
+{
+    DbSearch::configure(enabled != 0, maxNodes, maxMs);
+}
+
+PD_API int pd_principal_variation(const pd_query *query, int maxPlies,
+                                  char (*outMoves)[16], pd_pv_eval *outEvals)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!g_pd_inited || !query || maxPlies < 0 || (maxPlies > 0 && !outMoves))
+        return -1;
+
+    try {
+        std::vector<PvPly> line;
+        if (!MalomSolutionAccess::principal_variation(
+                query->whiteBits, query->blackBits, query->whiteStonesToPlace,
+                query->blackStonesToPlace, query->playerToMove,
+                query->onlyStoneTaking != 0, maxPlies, line))
+            return -1;
+
+        for (size_t i = 0; i < line.size(); i++) {
+            const PvPly &p = line[i];
+            std::string token = move_token(p.move, p.whiteBits, p.blackBits,
+                                           p.sideToMove, true);
+            strncpy(outMoves[i], token.c_str(), sizeof(outMoves[i]) - 1);
+            outMoves[i][sizeof(outMoves[i]) - 1] = '\0';
+            if (outEvals) {
+                outEvals[i].wdl = p.wdl;
+                outEvals[i].steps = p.steps;
+            }
+        }
+        return (int)line.size();
+    } catch (...) {
+        return -1;
+    }
+}
+
+PD_API long long pd_build_opening_table(int plies, const char *path)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!g_pd_inited || plies < 1 || plies > 2 * Rules::maxKSZ)
+        return -1;
+
+    try {
+        return MalomSolutionAccess::build_opening_table(
+            plies, path ? std::string(path) : std::string());
+    } catch (...) {
+        return -1;
+    }
+}
+
+PD_API int pd_order_sectors(int *sectors, int count)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!g_pd_inited || count < 0 || (count > 0 && !sectors))
+        return -1;
+
+    try {
+        std::vector<Id> ids;
+        for (int i = 0; i < count; i++) {
+            const int *r = sectors + 4 * i;
+            ids.emplace_back(r[0], r[1], r[2], r[3]);
+        }
+        ids = BulkSchedule::order(ids);
+        for (size_t i = 0; i < ids.size(); i++) {
+            int *r = sectors + 4 * i;
+            r[0] = ids[i].W;
+            r[1] = ids[i].B;
+            r[2] = ids[i].WF;
+            r[3] = ids[i].BF;
+        }
+        return (int)ids.size();
+    } catch (...) {
+        return -1;
+    }
+}
+
+PD_API int pd_pin_hash_tables(int W, int pin)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    try {
+        return BulkSchedule::pin_tables(W, pin != 0) ? 1 : 0;
+    } catch (...) {
+        return 0;
+    }
+}
+
+PD_API void pd_set_load_callback(pd_load_callback callback, void *user)
+{
+    LoadTrace::set_callback(callback, user);
+}
+
+PD_API void pd_set_sector_scan(int enable)
+{
+    g_sector_scan.store(enable != 0);
+}
+
+PD_API int pd_canonical_index(const pd_query *positions, int count,
+                              pd_canonical *out)
+{
+    using namespace PerfectErrors;
+    clearError();
+
+    if (!g_pd_inited || count < 0 || (count > 0 && (!positions || !out)))
+        return -1;
+
+    try {
+        std::vector<GameState> states;
+        std::vector<int> slots;
+        states.reserve(count);
+        slots.reserve(count);
+        for (int i = 0; i < count; i++) {
+            const pd_query &q = positions[i];
+            out[i] = pd_canonical {-1, -1, -1, -1, -1, -1};
+            GameState s;
+            if (!MalomSolutionAccess::make_query_state(
+                    q.whiteBits, q.blackBits, q.whiteStonesToPlace,
+                    q.blackStonesToPlace, q.playerToMove,
+                    q.onlyStoneTaking != 0, s))
+                continue;
+            states.push_back(s);
+            slots.push_back(i);
+        }
+
+        std::vector<CanonicalIndex> entries;
+        const int resolved = MalomSolutionAccess::canonical_index(states,
+                                                                  entries);
+        if (resolved < 0)
+            return -1;
+        for (size_t k = 0; k < entries.size(); k++) {
+            const CanonicalIndex &c = entries[k];
+            if (c.index < 0)
+                continue;
+            pd_canonical &o = out[slots[k]];
+            o.W = c.id.W;
+            o.B = c.id.B;
+            o.WF = c.id.WF;
+            o.BF = c.id.BF;
+            o.index = c.index;
+            o.op = c.op;
+        }
+        return resolved;
+    } catch (...) {
+        return -1;
+    }
+}
+
+PD_API int pd_best_move_exact(int whiteBits, int blackBits,
+                              int whiteStonesToPlace, int blackStonesToPlace,
+                              int playerToMove, int onlyStoneTaking,
+                              char *outBuf, int outBufLen, int *outExact)
+{
+    return best_move(whiteBits, blackBits, whiteStonesToPlace,
+                     blackStonesToPlace, playerToMove, onlyStoneTaking, outBuf,
+                     outBufLen, outExact);
+}
 }
@@ -15,7 +15,8 @@ extern "C" {
 
 // Initialize a specific Perfect DB variant by piece count:
 // 9 = std, 10 = lask, 12 = mora.
-// db_path: directory containing <variant>_*.sec2 and <variant>.secval
+// db_path: directory containing <variant>_*.sec2 and <variant>.secval (or
+// the binary <variant>.secvalb written by `tgf mill db-secval`)
 // Returns 1 for success, 0 for failure
 PD_API int pd_init_variant(const char *db_path, int piece_count);
 
@@ -42,9 +43,22 @@ PD_API int pd_evaluate(int whiteBits, int blackBits, int whiteStonesToPlace,
                        int blackStonesToPlace, int playerToMove,
                        int onlyStoneTaking, int *outWdl, int *outSteps);
 
+// Win/draw/loss only, same inputs and perspective as pd_evaluate.
+// Sectors with a <variant>_W_B_WF_BF.wdl2 plane next to the .sec2 file
+// (generated by `tgf mill db-wdl`) are answered from the 2-bit plane without
+// reading the sector file; other sectors fall back to the full entry.
+// The result is the game-theoretic outcome: everything that is neither a
+// virtual win nor a virtual loss is a draw. pd_evaluate instead reports -1
+// for entries whose value refers to another sector.
+// Returns 1 if successful, 0 otherwise (including stone-removal positions)
+PD_API int pd_evaluate_wdl(int whiteBits, int blackBits, int whiteStonesToPlace,
+                           int blackStonesToPlace, int playerToMove,
+                           int onlyStoneTaking, int *outWdl);
+
 // Query a best move and return an engine-style token string
 // Output format: "a1" (place), "a1-a4" (move), "xg7" (remove)
-// Returns 1 for success, 0 for failure
+// Returns 1 for success, 0 for failure (also when the database misses a
+// sector the move depends on, unless pd_set_search_fallback is on)
 PD_API int pd_best_move(int whiteBits, int blackBits, int whiteStonesToPlace,
                         int blackStonesToPlace, int playerToMove,
                         int onlyStoneTaking, char *outBuf, int outBufLen);
@@ -61,4 +75,404 @@ PD_API int pd_sector_count(int handle);
 // Outputs canonical 24-bit bitboards and evaluation in (wdl, steps)
 PD_API int pd_sector_next(int handle, int *outWhiteBits, int *outBlackBits,
                           int *outWdl, int *outSteps);
+
+// Page placement of the hash lookup tables. Only affects tables built after
+// the call, so set it before pd_init_variant.
+// - mode: 0 = regular pages, 1 = transparent huge pages
+//   (madvise(MADV_HUGEPAGE)), 2 = explicit huge pages (MAP_HUGETLB, falls back
+//   to 1 when the hugetlb pool is empty)
+// - numaReplicas: non-zero keeps one copy of each table per NUMA node
+// Returns 1 for success, 0 for an unknown mode
+PD_API int pd_set_large_pages(int mode, int numaReplicas);
+
+// Counters of the large-table allocator, to check whether huge pages were
+// actually obtained. All byte counts refer to live allocations.
+struct pd_alloc_stats
+{
+    long long allocations;
+    long long bytes;
+    long long hugetlbBytes;      // backed by MAP_HUGETLB
+    long long thpAdvisedBytes;   // madvise(MADV_HUGEPAGE) accepted
+    long long thpBackedBytes;    // actually backed by THP (Linux smaps)
+    long long hugetlbFallbacks;  // MAP_HUGETLB requests that fell back
+    long long numaReplicas;      // replicas beyond the primary copy
+    int numaNodes;
+};
+
+// Returns 1 for success, 0 if out is null
+PD_API int pd_get_alloc_stats(pd_alloc_stats *out);
+
+// Number of decompressed blocks cached per open .sec2z sector (block-compressed
+// container written by `tgf mill db-compress`). Sectors stored as .sec2z are
+// used transparently when the .sec2 file is absent. Only affects sectors
+// opened after the call.
+// Returns 1 for success, 0 if blocks < 1
+PD_API int pd_set_compressed_block_cache(int blocks);
+
+// Number of sectors whose hash lookup tables (tens to hundreds of MB each)
+// stay in memory; the least recently used one is released to make room.
+// Default 8. Takes effect on the next sector load.
+// Returns 1 for success, 0 if sectors < 1
+PD_API int pd_set_hash_cache_size(int sectors);
+
+// Runtime counters of the oracle, summed over all threads since the last
+// pd_reset_stats. They are always collected; an increment costs a thread-local
+// load and store, and lock waits are only timed when the lock is contended.
+struct pd_stats
+{
+    long long evaluations;     // database entries decoded
+    long long bestMoveCalls;
+    long long movesGenerated;  // legal moves produced for best-move queries
+    long long hashHits;        // sector hash tables found in the LRU
+    long long hashMisses;      // sector hash tables that had to be built
+    long long hashEvictions;   // hash tables released to make room
+    long long hashBuilds;
+    long long hashBuildNs;
+    long long bytesRead;       // from .sec2, .sec2z and .wdl2 files
+    long long emSetLookups;    // entries resolved through the em_set
+    long long symRedirects;    // symmetric entries followed while hashing
+    long long wdlPlaneLookups; // pd_evaluate_wdl answers served from a plane
+    long long pdMutexWaitNs;   // time blocked on the API mutex
+    long long evalLockWaitNs;  // time blocked on the evaluation lock
+    int loadedSectors;         // sectors currently holding memory
+    long long residentBytes;   // memory held by those sectors
+};
+
+// Returns 1 for success, 0 if out is null
+PD_API int pd_get_stats(pd_stats *out);
+
+// Restarts all counters of pd_get_stats from zero. Always returns 1
+PD_API int pd_reset_stats();
+
+// Memory held by one loaded sector
+struct pd_sector_residency
+{
+    int W, B, WF, BF;
+    long long hashTableBytes;
+    long long emSetEntries;
+    long long emSetBytes;      // estimated from the map node size
+    long long wdlPlaneBytes;
+    long long blockCacheBytes; // .sec2z block cache
+    long long totalBytes;
+};
+
+// Fills out with up to maxCount loaded sectors.
+// Returns the number of loaded sectors (may exceed maxCount), or -1 on error
+PD_API int pd_get_sector_residency(pd_sector_residency *out, int maxCount);
+
+// Access trace of the sectors (off by default). While enabled, every sector
+// lookup of a query and every pd_open_sector is counted; tracing costs a
+// relaxed atomic increment per lookup. Always returns 1
+PD_API int pd_trace_enable(int enable);
+
+// Clears the counts of the trace. Always returns 1
+PD_API int pd_trace_reset();
+
+// Writes the traced counts as a text profile, one "W B WF BF count" line per
+// sector, hottest first. Profiles of several processes can be concatenated.
+// Returns the number of sectors written, or -1 on error
+PD_API int pd_trace_save(const char *path);
+
+// Loads the hash tables of the hottest sectors of a profile, hottest first,
+// and asks the OS to read their files ahead, so the first queries after a
+// restart do not pay for it. At most topN sectors (all if topN <= 0), and
+// never more than pd_set_hash_cache_size. With background != 0 the sectors
+// are loaded by a worker thread and the call returns immediately; queries
+// stay possible meanwhile. A new preload, pd_init_* or pd_deinit stops a
+// running one.
+// Returns the number of sectors queued, or -1 on error
+PD_API int pd_preload_profile(const char *path, int topN, int background);
+
+// Waits for a background preload to finish.
+// Returns the number of sectors preloaded by the last pd_preload_profile
+PD_API int pd_preload_wait();
+
+// How sector positions are mapped to indices. Only affects hash tables built
+// after the call, so set it before pd_init_variant.
+// - mode: 0 = lookup tables over all white masks (about 112 MB per white
+//   stone count in use, fastest), 1 = compact: only the symmetry orbits of
+//   the white masks are stored (a few hundred KB at most) and the rest is
+//   computed on every lookup. Both modes give the same indices.
+// Returns 1 for success, 0 for an unknown mode
+PD_API int pd_set_hash_index_mode(int mode);
+
+// Asynchronous queries. pd_submit queues a query for oracle-owned worker
+// threads and returns at once, so cold sector loads never block the caller;
+// results come back through pd_poll or the completion callback.
+struct pd_query
+{
+    int kind; // 0 = pd_evaluate, 1 = pd_evaluate_wdl, 2 = pd_best_move
+    int whiteBits, blackBits;
+    int whiteStonesToPlace, blackStonesToPlace;
+    int playerToMove;
+    int onlyStoneTaking;
+};
+
+struct pd_completion
+{
+    long long tag;  // as passed to pd_submit
+    int status;     // what the synchronous call returned (1 or 0), -1 if
+                    // cancelled before it ran
+    int errorCode;  // PerfectErrors code of a failed query, else 0
+    int wdl, steps; // kinds 0 and 1 (steps only for kind 0, else -1)
+    char move[16];  // kind 2, as written by pd_best_move
+};
+
+// Returns 1 if the query was queued, 0 for a null query or unknown kind
+PD_API int pd_submit(const pd_query *query, long long tag);
+
+// Moves up to maxCount completions to out, in completion order.
+// Returns the number written, or -1 if out is null
+PD_API int pd_poll(pd_completion *out, int maxCount);
+
+// Cancels the queued queries with the given tag (all queued queries if
+// tag < 0); a query that already started still completes normally. Each
+// cancelled query produces a completion with status -1.
+// Returns the number of cancelled queries
+PD_API int pd_cancel(long long tag);
+
+// Completion callback, called instead of queuing the completion for
+// pd_poll: on a worker thread for the queries that ran, and on the thread
+// of pd_cancel, before it returns, for the cancelled ones. It must not call
+// pd_init_* or pd_deinit. Pass null to go back to pd_poll.
+typedef void (*pd_completion_callback)(const pd_completion *completion,
+                                       void *user);
+// Always returns 1
+PD_API int pd_set_completion_callback(pd_completion_callback callback,
+                                      void *user);
+
+// Number of worker threads (default 1). Queries are serialized inside the
+// oracle, so extra workers only help while completions are being handled.
+// Takes effect on the next pd_submit; pd_deinit stops the workers, drops
+// queued queries and undelivered completions.
+// Returns 1 for success, 0 if threads < 1
+PD_API int pd_set_async_workers(int threads);
+
+// Random positions of the database, for training and evaluation sets.
+// Sector fields < 0 match any sector; wdlMask selects results by bit
+// (1 = loss, 2 = draw, 4 = win, 0 = all); if maxSteps >= 0, steps must lie
+// in [minSteps, maxSteps] (which excludes positions without a step count).
+// For stratified sets, call pd_sample once per stratum with its filter.
+struct pd_sample_filter
+{
+    int W, B, WF, BF;
+    int wdlMask;
+    int minSteps, maxSteps;
+};
+
+// A sampled position. White is the side to move; W, B, WF, BF is its sector.
+// wdl is the game-theoretic result as pd_evaluate_wdl reports it, steps as
+// pd_evaluate reports it.
+struct pd_sample_entry
+{
+    int whiteBits, blackBits;
+    int whiteStonesToPlace, blackStonesToPlace;
+    int W, B, WF, BF;
+    int wdl, steps;
+};
+
+// Draws up to n positions uniformly (with replacement) from the sectors that
+// pass the filter (null: all sectors): indices are drawn in proportion to the
+// sector sizes and looked up directly, so no sector is enumerated; symmetric
+// redirect entries are redrawn. The same seed gives the same samples. Rare
+// filters may yield fewer than n positions, as at most 64 * n indices are
+// drawn.
+// Returns the number of positions written to out, or -1 on error
+PD_API int pd_sample(unsigned long long seed, int n,
+                     const pd_sample_filter *filter, pd_sample_entry *out);
+
+// Statistics of one sector, decoded from its file by all cores without
+// loading the sector, and cached next to it as <variant>_W_B_WF_BF.sum2 when
+// the directory is writable. Results are classified as pd_evaluate_wdl does.
+struct pd_summary
+{
+    int W, B, WF, BF;
+    long long entries;      // positions stored (pd_sector_count)
+    long long wins, draws, losses; // of the entries that are not redirects
+    long long symEntries;   // redirects to a symmetric entry
+    long long countEntries; // draws stored as a count (no step count)
+    long long emSetEntries; // values too large for the 3-byte record
+    // Step counts of the other entries by result (index wdl + 1), one bucket
+    // per step; the last bucket also counts longer ones.
+    long long steps[3][256];
+};
+
+// Returns 1 for success, 0 if the database is not initialized or the sector
+// cannot be read
+PD_API int pd_sector_summary(int W, int B, int WF, int BF, pd_summary *out);
+
+// Summarizes every sector of the database (computing the missing caches) and
+// writes up to maxCount summaries to out.
+// Returns the number of sectors (may exceed maxCount), or -1 on error
+PD_API int pd_database_summary(pd_summary *out, int maxCount);
+
+// Integrity check of the database files. Every sector's header, size and
+// em_set are checked; with retrograde set, every stored value is also
+// recomputed from the values of its children and compared, with the hash
+// range split across threads (<= 0: all cores). That pass skips sectors whose
+// successor sectors are missing, and other queries wait while a sector is
+// being checked.
+struct pd_verify_report
+{
+    long long sectorsChecked;
+    long long sectorsSkipped;   // by the retrograde pass
+    long long positionsChecked; // by the retrograde pass
+    long long mismatches;       // values that differ or cannot be read
+};
+
+// kind: 1 header field, 2 file size, 3 em_set index, 4 value mismatch,
+// 5 unreadable. index is the hash index (-1 for file-level issues) and the
+// bitboards the position there, with white to move.
+struct pd_verify_issue
+{
+    int W, B, WF, BF;
+    int kind;
+    long long index;
+    int whiteBits, blackBits;
+    char message[96];
+};
+
+// Checks one sector and writes up to maxIssues of its first issues, file
+// issues first and then by hash index.
+// Returns the number of issues written, or -1 on error
+PD_API int pd_verify_sector(int W, int B, int WF, int BF, int threads,
+                            int retrograde, pd_verify_report *report,
+                            pd_verify_issue *issues, int maxIssues);
+
+// Checks every sector of the database, in sector order.
+// Returns the number of issues written, or -1 on error
+PD_API int pd_verify_database(int threads, int retrograde,
+                              pd_verify_report *report,
+                              pd_verify_issue *issues, int maxIssues);
+
+// Retrograde solving of sectors that are missing from the database, in
+// memory. With onLookup != 0, a query that reaches a missing sector solves it
+// (and the missing sectors it depends on) on the spot, as long as at most
+// maxEntries positions are solved at once: a sector, or a sector together
+// with its missing partner (the sides swapped). A few million positions take
+// seconds. threads <= 0 uses all cores. With writeFiles != 0 the solved
+// sectors are also saved as .sec2 files in the database directory, where the
+// next pd_init_* finds them. Solved sectors stay in memory until pd_deinit.
+// Default: off, 16M positions.
+// Returns 1 for success, 0 if maxEntries < 1
+PD_API int pd_set_sector_solving(int onLookup, long long maxEntries,
+                                 int threads, int writeFiles);
+
+// Solves a sector now if it is missing from the database (whether or not
+// onLookup is set), within the limit of pd_set_sector_solving.
+// Returns 1 if the sector is available, 0 if it is too large or cannot be
+// solved, or the database is not initialized
+PD_API int pd_solve_sector(int W, int B, int WF, int BF);
+
+// With enabled != 0, pd_best_move falls back to a bounded alpha-beta search
+// when the database misses a sector of the position or of its successors:
+// the search expands the moves until it reaches positions whose sectors are
+// present, and scores those with their exact values. maxNodes and maxMs bound
+// each search (<= 0: no bound on that); the moves found are then the best
+// for the depth reached, and exact only if no estimate was needed.
+// Default: off, 1M nodes, 1000 ms.
+PD_API void pd_set_search_fallback(int enabled, long long maxNodes,
+                                   int maxMs);
+
+struct pd_pv_eval
+{
+    int wdl;   // 1 = win, 0 = draw, -1 = loss, as pd_evaluate_wdl
+    int steps; // plies to the win or loss, -1 for draws
+};
+
+// The perfect-play line from the position of a query (its kind is ignored)
+// in one call, instead of a pd_best_move per ply: at every ply the move that
+// wins quickest or loses slowest, the first in move order among equal ones,
+// so that the line is the same on every call. outMoves[i] gets the move of
+// ply i as pd_best_move writes it, followed by the removal when it closes a
+// mill ("a1xg7", "a1-a4xg7"), and outEvals[i] (unless outEvals is null) the
+// evaluation of the position before it. The line ends before maxPlies
+// when the game is over, which includes the draw by the move limit.
+// Returns the number of plies written, or -1 for an invalid position, a
+// failed lookup (a missing sector) or a database that is not initialized
+PD_API int pd_principal_variation(const pd_query *query, int maxPlies,
+                                  char (*outMoves)[16], pd_pv_eval *outEvals);
+
+// Precomputes the best moves of every position reached in fewer than plies
+// plies from the empty board into an opening table (path, or
+// <variant>.opening in the database directory if null), which pd_best_move
+// then consults before reading any sector: the table at path until
+// pd_deinit, <variant>.opening from then on as well. Positions are stored
+// once per board symmetry. Needs the sectors of those plies and their
+// successors.
+// Returns the number of positions, or -1 if plies is not in 1..2 * pieces,
+// a sector is missing, the file cannot be written or the database is not
+// initialized
+PD_API long long pd_build_opening_table(int plies, const char *path);
+
+// Reorders count sectors, given as {W, B, WF, BF} records, for a loop that
+// opens them one by one: W by W and B by B, so that the hash tables of a W
+// are built once, and within a (W, B) the successors first. Duplicates are
+// dropped. The successors are those of the rules of the database.
+// Returns the number of records left, or -1 if sectors is null, the
+// database is not initialized or memory runs out
+PD_API int pd_order_sectors(int *sectors, int count);
+
+// With pin != 0, keeps the hash tables shared by the sectors of W (about
+// 112 MB) until pd_pin_hash_tables(W, 0), even while none of them is open;
+// with the sectors in the order of pd_order_sectors, pin each W before its
+// first sector and unpin it after its last. Nothing is held in the compact
+// index mode.
+// Returns 1 for success, 0 if W is not in 0..24 or the tables cannot be
+// allocated
+PD_API int pd_pin_hash_tables(int W, int pin);
+
+// Phases of a sector load, as passed to the load callback
+#define PD_LOAD_OPEN 0       // opening the .sec2/.sec2z file
+#define PD_LOAD_HEADER 1     // reading and checking its header
+#define PD_LOAD_EVAL_MAP 2   // mapping the evaluations into memory
+#define PD_LOAD_EM_SET 3     // reading the em_set
+#define PD_LOAD_HASH_BUILD 4 // building the hash tables of the sector
+
+// Load callback, called on the loading thread when a phase of a sector load
+// ends, with the sector and the nanoseconds the phase took. Loads happen
+// inside queries, so it must not call back into pd_*. Pass null to stop the
+// reports (the default); sector loads print nothing either way.
+typedef void (*pd_load_callback)(int W, int B, int WF, int BF, int phase,
+                                 long long elapsedNs, void *user);
+PD_API void pd_set_load_callback(pd_load_callback callback, void *user);
+
+// With enable != 0, the sectors opened afterwards by pd_open_sector are read
+// for pd_sector_next in large chunks by a background thread, one chunk ahead
+// of the decoding, with the OS told to read ahead; meant for walking whole
+// sectors. Off by default, which reads each entry on its own. Handles must
+// be closed before pd_deinit either way.
+PD_API void pd_set_sector_scan(int enable);
+
+// The database entry of a position: the sector (white is the side to move,
+// as in pd_sample_entry), the hash index inside it, and the symmetry op
+// (0..15, 15 = the identity) that takes the position, with the side to move
+// as white, to the board stored at that index. Symmetric positions get the
+// same W, B, WF, BF and index; index is -1 for a position without an entry.
+struct pd_canonical
+{
+    int W, B, WF, BF;
+    int index;
+    int op;
+};
+
+// Fills out[i] with the entry of positions[i] (the kind of a query is
+// ignored), resolving the symmetry redirects of the sectors without reading
+// any evaluation: only the hash tables are built, the sector files are not
+// opened. Invalid and finished positions, stone-removal positions and
+// positions of missing sectors get index -1; the others can be deduplicated
+// by sorting on (W, B, WF, BF, index).
+// Returns the number of positions resolved, or -1 if positions or out is
+// null or the database is not initialized
+PD_API int pd_canonical_index(const pd_query *positions, int count,
+                              pd_canonical *out);
+
+// pd_best_move that also sets *outExact (unless null) to 1 if the move is
+// proven by the database, and to 0 if the search fallback of
+// pd_set_search_fallback ran out of budget and had to estimate.
+// Returns 1 for success, 0 for failure
+PD_API int pd_best_move_exact(int whiteBits, int blackBits,
+                              int whiteStonesToPlace, int blackStonesToPlace,
+                              int playerToMove, int onlyStoneTaking,
+                              char *outBuf, int outBufLen, int *outExact);
 }
@@ -9,6 +9,10 @@
 
 #include <string>
 
+#if defined(__linux__) || defined(__ANDROID__)
+#include <fcntl.h>
+#endif
+
 std::string secValPath = ".";
 std::string secValFileName = "";
 FILE *f = nullptr;
@@ -20,6 +24,41 @@ int maxKsz;
 sec_val secValMinValue;
 std::string ruleVariantName;
 
+int64_t file_size(const std::string &path)
+{
+    FILE *file = nullptr;
+    if (FOPEN(&file, path.c_str(), "rb") == -1 || !file)
+        return -1;
+#ifdef _WIN32
+    int64_t size = _fseeki64(file, 0, SEEK_END) == 0 ? _ftelli64(file) : -1;
+#else
+    int64_t size = fseeko(file, 0, SEEK_END) == 0 ? (int64_t)ftello(file) :
+                                                     -1;
+#endif
+    fclose(file);
+    return size;
+}
+
+void prefetch_file(FILE *file)
+{
+#if defined(__linux__) || defined(__ANDROID__)
+    if (file)
+        posix_fadvise(fileno(file), 0, 0, POSIX_FADV_WILLNEED);
+#else
+    (void)file;
+#endif
+}
+
+void advise_sequential_file(FILE *file)
+{
+#if defined(__linux__) || defined(__ANDROID__)
+    if (file)
+        posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#else
+    (void)file;
+#endif
+}
+
 void fail_with(std::string s)
 {
     SET_ERROR_MESSAGE(PerfectErrors::PE_RUNTIME_ERROR,
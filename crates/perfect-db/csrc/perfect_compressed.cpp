@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_compressed.cpp
+
+#include "perfect_compressed.h"
+#include "perfect_common.h"
+#include "perfect_errors.h"
+#include "perfect_stats.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <zstd.h>
+
+int CompressedSectorFile::cache_blocks = 16;
+
+static const char compressed_magic[4] = {'S', 'M', 'Z', '2'};
+static const int compressed_fixed_header_size = 24;
+
+static bool seek64(FILE *file, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool file_size(FILE *file, uint64_t &size)
+{
+#ifdef _WIN32
+    if (_fseeki64(file, 0, SEEK_END) != 0)
+        return false;
+    const long long end = _ftelli64(file);
+#else
+    if (fseeko(file, 0, SEEK_END) != 0)
+        return false;
+    const off_t end = ftello(file);
+#endif
+    if (end < 0)
+        return false;
+    size = (uint64_t)end;
+    return true;
+}
+
+static uint32_t read_le32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read_le64(const unsigned char *p)
+{
+    return (uint64_t)read_le32(p) | ((uint64_t)read_le32(p + 4) << 32);
+}
+
+CompressedSectorFile *CompressedSectorFile::open(const std::string &path)
+{
+    FILE *file = nullptr;
+    if (FOPEN(&file, path.c_str(), "rb") == -1) {
+        SET_ERROR_CODE(PerfectErrors::PE_FILE_NOT_FOUND,
+                       "Failed to open compressed sector file");
+        return nullptr;
+    }
+
+    unsigned char h[compressed_fixed_header_size];
+    if (fread(h, 1, sizeof(h), file) != sizeof(h) ||
+        memcmp(h, compressed_magic, 4) != 0 || read_le32(h + 4) != version ||
+        read_le32(h + 8) == 0) {
+        fclose(file);
+        SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR,
+                       "Invalid compressed sector header");
+        return nullptr;
+    }
+
+    auto *z = new CompressedSectorFile();
+    z->file = file;
+    z->block_size = read_le32(h + 8);
+    uint32_t block_count = read_le32(h + 12);
+    z->raw_size = read_le64(h + 16);
+
+    // The index is checked against the size of the file before it is
+    // allocated, so that a corrupt block count cannot ask for gigabytes.
+    const uint64_t index_end = compressed_fixed_header_size +
+                               ((uint64_t)block_count + 1) * 8;
+    uint64_t size = 0;
+    if (!file_size(file, size) || index_end > size ||
+        !seek64(file, compressed_fixed_header_size) ||
+        (uint64_t)block_count * z->block_size < z->raw_size) {
+        delete z;
+        SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR,
+                       "Truncated compressed sector index");
+        return nullptr;
+    }
+    std::vector<unsigned char> index((size_t)(index_end -
+                                              compressed_fixed_header_size));
+    if (fread(index.data(), 1, index.size(), file) != index.size()) {
+        delete z;
+        SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR,
+                       "Truncated compressed sector index");
+        return nullptr;
+    }
+    z->offsets.resize((size_t)block_count + 1);
+    for (size_t i = 0; i < z->offsets.size(); i++) {
+        z->offsets[i] = read_le64(&index[i * 8]);
+        // The blocks follow the index in order and end within the file.
+        if ((i == 0 && z->offsets[i] < index_end) ||
+            (i > 0 && z->offsets[i] < z->offsets[i - 1]) ||
+            z->offsets[i] > size) {
+            delete z;
+            SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR,
+                           "Corrupt compressed sector index");
+            return nullptr;
+        }
+    }
+
+    z->dctx = ZSTD_createDCtx();
+    z->cache.resize(cache_blocks > 0 ? cache_blocks : 1);
+    return z;
+}
+
+size_t CompressedSectorFile::resident_bytes() const
+{
+    size_t n = compressed.capacity() + offsets.capacity() * sizeof(uint64_t);
+    for (const auto &c : cache)
+        n += c.data.capacity();
+    return n;
+}
+
+void CompressedSectorFile::prefetch()
+{
+    prefetch_file(file);
+}
+
+void CompressedSectorFile::advise_sequential()
+{
+    advise_sequential_file(file);
+}
+
+CompressedSectorFile::~CompressedSectorFile()
+{
+    if (dctx)
+        ZSTD_freeDCtx(static_cast<ZSTD_DCtx *>(dctx));
+    if (file)
+        fclose(file);
+}
+
+const CompressedSectorFile::CachedBlock *
+CompressedSectorFile::load_block(uint64_t b)
+{
+    use_counter++;
+
+    CachedBlock *victim = &cache[0];
+    for (auto &c : cache) {
+        if (c.index == (int64_t)b) {
+            c.last_use = use_counter;
+            return &c;
+        }
+        if (c.last_use < victim->last_use)
+            victim = &c;
+    }
+
+    uint64_t csize = offsets[b + 1] - offsets[b];
+    uint64_t usize = b + 1 < offsets.size() - 1 ?
+                         block_size :
+                         raw_size - (uint64_t)block_size * b;
+
+    compressed.resize(csize);
+    victim->data.resize(usize);
+    victim->index = -1;
+    if (!seek64(file, offsets[b]) ||
+        fread(compressed.data(), 1, csize, file) != csize) {
+        SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR,
+                       "Failed to read compressed sector block");
+        return nullptr;
+    }
+    bytes_read += csize;
+    Stats::add(Stat::bytes_read, csize);
+
+    size_t r = ZSTD_decompressDCtx(static_cast<ZSTD_DCtx *>(dctx),
+                                   victim->data.data(), usize,
+                                   compressed.data(), csize);
+    if (ZSTD_isError(r) || r != usize) {
+        SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR,
+                       "Failed to decompress sector block");
+        return nullptr;
+    }
+    blocks_decompressed++;
+
+    victim->index = (int64_t)b;
+    victim->last_use = use_counter;
+    return victim;
+}
+
+bool CompressedSectorFile::read(uint64_t offset, void *buf, size_t n)
+{
+    if (offset + n > raw_size) {
+        SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR,
+                       "Read past the end of a compressed sector");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto *out = static_cast<unsigned char *>(buf);
+    while (n > 0) {
+        uint64_t b = offset / block_size;
+        uint64_t in_block = offset % block_size;
+        const CachedBlock *c = load_block(b);
+        if (!c)
+            return false;
+        size_t take = (size_t)std::min<uint64_t>(n, c->data.size() - in_block);
+        memcpy(out, c->data.data() + in_block, take);
+        out += take;
+        offset += take;
+        n -= take;
+    }
+    return true;
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_compressed.h
+//
+// Reader for the seekable block-compressed sector container (.sec2z) written
+// by `tgf mill db-compress`. The container holds the bytes of a .sec2 file
+// split into fixed-size blocks that are zstd-compressed independently:
+//
+//   0   char[4] magic "SMZ2"
+//   4   u32     version (1)
+//   8   u32     block size (uncompressed bytes per block, last may be short)
+//   12  u32     block count
+//   16  u64     size of the original .sec2 file
+//   24  u64     offsets[block count + 1] of the compressed blocks
+//
+// All integers are little-endian. Reads are random access at block
+// granularity through a small cache of decompressed blocks, and may come
+// from several threads.
+
+#ifndef PERFECT_COMPRESSED_H_INCLUDED
+#define PERFECT_COMPRESSED_H_INCLUDED
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class CompressedSectorFile
+{
+    FILE *file {nullptr};
+    void *dctx {nullptr};
+
+    uint32_t block_size {0};
+    uint64_t raw_size {0};
+    std::vector<uint64_t> offsets;
+
+    struct CachedBlock
+    {
+        int64_t index {-1};
+        uint64_t last_use {0};
+        std::vector<unsigned char> data;
+    };
+    std::vector<CachedBlock> cache;
+    std::vector<unsigned char> compressed;
+    uint64_t use_counter {0};
+
+    // Guards the block cache and the file position: a sector may be read by
+    // several threads (see perfect_verify.h).
+    std::mutex mutex;
+
+    const CachedBlock *load_block(uint64_t b);
+
+    CompressedSectorFile() { }
+
+public:
+    static const uint32_t version = 1;
+
+    // Number of decompressed blocks kept per open file.
+    static int cache_blocks;
+
+    // Returns nullptr (and sets an error) if the file cannot be opened or is
+    // not a valid container.
+    static CompressedSectorFile *open(const std::string &path);
+
+    ~CompressedSectorFile();
+
+    // Reads n bytes at the given offset of the original .sec2 file.
+    bool read(uint64_t offset, void *buf, size_t n);
+
+    uint64_t size() const { return raw_size; }
+    uint64_t compressed_size() const { return offsets.back(); }
+
+    // Memory held by the block cache and the offset index.
+    size_t resident_bytes() const;
+
+    // Asks the OS to start reading the file into the page cache.
+    void prefetch();
+
+    // Tells the OS that the file will be read front to back.
+    void advise_sequential();
+
+    // Bytes read from disk and blocks decompressed since opening.
+    uint64_t bytes_read {0};
+    uint64_t blocks_decompressed {0};
+};
+
+#endif // PERFECT_COMPRESSED_H_INCLUDED
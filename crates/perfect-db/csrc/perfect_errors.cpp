@@ -6,6 +6,7 @@
 
 #include "perfect_errors.h"
 #include "perfect_log.h"
+#include <cstdio>
 #include <iostream>
 #include <sstream>
 
@@ -37,19 +38,46 @@ void setError(ErrorCode code, const std::string &message, const char *file,
     // Only set the error if no other error has been recorded
     if (context->code == PE_NO_ERROR) {
         context->code = code;
+        context->text = nullptr;
+        context->subject = nullptr;
+        context->value_count = 0;
         context->message = message;
         context->file = file;
         context->line = line;
     }
 }
 
-// Clear the error for the current thread.
+void setStaticError(ErrorCode code, const char *text, const char *file,
+                    int line, const char *subject, int value_count,
+                    const long long *values)
+{
+    ErrorContext *context = get_error_context();
+    if (context->code == PE_NO_ERROR) {
+        context->code = code;
+        context->text = text;
+        context->subject = subject;
+        context->value_count = value_count;
+        for (int i = 0; i < value_count; i++)
+            context->values[i] = values[i];
+        context->file = file;
+        context->line = line;
+    }
+}
+
+// Clear the error for the current thread. Runs at every API entry, so it
+// does nothing (and keeps the capacity of message) if there is no error.
 void clearError()
 {
-    get_error_context()->code = PE_NO_ERROR;
-    get_error_context()->message.clear();
-    get_error_context()->file = nullptr;
-    get_error_context()->line = 0;
+    ErrorContext *context = get_error_context();
+    if (context->code == PE_NO_ERROR)
+        return;
+    context->code = PE_NO_ERROR;
+    context->text = nullptr;
+    context->subject = nullptr;
+    context->value_count = 0;
+    context->message.clear();
+    context->file = nullptr;
+    context->line = 0;
 }
 
 // Get a constant reference to the error context for the current thread.
@@ -63,7 +91,19 @@ std::string getLastErrorMessage()
     std::stringstream ss;
     const auto &context = getErrorContext();
     if (context.code != PE_NO_ERROR) {
-        ss << "Error (code " << context.code << "): " << context.message;
+        ss << "Error (code " << context.code << "): ";
+        if (context.subject)
+            ss << context.subject << " ";
+        if (context.text && context.value_count > 0) {
+            char buffer[512];
+            snprintf(buffer, sizeof(buffer), context.text, context.values[0],
+                     context.values[1], context.values[2]);
+            ss << buffer;
+        } else if (context.text) {
+            ss << context.text;
+        } else {
+            ss << context.message;
+        }
         if (context.file) {
             ss << " at " << context.file << ":" << context.line;
         }
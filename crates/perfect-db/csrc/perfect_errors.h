@@ -7,6 +7,7 @@
 #ifndef PERFECT_ERRORS_H
 #define PERFECT_ERRORS_H
 
+#include <cstddef>
 #include <fstream>
 #include <string>
 
@@ -26,9 +27,20 @@ enum ErrorCode {
     PE_OUT_OF_MEMORY
 };
 
+// An error is recorded without allocating when its text is static
+// (setStaticError, SET_STATIC_ERROR, SET_ERROR_VALUES): text is then kept by
+// pointer, and the message is only put together by getLastErrorMessage.
+// Errors set with setError keep a copy in message instead.
 struct ErrorContext
 {
     ErrorCode code = PE_NO_ERROR;
+    // A static text, or nullptr if the text is in message. With values, a
+    // printf format of that many long longs.
+    const char *text = nullptr;
+    // Static as well, put before the text (the parameter of checkRange).
+    const char *subject = nullptr;
+    int value_count = 0;
+    long long values[3] = {0, 0, 0};
     std::string message;
     const char *file = nullptr;
     int line = 0;
@@ -40,11 +52,24 @@ void cleanup_thread_local_storage();
 // Core functions
 void setError(ErrorCode code, const std::string &message, const char *file,
               int line);
+// text (and subject) must outlive the error; see ErrorContext.
+void setStaticError(ErrorCode code, const char *text, const char *file,
+                    int line, const char *subject = nullptr,
+                    int value_count = 0, const long long *values = nullptr);
 void clearError();
 bool hasError();
 const ErrorContext &getErrorContext();
 std::string getLastErrorMessage();
 
+template <class... T>
+inline void setErrorValues(ErrorCode code, const char *format,
+                           const char *file, int line, T... values)
+{
+    static_assert(sizeof...(T) <= 3, "at most three values");
+    const long long v[] = {static_cast<long long>(values)..., 0};
+    setStaticError(code, format, file, line, nullptr, (int)sizeof...(T), v);
+}
+
 // Macros to simplify error setting
 #define SET_ERROR_CODE(code, msg) \
     PerfectErrors::setError(code, msg, __FILE__, __LINE__)
@@ -55,6 +80,18 @@ std::string getLastErrorMessage();
         PerfectErrors::setError(code, msg, __FILE__, __LINE__); \
         return retVal; \
     } while (0)
+// text is a string literal; it is kept by pointer instead of being copied.
+#define SET_STATIC_ERROR(code, text) \
+    PerfectErrors::setStaticError(code, "" text, __FILE__, __LINE__)
+// Sets PE_OUT_OF_RANGE at the caller unless min <= value <= max.
+#define CHECK_RANGE(paramName, value, min, max) \
+    PerfectErrors::checkRange("" paramName, value, min, max, __FILE__, \
+                              __LINE__)
+// format is a string literal with a %lld for each value (at most three);
+// it is only formatted when the message is read.
+#define SET_ERROR_VALUES(code, format, ...) \
+    PerfectErrors::setErrorValues(code, "" format, __FILE__, __LINE__, \
+                                  __VA_ARGS__)
 
 // Helper functions for error handling
 inline ErrorCode getLastErrorCode()
@@ -62,14 +99,14 @@ inline ErrorCode getLastErrorCode()
     return getErrorContext().code;
 }
 
-inline bool checkRange(const std::string &paramName, int value, int min,
-                       int max)
+// paramName is a string literal; see CHECK_RANGE.
+inline bool checkRange(const char *paramName, int value, int min, int max,
+                       const char *file, int line)
 {
     if (value < min || value > max) {
-        setError(PE_OUT_OF_RANGE,
-                 paramName + " must be between " + std::to_string(min) +
-                     " and " + std::to_string(max),
-                 __FILE__, __LINE__);
+        const long long bounds[2] = {min, max};
+        setStaticError(PE_OUT_OF_RANGE, "must be between %lld and %lld",
+                       file, line, paramName, 2, bounds);
         return false;
     }
     return true;
@@ -156,9 +156,9 @@ void GameState::check_invariants()
 #pragma warning(disable : 4127)
 #endif
 // Called when applying a free setup. It sets over and checks whether the
-// position is valid. Returns "" if valid, reason str otherwise. Also called
-// when pasting a position.
-std::string GameState::set_over_and_check_valid_setup()
+// position is valid. Returns nullptr if valid, the reason (a static string,
+// also set as the error) otherwise. Also called when pasting a position.
+const char *GameState::set_over_and_check_valid_setup()
 {
     assert(!over && !block);
 
@@ -169,23 +169,23 @@ std::string GameState::set_over_and_check_valid_setup()
 
     int toBePlaced0 = Rules::maxKSZ - setStoneCount[0];
     if (stoneCount[0] + toBePlaced0 > Rules::maxKSZ) {
-        SET_ERROR_CODE(PerfectErrors::PE_INVALID_ARGUMENT,
-                       "Too many white stones (on the board + to be placed). "
-                       "Please remove some white stones from the board and/or "
-                       "decrease the number of white stones to be placed.");
-        return "Too many white stones (on the board + to be placed). Please "
-               "remove some white stones from the board and/or decrease the "
-               "number of white stones to be placed.";
+        static const char reason[] =
+            "Too many white stones (on the board + to be placed). Please "
+            "remove some white stones from the board and/or decrease the "
+            "number of white stones to be placed.";
+        PerfectErrors::setStaticError(PerfectErrors::PE_INVALID_ARGUMENT,
+                                      reason, __FILE__, __LINE__);
+        return reason;
     }
     int toBePlaced1 = Rules::maxKSZ - setStoneCount[1];
     if (stoneCount[1] + toBePlaced1 > Rules::maxKSZ) {
-        SET_ERROR_CODE(PerfectErrors::PE_INVALID_ARGUMENT,
-                       "Too many black stones (on the board + to be placed). "
-                       "Please remove some black stones from the board and/or "
-                       "decrease the number of black stones to be placed.");
-        return "Too many black stones (on the board + to be placed). Please "
-               "remove some black stones from the board and/or decrease the "
-               "number of black stones to be placed.";
+        static const char reason[] =
+            "Too many black stones (on the board + to be placed). Please "
+            "remove some black stones from the board and/or decrease the "
+            "number of black stones to be placed.";
+        PerfectErrors::setStaticError(PerfectErrors::PE_INVALID_ARGUMENT,
+                                      reason, __FILE__, __LINE__);
+        return reason;
     }
 
     assert(!(phase == 1 && toBePlaced0 == 0 && toBePlaced1 == 0));
@@ -196,55 +196,48 @@ std::string GameState::set_over_and_check_valid_setup()
         if (phase == 1) {
             if (toBePlaced0 !=
                 toBePlaced1 - (((sideToMove == 0) ^ kle) ? 0 : 1)) {
-                SET_ERROR_CODE(PerfectErrors::PE_INVALID_ARGUMENT,
-                               "If Black is to move in the placement phase, "
-                               "then the number of black stones to be placed "
-                               "should be one more than the number of white "
-                               "stones to placed. If White is to move in the "
-                               "placement phase, then the number of white and "
-                               "black stones to be placed should be equal. "
-                               "(Except in a stone taking position, where "
-                               "these conditions are reversed.)\n\nNote: The "
-                               "Lasker variant (and the extended solutions) "
-                               "doesn't have these constraints.\n\nNote: You "
-                               "can switch the side to move by the \"Switch "
-                               "STM\" button in position setup mode.");
-                return "If Black is to move in the placement phase, then the "
-                       "number of black stones to be placed should be one more "
-                       "than the number of white stones to placed. If White is "
-                       "to move in the placement phase, then the number of "
-                       "white and black stones to be placed should be equal. "
-                       "(Except in a stone taking position, where these "
-                       "conditions are reversed.)\n\nNote: The Lasker variant "
-                       "(and the extended solutions) doesn't have these "
-                       "constraints.\n\nNote: You can switch the side to move "
-                       "by the \"Switch STM\" button in position setup mode.";
+                static const char reason[] =
+                    "If Black is to move in the placement phase, then the "
+                    "number of black stones to be placed should be one more "
+                    "than the number of white stones to placed. If White is "
+                    "to move in the placement phase, then the number of "
+                    "white and black stones to be placed should be equal. "
+                    "(Except in a stone taking position, where these "
+                    "conditions are reversed.)\n\nNote: The Lasker variant "
+                    "(and the extended solutions) doesn't have these "
+                    "constraints.\n\nNote: You can switch the side to move "
+                    "by the \"Switch STM\" button in position setup mode.";
+                PerfectErrors::setStaticError(
+                    PerfectErrors::PE_INVALID_ARGUMENT, reason, __FILE__,
+                    __LINE__);
+                return reason;
             }
         } else {
             if (phase != 2) {
-                SET_ERROR_CODE(PerfectErrors::PE_INVALID_ARGUMENT, "Phase is "
-                                                                   "not 2");
-                return "Phase is not 2";
+                static const char reason[] = "Phase is not 2";
+                PerfectErrors::setStaticError(
+                    PerfectErrors::PE_INVALID_ARGUMENT, reason, __FILE__,
+                    __LINE__);
+                return reason;
             }
             if (toBePlaced0 != 0 || toBePlaced1 != 0) {
-                SET_ERROR_CODE(PerfectErrors::PE_INVALID_ARGUMENT, "toBePlaced0"
-                                                                   " or "
-                                                                   "toBePlaced1"
-                                                                   " is not 0");
-                return "toBePlaced0 or toBePlaced1 is not 0";
+                static const char reason[] =
+                    "toBePlaced0 or toBePlaced1 is not 0";
+                PerfectErrors::setStaticError(
+                    PerfectErrors::PE_INVALID_ARGUMENT, reason, __FILE__,
+                    __LINE__);
+                return reason;
             }
         }
     }
 
     if (kle && stoneCount[1 - sideToMove] == 0) {
-        SET_ERROR_CODE(PerfectErrors::PE_INVALID_ARGUMENT, "A position where "
-                                                           "the opponent "
-                                                           "doesn't have any "
-                                                           "stones cannot be a "
-                                                           "stone taking "
-                                                           "position.");
-        return "A position where the opponent doesn't have any stones cannot "
-               "be a stone taking position.";
+        static const char reason[] =
+            "A position where the opponent doesn't have any stones cannot "
+            "be a stone taking position.";
+        PerfectErrors::setStaticError(PerfectErrors::PE_INVALID_ARGUMENT,
+                                      reason, __FILE__, __LINE__);
+        return reason;
     }
 
     // Set over if needed:
@@ -288,7 +281,7 @@ std::string GameState::set_over_and_check_valid_setup()
         winner = -1;
     }
 
-    return "";
+    return nullptr;
 }
 #if defined(_WIN32)
 #pragma warning(pop)
@@ -420,9 +413,9 @@ void GameState::fromString(const std::string &s)
         }
     }
 
-    std::string validation_error = set_over_and_check_valid_setup();
-    if (!validation_error.empty()) {
-        SET_ERROR_CODE(PerfectErrors::PE_INVALID_GAME_STATE, validation_error);
+    if (const char *reason = set_over_and_check_valid_setup()) {
+        PerfectErrors::setStaticError(PerfectErrors::PE_INVALID_GAME_STATE,
+                                      reason, __FILE__, __LINE__);
         return;
     }
 
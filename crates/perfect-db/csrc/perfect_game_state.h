@@ -8,6 +8,7 @@
 #define PERFECT_GAME_STATE_H_INCLUDED
 
 #include <sstream>
+#include <vector>
 
 class CMove; // forward declaration, implement this
 
@@ -31,6 +32,7 @@ public:
     GameState() { } // start of game
 
     GameState(const GameState &s);
+    GameState &operator=(const GameState &s) = default;
 
     int get_future_piece_count(int p);
 
@@ -45,9 +47,9 @@ public:
     void check_invariants();
 
     // Called when applying a free setup. It sets over and checks whether the
-    // position is valid. Returns "" if valid, reason str otherwise. Also called
-    // when pasting a position.
-    std::string set_over_and_check_valid_setup();
+    // position is valid. Returns nullptr if valid, the reason (static)
+    // otherwise. Also called when pasting a position.
+    const char *set_over_and_check_valid_setup();
 
     // to paste from clipboard
     GameState(const std::string &s);
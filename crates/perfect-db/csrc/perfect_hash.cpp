@@ -6,10 +6,13 @@
 
 #include "perfect_hash.h"
 #include "perfect_common.h"
+#include "perfect_stats.h"
 #include "perfect_symmetries.h"
 
-#include <cstdint>
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <mutex>
 #include <vector>
 
 const int binom[25][25] = {
@@ -78,35 +81,129 @@ int next_choose(int x)
     return (((r ^ x) >> 2) / c) | r;
 }
 
-void init_collapse_lookup();
+int choose_rank(int x)
+{
+    int r = 0;
+    for (int p = 0, k = 1; x; p++, x >>= 1)
+        if (x & 1)
+            r += binom[p][k++];
+    return r;
+}
+
+int choose_unrank(int rank, int ones)
+{
+    int x = 0;
+    for (int p = 23; ones > 0; p--)
+        if (binom[p][ones] <= rank) {
+            rank -= binom[p][ones];
+            x |= 1 << p;
+            ones--;
+        }
+    return x;
+}
+
+std::atomic<HashIndexMode> Hash::index_mode(HashIndexMode::tables);
 
 Hash::Hash(int the_w, int the_b, Sector *sec)
     : W(the_w)
     , B(the_b)
+    , compact(index_mode == HashIndexMode::compact)
     , s(sec)
 {
-    // Calculate g_lookup array size and allocate with progress indication
-    size_t g_size = 1LL << (24 - W);
-    size_t g_memory = g_size * sizeof(int);
+    if (compact)
+        init_compact();
+    else
+        init_tables();
+    if (!initialized)
+        return;
 
-    if (g_memory > 10 * 1024 * 1024) { // > 10MB
-        LOG("Allocating large g_lookup array: %zu elements (%.1f MB)...\n",
-            g_size, g_memory / (1024.0 * 1024.0));
-    }
+    hash_count = f_count * binom[24 - W][B];
 
-    g_lookup = new int[g_size];
-    if (g_lookup == nullptr) {
-        LOG("Failed to allocate g_lookup array of size %.1f MB\n",
-            g_memory / (1024.0 * 1024.0));
-        return;
-    }
+#ifdef _DEBUG
+#ifndef WRAPPER // The Wrapper uses the manual popcnt, which makes this
+                // noticeably slow when playing
+    check_hash_init_consistency();
+#endif
+#endif
+}
 
-    if (g_memory > 10 * 1024 * 1024) {
-        LOG("g_lookup allocation successful\n");
+// The smallest mask of every symmetry orbit of the masks with W bits set,
+// ascending: the first mask of an orbit in next_choose order is its smallest.
+static std::vector<int> orbit_representatives(int W)
+{
+    std::vector<uint64_t> seen(((size_t)1 << 24) / 64);
+    std::vector<int> reps;
+    for (int w = (1 << W) - 1; w < 1 << 24; w = next_choose(w)) {
+        if (seen[w >> 6] >> (w & 63) & 1)
+            continue;
+        for (int i = 0; i < 16; i++) {
+            auto sw = sym24_transform(i, w);
+            seen[sw >> 6] |= (uint64_t)1 << (sw & 63);
+        }
+        reps.push_back(w);
     }
+    return reps;
+}
+
+int hash_count_of(int W, int B)
+{
+    static std::mutex m;
+    static int orbits[25] = {};
+
+    std::lock_guard<std::mutex> lock(m);
+    if (orbits[W] == 0)
+        orbits[W] = (int)orbit_representatives(W).size();
+    return orbits[W] * binom[24 - W][B];
+}
+
+// orbit_representatives(W), computed once: the compact mode rebuilds a Hash
+// every time the hash cache evicts and reloads a sector.
+static const std::vector<int> &cached_orbit_representatives(int W)
+{
+    static std::once_flag once[25];
+    static std::vector<int> reps[25];
+    std::call_once(once[W], [W] { reps[W] = orbit_representatives(W); });
+    return reps[W];
+}
+
+void Hash::init_compact()
+{
+    const std::vector<int> &reps = cached_orbit_representatives(W);
+    f_count = (int)reps.size();
+    f_inv_lookup = reps.data();
+    initialized = true;
+}
 
-    memset(f_lookup, -1, sizeof(f_lookup));
-    memset(f_sym_lookup2, 0, sizeof(f_sym_lookup2));
+int Hash::compact_canonicalize(board &a) const
+{
+    int w = (int)(a & mask24);
+    int rep = w;
+    for (int i = 0; i < 16; i++)
+        rep = std::min(rep, (int)sym24_transform(i, w));
+
+    // f_sym_lookup holds the inverse of the last operation that takes the
+    // representative to w (the identity is the last one).
+    int op = 15;
+    for (int i = 15; i >= 0; i--)
+        if ((int)sym24_transform(i, rep) == w) {
+            op = inv[i];
+            break;
+        }
+    a = sym48_transform(op, a);
+    return (int)(std::lower_bound(f_inv_lookup, f_inv_lookup + f_count, rep) -
+                 f_inv_lookup);
+}
+
+bool HashTables::build(int W)
+{
+    // The allocation failure is reported by the Sector that needed the tables.
+    const size_t g_size = 1LL << (24 - W);
+    if (!f_lookup.allocate(1 << 24) || !f_sym_lookup.allocate(1 << 24) ||
+        !f_sym_lookup2.allocate(1 << 24) || !g_lookup.allocate(g_size))
+        return false;
+
+    // LargeAlloc hands out zeroed memory, so only f_lookup needs a fill.
+    memset(f_lookup.data(), -1, f_lookup.size() * sizeof(int));
     int c = 0;
     for (int w = (1 << W) - 1; w < 1 << 24; w = next_choose(w))
         if (f_lookup[w] == -1) {
@@ -163,7 +260,7 @@ Hash::Hash(int the_w, int the_b, Sector *sec)
         }
 
     f_count = c;
-    f_inv_lookup = new int[f_count];
+    f_inv_lookup.resize(f_count);
 
     std::vector<int> ws;
     for (int w = (1 << W) - 1; w < 1 << 24; w = next_choose(w))
@@ -174,65 +271,153 @@ Hash::Hash(int the_w, int the_b, Sector *sec)
         f_inv_lookup[f_lookup[w]] = w;
     }
 
-    g_inv_lookup = new int[binom[24 - W][B]];
-    c = 0;
-    for (int b = (1 << B) - 1; b < 1 << (24 - W); b = next_choose(b)) {
-        if (c >= binom[24 - W][B]) {
-            assert(false);
-            break;
-        }
-        g_lookup[b] = c;
-        g_inv_lookup[c] = b;
-        c++;
+    for (int ones = 0; ones <= 24 - W; ones++) {
+        c = 0;
+        for (int b = (1 << ones) - 1; b < 1 << (24 - W); b = next_choose(b))
+            g_lookup[b] = c++;
     }
 
-    hash_count = f_count * binom[24 - W][B];
+    f_lookup.publish();
+    f_sym_lookup.publish();
+    g_lookup.publish();
+    return true;
+}
 
-    init_collapse_lookup();
+std::shared_ptr<const HashTables> HashTables::get(int W)
+{
+    static std::mutex mutexes[25];
+    static std::weak_ptr<const HashTables> held[25];
 
-#ifdef _DEBUG
-#ifndef WRAPPER // The Wrapper uses the manual popcnt, which makes this
-                // noticeably slow when playing
-    check_hash_init_consistency();
-#endif
-#endif
+    // Sectors of other W build their tables meanwhile.
+    std::lock_guard<std::mutex> lock(mutexes[W]);
+    if (auto t = held[W].lock())
+        return t;
+    auto t = std::make_shared<HashTables>();
+    if (!t->build(W))
+        return nullptr;
+    held[W] = t;
+    return t;
+}
+
+size_t HashTables::bytes() const
+{
+    return f_lookup.bytes() + f_sym_lookup.bytes() + f_sym_lookup2.bytes() +
+           g_lookup.bytes() + f_inv_lookup.size() * sizeof(int);
+}
+
+void Hash::init_tables()
+{
+    tables = HashTables::get(W);
+    if (!tables)
+        return;
+    f_count = tables->f_count;
+    f_inv_lookup = tables->f_inv_lookup.data();
+
+    g_inv_lookup = new int[binom[24 - W][B]];
+    int c = 0;
+    for (int b = (1 << B) - 1; b < 1 << (24 - W); b = next_choose(b))
+        g_inv_lookup[c++] = b;
+    initialized = true;
 }
 
 void Hash::check_hash_init_consistency()
 {
+    if (compact)
+        return;
     for (int i = 0; i < 1 << 24; i++)
         if (static_cast<int>(POPCNT(i)) == W)
-            assert(f_sym_lookup[i] >= 0 && f_sym_lookup[i] < 16);
+            assert(tables->f_sym_lookup.data()[i] >= 0 &&
+                   tables->f_sym_lookup.data()[i] < 16);
 }
 
 Hash::~Hash()
 {
-    delete[] f_inv_lookup;
-    delete[] g_lookup;
     delete[] g_inv_lookup;
 }
 
+size_t Hash::table_bytes() const
+{
+    if (compact)
+        return (size_t)f_count * sizeof(int);
+    return tables ? tables->bytes() : 0;
+}
+
 std::pair<int, eval_elem2> Hash::hash(board a)
 {
-    a = sym48_transform(f_sym_lookup[a & mask24], a);
-    int h1 = f_lookup[a & mask24] * binom[24 - W][B] + g_lookup[collapse(a)];
+    if (compact) {
+        const int m = binom[24 - W][B];
+        int h1 = compact_canonicalize(a) * m + choose_rank(collapse(a));
+        eval_elem_sym2 e = s->get_eval_inner(h1);
+        if (e.cas() != eval_elem_sym2::Sym)
+            return std::make_pair(h1, e);
+        Stats::add(Stat::sym_redirects);
+        a = sym48_transform(e.sym(), a);
+        int h2 = compact_canonicalize(a) * m + choose_rank(collapse(a));
+        assert(s->get_eval_inner(h2).cas() != eval_elem_sym2::Sym);
+        return std::make_pair(h2, s->get_eval(h2));
+    }
+
+    const int *fl = tables->f_lookup.local();
+    const char *fsl = tables->f_sym_lookup.local();
+    const int *gl = tables->g_lookup.local();
+
+    a = sym48_transform(fsl[a & mask24], a);
+    int h1 = fl[a & mask24] * binom[24 - W][B] + gl[collapse(a)];
     eval_elem_sym2 e = s->get_eval_inner(h1);
     if (e.cas() != eval_elem_sym2::Sym)
         return std::make_pair(h1, e);
     else {
+        Stats::add(Stat::sym_redirects);
         a = sym48_transform(e.sym(), a);
-        int h2 = f_lookup[a & mask24] * binom[24 - W][B] +
-                 g_lookup[collapse(a)];
+        int h2 = fl[a & mask24] * binom[24 - W][B] + gl[collapse(a)];
         assert(s->get_eval_inner(h2).cas() != eval_elem_sym2::Sym);
         return std::make_pair(h2, s->get_eval(h2));
     }
 }
 
+int Hash::index(board a) const
+{
+    return canonicalize(a);
+}
+
+int Hash::canonical_index(board a, int &op) const
+{
+    int best = -1;
+    board best_board = 0;
+    for (int i = 0; i < 16; i++) {
+        board b = sym48_transform(i, a);
+        const int h = canonicalize(b);
+        if (best < 0 || h < best) {
+            best = h;
+            best_board = b;
+        }
+    }
+    // best_board is an image of a, as the symmetries form a group.
+    for (op = 0; op < 15 && sym48_transform(op, a) != best_board; op++) { }
+    return best;
+}
+
+int Hash::canonicalize(board &a) const
+{
+    if (compact) {
+        int f = compact_canonicalize(a);
+        return f * binom[24 - W][B] + choose_rank(collapse(a));
+    }
+
+    const int *fl = tables->f_lookup.local();
+    const char *fsl = tables->f_sym_lookup.local();
+    const int *gl = tables->g_lookup.local();
+
+    a = sym48_transform(fsl[a & mask24], a);
+    return fl[a & mask24] * binom[24 - W][B] + gl[collapse(a)];
+}
+
 board Hash::inverse_hash(int h)
 {
     int m = binom[24 - W][B];
     int f = h / m, g = h % m;
-    return uncollapse(f_inv_lookup[f] | ((board)g_inv_lookup[g] << 24));
+    board b = compact ? (board)choose_unrank(g, B) : (board)g_inv_lookup[g];
+    return uncollapse(f_inv_lookup[f] | (b << 24));
 }
 
 board uncollapse(board a)
@@ -271,25 +456,26 @@ int collapse(board a)
 // 6: 1:29
 // 4: 1:32
 const int sl = 8, psl = 1 << sl;
-unsigned char collapse_lookup[psl][psl];
 
-void init_collapse_lookup()
+// collapse_lookup[w][bl]: the bits of bl on the empty squares of w, packed.
+// Every bl is its lowest bit or-ed with an already computed smaller bl.
+constexpr std::array<std::array<uint8_t, psl>, psl> make_collapse_lookup()
 {
-    // LOG("init_collapse_lookup");
-
-    for (int w = 0; w < psl; w++)
-        for (int bl = 0; bl < psl; bl++) {
-            int b = bl;
-            int i = 1, j = 1, r = 0;
-            for (; i < psl; i <<= 1) {
-                if (!(w & i)) {
-                    r |= b & j;
-                    j <<= 1;
-                } else
-                    b >>= 1;
-            }
-            collapse_lookup[w][bl] = static_cast<uint8_t>(r);
+    std::array<std::array<uint8_t, psl>, psl> t {};
+    for (int w = 0; w < psl; w++) {
+        int single[sl] = {};
+        for (int i = 0, j = 0; i < sl; i++)
+            if (!(w & (1 << i)))
+                single[i] = 1 << j++;
+        for (int bl = 1; bl < psl; bl++) {
+            int bit = 0;
+            while (!((bl >> bit) & 1))
+                bit++;
+            t[w][bl] = static_cast<uint8_t>(t[w][bl & (bl - 1)] |
+                                            single[bit]);
         }
-
-    // LOG(".\n");
+    }
+    return t;
 }
+
+constexpr auto collapse_lookup = make_collapse_lookup();
@@ -7,40 +7,111 @@
 #ifndef PERFECT_HASH_H_INCLUDED
 #define PERFECT_HASH_H_INCLUDED
 
+#include "perfect_alloc.h"
 #include "perfect_sector.h"
 
+#include <atomic>
 #include <cstring>
+#include <memory>
+#include <vector>
 
 // void init_hash_lookuptables();
 
+// How Hash maps a board to its index. Both give the same indices.
+enum class HashIndexMode {
+    // f/g lookup tables over all 2^24 white masks (about 112 MB per W,
+    // shared by its sectors, plus 4 << (24 - W) bytes for g), a few loads
+    // per lookup
+    tables = 0,
+    // Only the orbit representatives of the white masks (4 bytes per orbit):
+    // the representative is found through the 16 symmetries and ranked by
+    // binary search, the black mask is ranked with the combinatorial number
+    // system. For devices that cannot spare the tables.
+    compact = 1
+};
+
+// The lookup tables of the tables mode that depend only on W. The Hash
+// objects of all sectors with W white stones share them: the first one
+// builds them, and they are freed with the last one unless something else
+// holds them (BulkSchedule pins them while it works through the sectors of
+// a W, so that evicting one sector does not throw them away).
+struct HashTables
+{
+    // The f/g tables are randomly accessed on every lookup, so they go
+    // through LargeAlloc (huge pages, optional per-NUMA-node replicas).
+    LargeArray<int> f_lookup;      // 1 << 24
+    LargeArray<char> f_sym_lookup; // 1 << 24, converted from int to char
+    LargeArray<unsigned short> f_sym_lookup2; // 1 << 24
+    std::vector<int> f_inv_lookup;
+    // 1 << (24 - W): the rank of every black mask among the masks with as
+    // many stones, for every B at once
+    LargeArray<int> g_lookup;
+
+    int f_count {0};
+
+    // The tables of W, built unless they are held already; nullptr if they
+    // cannot be allocated.
+    static std::shared_ptr<const HashTables> get(int W);
+
+    size_t bytes() const;
+
+private:
+    bool build(int W);
+};
+
 class Hash
 {
     int W, B; // It might be worth to put these after the large arrays for cache
               // locality reasons
 
-    int f_lookup[1 << 24] {0};
-    char f_sym_lookup[1 << 24] {0}; // Converted from int to char
-    int *f_inv_lookup {nullptr};
-    int *g_lookup {nullptr};
+    bool compact {false};
+    bool initialized {false};
+
+    std::shared_ptr<const HashTables> tables; // tables mode
+    const int *f_inv_lookup {nullptr}; // f tables or the orbit representatives
     int *g_inv_lookup {nullptr};
 
     int f_count {0};
 
     Sector *s {nullptr};
 
+    void init_tables();
+    void init_compact();
+    // The compact counterpart of a = sym48_transform(f_sym_lookup[w], a);
+    // followed by f_lookup[a & mask24]
+    int compact_canonicalize(board &a) const;
+    // index(a), leaving a transformed to the board of that index.
+    int canonicalize(board &a) const;
+
 public:
+    // Only affects Hash objects constructed after it is set.
+    static std::atomic<HashIndexMode> index_mode;
+
     Hash(int the_w, int the_b, Sector *sec);
 
     std::pair<int, eval_elem2> hash(board a);
     board inverse_hash(int h);
 
-    int hash_count {0};
+    // Index of the canonical form of a, without reading the sector. Unlike
+    // hash(), symmetry redirects stored in the sector are not followed.
+    int index(board a) const;
 
-    unsigned short f_sym_lookup2[1 << 24];
+    // The index that hash() ends at, and the symmetry op (as numbered by
+    // sym48_transform) taking a to inverse_hash of it, without reading the
+    // sector: of the symmetric images of a position, the sectors keep the
+    // one with the smallest index and redirect the others to it.
+    int canonical_index(board a, int &op) const;
+
+    int hash_count {0};
 
     void check_hash_init_consistency();
 
-    bool is_initialized() const { return g_lookup != nullptr; }
+    bool is_initialized() const { return initialized; }
+
+    // Bytes held by the lookup tables (including NUMA replicas). The tables
+    // of the tables mode are shared, so every sector with the same W
+    // reports them.
+    size_t table_bytes() const;
 
     ~Hash();
 };
@@ -49,4 +120,13 @@ int collapse(board a);
 board uncollapse(board a);
 int next_choose(int x);
 
+// Position of x among the masks of the same popcount in next_choose order
+// (the combinatorial number system), and its inverse.
+int choose_rank(int x);
+int choose_unrank(int rank, int ones);
+
+// hash_count of a sector with W white and B black stones, without building
+// its Hash. The orbit count of each W is computed once.
+int hash_count_of(int W, int B);
+
 #endif // PERFECT_HASH_H_INCLUDED
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_load_trace.cpp
+
+#include "perfect_load_trace.h"
+#include "perfect_stats.h"
+
+#include <mutex>
+
+namespace LoadTrace {
+
+std::atomic<bool> g_enabled {false};
+
+namespace {
+
+std::mutex g_mutex;
+pd_load_callback g_callback = nullptr;
+void *g_callback_user = nullptr;
+
+} // namespace
+
+void set_callback(pd_load_callback callback, void *user)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_callback = callback;
+    g_callback_user = user;
+    g_enabled.store(callback != nullptr, std::memory_order_relaxed);
+}
+
+void report(const Id &id, Phase phase, uint64_t elapsed_ns)
+{
+    pd_load_callback callback;
+    void *user;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        callback = g_callback;
+        user = g_callback_user;
+    }
+    if (callback)
+        callback(id.W, id.B, id.WF, id.BF, static_cast<int>(phase),
+                 (long long)elapsed_ns, user);
+}
+
+Span::Span(const Id &the_id, Phase the_phase)
+    : id(the_id)
+    , phase(the_phase)
+{
+    if (g_enabled.load(std::memory_order_relaxed))
+        start = Stats::now_ns();
+}
+
+Span::~Span()
+{
+    if (start)
+        report(id, phase, Stats::now_ns() - start);
+}
+
+} // namespace LoadTrace
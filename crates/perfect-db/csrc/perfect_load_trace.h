@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_load_trace.h
+//
+// Timings of the phases of a sector load, handed to the callback of
+// pd_set_load_callback instead of being printed: opening the file, reading
+// its header, mapping the evaluations, reading the em_set and building the
+// hash tables. Each phase is reported once it ends, on the thread that ran
+// it, with the nanoseconds it took. Without a callback a span costs a
+// relaxed load and nothing is timed.
+
+#ifndef PERFECT_LOAD_TRACE_H_INCLUDED
+#define PERFECT_LOAD_TRACE_H_INCLUDED
+
+#include "perfect_c_api.h"
+#include "perfect_common.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace LoadTrace {
+
+enum class Phase {
+    open = PD_LOAD_OPEN,
+    header = PD_LOAD_HEADER,
+    eval_map = PD_LOAD_EVAL_MAP,
+    em_set = PD_LOAD_EM_SET,
+    hash_build = PD_LOAD_HASH_BUILD,
+};
+
+extern std::atomic<bool> g_enabled;
+
+void set_callback(pd_load_callback callback, void *user);
+
+void report(const Id &id, Phase phase, uint64_t elapsed_ns);
+
+// Reports the time from its construction to its destruction as a phase of
+// the load of id.
+class Span
+{
+    const Id &id;
+    Phase phase;
+    uint64_t start {0};
+
+public:
+    Span(const Id &the_id, Phase the_phase);
+    ~Span();
+
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+};
+
+} // namespace LoadTrace
+
+#endif // PERFECT_LOAD_TRACE_H_INCLUDED
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_opening.cpp
+
+#include "perfect_opening.h"
+#include "perfect_errors.h"
+#include "perfect_log.h"
+#include "perfect_platform.h"
+#include "perfect_rules.h"
+#include "perfect_symmetries.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace OpeningTable {
+
+namespace {
+
+const char table_magic[4] = {'S', 'M', 'O', 'T'};
+const unsigned char table_version = 1;
+
+struct Table
+{
+    bool loaded {false};
+    std::unordered_map<uint64_t, uint32_t> index;
+    std::vector<int8_t> wdl;
+    // The moves of entry e are moves[first[e] .. first[e + 1]).
+    std::vector<uint32_t> first {0};
+    std::vector<uint32_t> moves;
+};
+
+Table g_table;
+// The file generate wrote last, if it was given a path.
+std::string g_path;
+
+std::string default_path()
+{
+#ifdef _WIN32
+    return secValPath + "\\" + ruleVariantName + ".opening";
+#else
+    return secValPath + "/" + ruleVariantName + ".opening";
+#endif
+}
+
+// The key of s, and the symmetry that takes s to it.
+uint64_t key_of(PerfectPlayer &player, const GameState &s, int &op)
+{
+    const board a = player.sector_board(s);
+    board rep = a;
+    op = 15; // the identity
+    for (int i = 0; i < 16; i++) {
+        const board b = sym48_transform(i, a);
+        if (b < rep) {
+            rep = b;
+            op = i;
+        }
+    }
+    const int wf = Rules::maxKSZ - s.setStoneCount[s.sideToMove];
+    const int bf = Rules::maxKSZ - s.setStoneCount[1 - s.sideToMove];
+    return (uint64_t)rep | ((uint64_t)wf << 48) | ((uint64_t)bf << 52);
+}
+
+uint64_t read_le(const unsigned char *p, int bytes)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++)
+        v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+void write_le(std::vector<unsigned char> &out, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        out.push_back((unsigned char)(v >> (8 * i)));
+}
+
+// A missing file leaves the table empty; a damaged one as well, with a note
+// in the log.
+void load()
+{
+    g_table = Table();
+    g_table.loaded = true;
+
+    const std::string path = g_path.empty() ? default_path() : g_path;
+    FILE *file = nullptr;
+    if (FOPEN(&file, path.c_str(), "rb") == -1 || !file)
+        return;
+    std::vector<unsigned char> data;
+    unsigned char buffer[1 << 16];
+    for (size_t n; (n = fread(buffer, 1, sizeof(buffer), file)) > 0;)
+        data.insert(data.end(), buffer, buffer + n);
+    fclose(file);
+
+    const size_t header = 10;
+    bool ok = data.size() >= header &&
+              memcmp(data.data(), table_magic, 4) == 0 &&
+              data[4] == table_version;
+    const uint32_t count = ok ? (uint32_t)read_le(&data[6], 4) : 0;
+    size_t pos = header;
+    for (uint32_t e = 0; ok && e < count; e++) {
+        if (pos + 10 > data.size()) {
+            ok = false;
+            break;
+        }
+        const uint64_t key = read_le(&data[pos], 8);
+        const int8_t wdl = (int8_t)data[pos + 8];
+        const int n = data[pos + 9];
+        pos += 10;
+        if (pos + 4 * (size_t)n > data.size()) {
+            ok = false;
+            break;
+        }
+        for (int i = 0; i < n; i++, pos += 4)
+            g_table.moves.push_back((uint32_t)read_le(&data[pos], 4));
+        g_table.index[key] = e;
+        g_table.wdl.push_back(wdl);
+        g_table.first.push_back((uint32_t)g_table.moves.size());
+    }
+    if (!ok || pos != data.size()) {
+#ifdef DEBUG
+        LOG("Ignoring the damaged opening table %s\n", path.c_str());
+#endif
+        g_table = Table();
+        g_table.loaded = true;
+    }
+}
+
+} // namespace
+
+bool lookup(PerfectPlayer &player, const GameState &s,
+            std::vector<AdvancedMove> &moves, Value &value)
+{
+    if (!g_table.loaded)
+        load();
+    if (s.kle || g_table.index.empty())
+        return false;
+
+    int op;
+    auto it = g_table.index.find(key_of(player, s, op));
+    if (it == g_table.index.end())
+        return false;
+    const uint32_t e = it->second;
+    const uint32_t *begin = g_table.moves.data() + g_table.first[e];
+    const uint32_t *end = g_table.moves.data() + g_table.first[e + 1];
+
+    moves.clear();
+    for (AdvancedMove &m : player.get_move_list(s)) {
+        const uint32_t b = (uint32_t)sym24_transform(op, m.toBitBoard());
+        if (std::find(begin, end, b) != end)
+            moves.push_back(m);
+    }
+    // A table of other rules may not match the moves.
+    if (moves.empty())
+        return false;
+
+    const int8_t wdl = g_table.wdl[e];
+    value = wdl > 0 ? VALUE_MATE : (wdl < 0 ? -VALUE_MATE : VALUE_DRAW);
+    return true;
+}
+
+void reset()
+{
+    g_table = Table();
+    g_path.clear();
+}
+
+int64_t size()
+{
+    if (!g_table.loaded)
+        load();
+    return (int64_t)g_table.index.size();
+}
+
+int64_t generate(PerfectPlayer &player, int plies, const std::string &path)
+{
+    struct Record
+    {
+        uint64_t key;
+        int8_t wdl;
+        std::vector<uint32_t> moves;
+    };
+    std::vector<Record> records;
+
+    // Level by level, as every position of a level is reached in the same
+    // number of plies.
+    std::vector<GameState> level {GameState()};
+    std::unordered_set<uint64_t> seen;
+    int op;
+    seen.insert(key_of(player, level[0], op));
+    for (int ply = 0; ply < plies && !level.empty(); ply++) {
+        std::vector<GameState> next;
+        for (const GameState &s : level) {
+            Record r;
+            r.key = key_of(player, s, op);
+            Value value;
+            std::vector<AdvancedMove> good = player.get_good_moves(s, value);
+            if (PerfectErrors::hasError())
+                return -1;
+            r.wdl = value == VALUE_MATE ? 1 : (value == -VALUE_MATE ? -1 : 0);
+            for (AdvancedMove &m : good)
+                r.moves.push_back((uint32_t)sym24_transform(op,
+                                                            m.toBitBoard()));
+            records.push_back(std::move(r));
+
+            for (AdvancedMove &m : player.get_move_list(s)) {
+                GameState c = player.make_move_in_state(s, m);
+                if (PerfectErrors::hasError())
+                    return -1;
+                if (!c.over && seen.insert(key_of(player, c, op)).second)
+                    next.push_back(c);
+            }
+        }
+        level.swap(next);
+    }
+    std::sort(records.begin(), records.end(),
+              [](const Record &a, const Record &b) { return a.key < b.key; });
+
+    std::vector<unsigned char> out(table_magic, table_magic + 4);
+    out.push_back(table_version);
+    out.push_back((unsigned char)plies);
+    write_le(out, records.size(), 4);
+    for (const Record &r : records) {
+        write_le(out, r.key, 8);
+        out.push_back((unsigned char)r.wdl);
+        out.push_back((unsigned char)r.moves.size());
+        for (uint32_t m : r.moves)
+            write_le(out, m, 4);
+    }
+
+    const std::string file_path = path.empty() ? default_path() : path;
+    const std::string tmp = file_path + ".tmp";
+    FILE *file = nullptr;
+    if (FOPEN(&file, tmp.c_str(), "wb") == -1 || !file) {
+        SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                          "Cannot write " + tmp);
+        return -1;
+    }
+    bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || (remove(file_path.c_str()),
+                rename(tmp.c_str(), file_path.c_str())) != 0) {
+        remove(tmp.c_str());
+        SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                          "Cannot write " + file_path);
+        return -1;
+    }
+
+    reset();
+    g_path = path;
+    return (int64_t)records.size();
+}
+
+} // namespace OpeningTable
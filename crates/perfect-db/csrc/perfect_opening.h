@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_opening.h
+//
+// Best moves of the first plies of the game from a precomputed table, so that
+// the opening replies neither read a dozen small sectors per move nor evict
+// the sectors of the midgame from the hash cache.
+//
+// generate runs the player over every position reachable in fewer than the
+// given number of plies from the empty board (all moves, not only the good
+// ones) and stores the result of get_good_moves for each. Positions are keyed
+// in the frame of the sectors (the side to move is white) under the smallest
+// of the 16 board symmetries, with the stones to place of both sides; the
+// moves are stored as toBitBoard masks in the same frame. The table lives
+// next to the database as <variant>.opening, little-endian:
+//
+//   char magic[4] = "SMOT"; u8 version = 1; u8 plies; u32 count
+//   count * {u64 key; i8 wdl; u8 n; u32 moves[n]}
+//
+// The table is read on the first lookup after the player is created, or after
+// generate wrote it elsewhere, from that file until the next reset. A missing
+// file only means that every position goes to the sectors.
+
+#ifndef PERFECT_OPENING_H_INCLUDED
+#define PERFECT_OPENING_H_INCLUDED
+
+#include "perfect_game_state.h"
+#include "perfect_player.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace OpeningTable {
+
+// The good moves of s from the table, and their value as get_good_moves
+// sets it. Returns false if s is not in the table.
+bool lookup(PerfectPlayer &player, const GameState &s,
+            std::vector<AdvancedMove> &moves, Value &value);
+
+// Forgets the loaded table and the path of generate; the next lookup reads
+// <variant>.opening again.
+void reset();
+
+// Positions in the loaded table (reading it if needed).
+int64_t size();
+
+// Builds the table of every position reachable in fewer than plies plies and
+// writes it to path (<variant>.opening in the database directory if empty),
+// where the next lookup finds it. Needs the caller to keep other lookups out
+// (the API mutex). Returns the number of positions, or -1 with an error set
+// if a sector is missing or the file cannot be written.
+int64_t generate(PerfectPlayer &player, int plies, const std::string &path);
+
+} // namespace OpeningTable
+
+#endif // PERFECT_OPENING_H_INCLUDED
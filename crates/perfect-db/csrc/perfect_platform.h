@@ -7,6 +7,7 @@
 #ifndef PERFECT_PLATFORM_H_INCLUDED
 #define PERFECT_PLATFORM_H_INCLUDED
 
+#include <cstdint>
 #include <cstdio>
 #include <string>
 
@@ -75,4 +76,16 @@ inline int popcnt_software(uint32_t x) noexcept
 
 #endif // _WIN32
 
+// Size of the file at path in bytes, or -1 if it cannot be opened.
+int64_t file_size(const std::string &path);
+
+// Hints that the whole file will be read soon (posix_fadvise WILLNEED); a
+// no-op where that is not available or file is null.
+void prefetch_file(FILE *file);
+
+// Hints that file will be read front to back (posix_fadvise SEQUENTIAL, which
+// widens the kernel read-ahead); a no-op where that is not available or file
+// is null.
+void advise_sequential_file(FILE *file);
+
 #endif // PERFECT_PLATFORM_H_INCLUDED
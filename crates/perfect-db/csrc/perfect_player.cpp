@@ -11,7 +11,9 @@
 #include "perfect_game_state.h"
 #include "perfect_move.h"
 #include "perfect_rules.h"
+#include "perfect_solve.h"
 
+#include "perfect_stats.h"
 #include "perfect_wrappers.h"
 
 #include <bitset>
@@ -37,7 +39,6 @@ bool Sectors::created = false;
 std::map<Wrappers::WID, Wrappers::WSector> Sectors::get_sectors()
 {
     if (!created) {
-        Wrappers::Init::init_symmetry_lookup_tables();
         Wrappers::Init::init_sec_vals();
         // sectors.clear();
 
@@ -58,10 +59,15 @@ std::map<Wrappers::WID, Wrappers::WSector> Sectors::get_sectors()
                         // fileName << std::endl;
                         Wrappers::WID _id(w, b, whiteFree, blackFree);
 #ifdef _WIN32
-                        std::ifstream file(secValPath + "\\" + fileName);
+                        std::string path = secValPath + "\\" + fileName;
 #else
-                        std::ifstream file(secValPath + "/" + fileName);
+                        std::string path = secValPath + "/" + fileName;
 #endif
+                        // Either the plain sector or its block-compressed
+                        // container (.sec2z).
+                        std::ifstream file(path);
+                        if (!file.good())
+                            file = std::ifstream(path + "z");
                         if (file.good()) {
                             sectors.emplace(_id, Wrappers::WSector(_id));
                         }
@@ -89,7 +95,8 @@ void Sectors::reset()
         if (sector == nullptr) {
             continue;
         }
-        if (sector->hash != nullptr || sector->f != nullptr) {
+        if (sector->hash != nullptr || sector->f != nullptr ||
+            sector->z != nullptr) {
             sector->release_hash();
         }
         delete sector;
@@ -138,8 +145,21 @@ Wrappers::WSector *PerfectPlayer::get_sector(GameState s)
 
     auto iter = secs.find(id_val);
     if (iter == secs.end()) {
-        SET_ERROR_CODE(PerfectErrors::PE_DATABASE_NOT_FOUND, "Key not found in "
-                                                             "secs");
+        // Small missing sectors can be solved on the spot (perfect_solve.h).
+        if (SectorSolver::on_lookup()) {
+            const bool had_error = PerfectErrors::hasError();
+            if (SectorSolver::solve(*this, id_val.tonat()))
+                return &secs.find(id_val)->second;
+            // The error of the solver (a sector too large, say) gives way to
+            // the missing sector, which the search fallback goes by.
+            if (!had_error)
+                PerfectErrors::clearError();
+            SET_STATIC_ERROR(PerfectErrors::PE_DATABASE_NOT_FOUND,
+                             "Key not found in secs and not solvable");
+            return nullptr;
+        }
+        SET_STATIC_ERROR(PerfectErrors::PE_DATABASE_NOT_FOUND,
+                         "Key not found in secs");
         return nullptr;
     }
     return &(iter->second);
@@ -157,41 +177,41 @@ int PerfectPlayer::get_future_piece_count(const GameState &s)
                                           // get_future_piece_count
 }
 
-bool PerfectPlayer::makes_mill(const GameState &s, int from, int to)
-{
-    GameState s2 = s;
-    if (from != -1)
-        s2.board[from] = -1;
-    s2.board[to] = s.sideToMove;
-    return -1 != Rules::check_mill(to, s2);
-}
-
+template <class V>
 bool PerfectPlayer::isMill(const GameState &s, int m)
 {
-    return -1 != Rules::check_mill(m, s);
+    return -1 != Rules::check_mill<V>(m, s);
 }
 
+template <class V>
 std::vector<AdvancedMove> PerfectPlayer::set_moves(const GameState &s)
 {
     std::vector<AdvancedMove> r;
     for (int i = 0; i < 24; ++i) {
         if (s.board[i] == -1) {
             r.push_back(AdvancedMove {i, i, CMoveType::SetMove,
-                                      makes_mill(s, -1, i), false, 0});
+                                      Rules::makes_mill<V>(s, -1, i), false,
+                                      0});
         }
     }
     return r;
 }
 
+template <class V>
 std::vector<AdvancedMove> PerfectPlayer::slide_moves(const GameState &s)
 {
     std::vector<AdvancedMove> r;
+    const bool flying = s.stoneCount[s.sideToMove] + V::maxKSZ -
+                            s.setStoneCount[s.sideToMove] ==
+                        3;
     for (int i = 0; i < 24; ++i) {
+        if (s.board[i] != s.sideToMove)
+            continue;
         for (int j = 0; j < 24; ++j) {
-            if (s.board[i] == s.sideToMove && s.board[j] == -1 &&
-                (get_future_piece_count(s) == 3 || Rules::boardGraph[i][j])) {
+            if (s.board[j] == -1 && (flying || V::tables.boardGraph[i][j])) {
                 r.push_back(AdvancedMove {i, j, CMoveType::SlideMove,
-                                          makes_mill(s, i, j), false, 0});
+                                          Rules::makes_mill<V>(s, i, j),
+                                          false, 0});
             }
         }
     }
@@ -201,20 +221,21 @@ std::vector<AdvancedMove> PerfectPlayer::slide_moves(const GameState &s)
 // m has a withTaking step, where takeHon is not filled out. This function
 // creates a list, the elements of which are copies of m supplemented with one
 // possible removal each.
+template <class V>
 std::vector<AdvancedMove> PerfectPlayer::with_taking_moves(const GameState &s,
                                                            AdvancedMove &m)
 {
     std::vector<AdvancedMove> r;
     bool everythingInMill = true;
     for (int i = 0; i < 24; ++i) {
-        if (s.board[i] == 1 - s.sideToMove && !isMill(s, i)) {
+        if (s.board[i] == 1 - s.sideToMove && !isMill<V>(s, i)) {
             everythingInMill = false;
         }
     }
 
     for (int i = 0; i < 24; ++i) {
         if (s.board[i] == 1 - s.sideToMove &&
-            (!isMill(s, i) || everythingInMill)) {
+            (!isMill<V>(s, i) || everythingInMill)) {
             AdvancedMove m2 = m;
             m2.takeHon = i;
             r.push_back(m2);
@@ -223,20 +244,21 @@ std::vector<AdvancedMove> PerfectPlayer::with_taking_moves(const GameState &s,
     return r;
 }
 
+template <class V>
 std::vector<AdvancedMove> PerfectPlayer::only_taking_moves(const GameState &s)
 {
     // there's some copy-paste code here
     std::vector<AdvancedMove> r;
     bool everythingInMill = true;
     for (int i = 0; i < 24; ++i) {
-        if (s.board[i] == 1 - s.sideToMove && !isMill(s, i)) {
+        if (s.board[i] == 1 - s.sideToMove && !isMill<V>(s, i)) {
             everythingInMill = false;
         }
     }
 
     for (int i = 0; i < 24; ++i) {
         if (s.board[i] == 1 - s.sideToMove &&
-            (!isMill(s, i) || everythingInMill)) {
+            (!isMill<V>(s, i) || everythingInMill)) {
             r.push_back(AdvancedMove {0, 0, CMoveType::SlideMove, false, true,
                                       i}); // Assuming default values for from
                                            // and to
@@ -245,28 +267,21 @@ std::vector<AdvancedMove> PerfectPlayer::only_taking_moves(const GameState &s)
     return r;
 }
 
-#ifdef _MSC_VER
-#pragma warning(push)
-#pragma warning(disable : 4127)
-#pragma warning(push)
-#pragma warning(disable : 6285)
-#endif
-
+template <class V>
 std::vector<AdvancedMove> PerfectPlayer::get_move_list(const GameState &s)
 {
     std::vector<AdvancedMove> ms0, ms;
     if (!s.kle) {
-        if (ruleVariant == (int)Wrappers::Constants::Variants::std ||
-            ruleVariant == (int)Wrappers::Constants::Variants::mora) {
-            if (s.setStoneCount[s.sideToMove] < Rules::maxKSZ) {
-                ms0 = set_moves(s);
+        if constexpr (!V::mixedPlacement) {
+            if (s.setStoneCount[s.sideToMove] < V::maxKSZ) {
+                ms0 = set_moves<V>(s);
             } else {
-                ms0 = slide_moves(s);
+                ms0 = slide_moves<V>(s);
             }
         } else { // Lasker
-            ms0 = slide_moves(s);
-            if (s.setStoneCount[s.sideToMove] < Rules::maxKSZ) {
-                std::vector<AdvancedMove> setMovesResult = set_moves(s);
+            ms0 = slide_moves<V>(s);
+            if (s.setStoneCount[s.sideToMove] < V::maxKSZ) {
+                std::vector<AdvancedMove> setMovesResult = set_moves<V>(s);
                 ms0.insert(ms0.end(), setMovesResult.begin(),
                            setMovesResult.end());
             }
@@ -277,21 +292,24 @@ std::vector<AdvancedMove> PerfectPlayer::get_move_list(const GameState &s)
                 ms.push_back(ms0[i]);
             } else {
                 std::vector<AdvancedMove> withTakingMovesResult =
-                    with_taking_moves(s, ms0[i]);
+                    with_taking_moves<V>(s, ms0[i]);
                 ms.insert(ms.end(), withTakingMovesResult.begin(),
                           withTakingMovesResult.end());
             }
         }
     } else { // kle
-        ms = only_taking_moves(s);
+        ms = only_taking_moves<V>(s);
     }
+    Stats::add(Stat::moves_generated, ms.size());
     return ms;
 }
 
-#ifdef _MSC_VER
-#pragma warning(pop)
-#pragma warning(pop)
-#endif
+std::vector<AdvancedMove> PerfectPlayer::get_move_list(const GameState &s)
+{
+    return visit_variant(ruleVariant, [&](auto v) {
+        return get_move_list<decltype(v)>(s);
+    });
+}
 
 GameState PerfectPlayer::make_move_in_state(const GameState &s, AdvancedMove &m)
 {
@@ -323,6 +341,39 @@ GameState PerfectPlayer::make_move_in_state(const GameState &s, AdvancedMove &m)
     return s2;
 }
 
+GameState PerfectPlayer::sector_state(const Id &id, board a)
+{
+    GameState s;
+    for (int k = 0; k < 24; k++)
+        s.board[k] = (a >> k) & 1 ? 0 : ((a >> (k + 24)) & 1 ? 1 : -1);
+    s.stoneCount[0] = id.W;
+    s.stoneCount[1] = id.B;
+    s.setStoneCount[0] = Rules::maxKSZ - id.WF;
+    s.setStoneCount[1] = Rules::maxKSZ - id.BF;
+    s.phase = id.WF == 0 && id.BF == 0 ? 2 : 1;
+    s.sideToMove = 0;
+    return s;
+}
+
+void PerfectPlayer::sector_child(const AdvancedMove &m, board &a, Id &id)
+{
+    board w = a & mask24, b = (a >> 24) & mask24;
+    if (m.moveType == CMoveType::SetMove) {
+        id.W++;
+        id.WF--;
+    } else {
+        w &= ~(1LL << m.from);
+    }
+    w |= 1LL << m.to;
+    if (m.withTaking) {
+        b &= ~(1LL << m.takeHon);
+        id.B--;
+    }
+    // Black is to move in the child.
+    a = b | (w << 24);
+    id.negate_id();
+}
+
 // Assuming gui_eval_elem2 and get_sector functions are defined somewhere
 Wrappers::gui_eval_elem2 PerfectPlayer::move_value(const GameState &s,
                                                    AdvancedMove &m)
@@ -519,7 +570,8 @@ std::mutex evalLock;
 
 Wrappers::gui_eval_elem2 PerfectPlayer::evaluate(GameState s)
 {
-    std::lock_guard<std::mutex> lock(evalLock);
+    TimedLockGuard<std::mutex> lock(evalLock, Stat::eval_lock_wait_ns);
+    Stats::add(Stat::evaluations);
 
     if (s.kle) {
         return Wrappers::gui_eval_elem2::min_value(nullptr);
@@ -540,6 +592,77 @@ Wrappers::gui_eval_elem2 PerfectPlayer::evaluate(GameState s)
         return Wrappers::gui_eval_elem2::min_value(nullptr);
     }
 
+    int64_t board_hash = sector_board(s);
+
+    // Use the WSector's hash method to get the correct index
+    int hash_index = sec->hash(board_hash).first;
+    if (PerfectErrors::hasError()) {
+        return Wrappers::gui_eval_elem2::min_value(nullptr);
+    }
+
+    // Get the raw evaluation and then convert it to the required wrapper type
+    eval_elem2 raw_eval = sec->s->get_eval(hash_index);
+    return Wrappers::gui_eval_elem2(raw_eval, sec->s);
+}
+
+bool PerfectPlayer::evaluate_wdl(const GameState &s, int &wdl)
+{
+    // The database has no entries for stone-removal positions
+    if (s.kle) {
+        return false;
+    }
+
+    {
+        TimedLockGuard<std::mutex> lock(evalLock, Stat::eval_lock_wait_ns);
+
+        if (get_future_piece_count(s) < 3) {
+            wdl = -1;
+            return true;
+        }
+
+        Wrappers::WSector *sec = get_sector(s);
+        if (sec == nullptr) {
+            return false;
+        }
+
+        if (sec->wdl(sector_board(s), wdl)) {
+            return true;
+        }
+    }
+
+    // No plane for this sector: decode the full entry and classify it the
+    // same way the plane generator does.
+    Wrappers::gui_eval_elem2 e = evaluate(s);
+    if (PerfectErrors::hasError()) {
+        return false;
+    }
+    sec_val v = e.akey1();
+    wdl = v == virt_win_val ? 1 : (v == virt_loss_val ? -1 : 0);
+    return true;
+}
+
+bool PerfectPlayer::canonical_index(const GameState &s, Id &id, int &index,
+                                    int &op)
+{
+    if (s.kle) {
+        SET_ERROR_CODE(PerfectErrors::PE_INVALID_ARGUMENT, "The database has "
+                                                           "no entries for "
+                                                           "stone-removal "
+                                                           "positions");
+        return false;
+    }
+
+    TimedLockGuard<std::mutex> lock(evalLock, Stat::eval_lock_wait_ns);
+    Wrappers::WSector *sec = get_sector(s);
+    if (sec == nullptr)
+        return false;
+    id = sec->s->id;
+    return sec->canonical_index(sector_board(s), index, op);
+}
+
+// The board in the sector's frame: the side to move is always white.
+int64_t PerfectPlayer::sector_board(const GameState &s)
+{
     // Manually calculate the board hash value (re-instating logic from a
     // previous version)
     int64_t board_hash = 0;
@@ -556,15 +679,7 @@ Wrappers::gui_eval_elem2 PerfectPlayer::evaluate(GameState s)
         board_hash = negate_board(board_hash);
     }
 
-    // Use the WSector's hash method to get the correct index
-    int hash_index = sec->hash(board_hash).first;
-    if (PerfectErrors::hasError()) {
-        return Wrappers::gui_eval_elem2::min_value(nullptr);
-    }
-
-    // Get the raw evaluation and then convert it to the required wrapper type
-    eval_elem2 raw_eval = sec->s->get_eval(hash_index);
-    return Wrappers::gui_eval_elem2(raw_eval, sec->s);
+    return board_hash;
 }
 
 int64_t PerfectPlayer::negate_board(int64_t a)
@@ -137,26 +137,44 @@ public:
 
     int get_future_piece_count(const GameState &s);
 
-    bool makes_mill(const GameState &s, int from, int to);
-
+    // The move generator is instantiated once per variant policy V (see
+    // perfect_variant.h); get_move_list dispatches on ruleVariant.
+    template <class V>
     bool isMill(const GameState &s, int m);
 
+    template <class V>
     std::vector<AdvancedMove> set_moves(const GameState &s);
 
+    template <class V>
     std::vector<AdvancedMove> slide_moves(const GameState &s);
 
     // m has a withTaking step, where takeHon is not filled out. This function
     // creates a list, the elements of which are copies of m supplemented with
     // one possible removal each.
+    template <class V>
     std::vector<AdvancedMove> with_taking_moves(const GameState &s,
                                                 AdvancedMove &m);
 
+    template <class V>
     std::vector<AdvancedMove> only_taking_moves(const GameState &s);
 
+    template <class V>
+    std::vector<AdvancedMove> get_move_list(const GameState &s);
+
     std::vector<AdvancedMove> get_move_list(const GameState &s);
 
     GameState make_move_in_state(const GameState &s, AdvancedMove &m);
 
+    // The position of sector id stored at a (white stones in the low 24
+    // bits, black in the next 24), with white to move.
+    static GameState sector_state(const Id &id, board a);
+
+    // Applies m, a move of white in sector id, to a and id and swaps the
+    // sides, giving the child as its sector stores it. Unlike
+    // make_move_in_state, only the stones and the stones to place are kept,
+    // which is all a database value depends on.
+    static void sector_child(const AdvancedMove &m, board &a, Id &id);
+
     // Assuming gui_eval_elem2 and get_sector functions are defined somewhere
     Wrappers::gui_eval_elem2 move_value(const GameState &s, AdvancedMove &m);
 
@@ -239,7 +257,19 @@ out:
 
     Wrappers::gui_eval_elem2 evaluate(GameState s);
 
+    // Game-theoretic win/draw/loss, read from the sector's .wdl2 plane if
+    // there is one and from the full entry otherwise. Returns false for
+    // stone-removal positions and on errors.
+    bool evaluate_wdl(const GameState &s, int &wdl);
+
+    // The sector of s and the canonical index of its board there (see
+    // Hash::canonical_index), without reading the sector file. Returns
+    // false, with an error set, for stone-removal positions and for
+    // positions of missing sectors.
+    bool canonical_index(const GameState &s, Id &id, int &index, int &op);
+
     int64_t negate_board(int64_t a);
+    int64_t sector_board(const GameState &s);
 };
 
 #endif // PERFECT_PLAYER_H_INCLUDED
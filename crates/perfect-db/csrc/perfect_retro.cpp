@@ -0,0 +1,294 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_retro.cpp
+
+#include "perfect_retro.h"
+#include "perfect_hash.h"
+#include "perfect_sector.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Retro {
+
+Storage::Storage(int64_t budget, std::string scratch_dir)
+    : budget(budget)
+    , dir(std::move(scratch_dir))
+{ }
+
+void *Storage::acquire(int64_t bytes, bool &in_file)
+{
+    in_file = false;
+    if (dir.empty() || used + bytes <= budget) {
+        if (void *p = calloc((size_t)bytes, 1)) {
+            used += bytes;
+            return p;
+        }
+    }
+#ifndef _WIN32
+    if (!dir.empty()) {
+        // The file is unlinked right away, so that it goes with the mapping
+        // even if the process dies.
+        std::string path = dir + "/retro-XXXXXX";
+        int fd = mkstemp(&path[0]);
+        if (fd != -1) {
+            unlink(path.c_str());
+            void *p = MAP_FAILED;
+            if (ftruncate(fd, (off_t)bytes) == 0)
+                p = mmap(nullptr, (size_t)bytes, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+            close(fd);
+            if (p != MAP_FAILED) {
+                in_file = true;
+                return p;
+            }
+        }
+        SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                          "Cannot map " + std::to_string(bytes) +
+                              " bytes of scratch space in " + dir);
+        return nullptr;
+    }
+#endif
+    SET_ERROR_MESSAGE(PerfectErrors::PE_OUT_OF_MEMORY,
+                      "Cannot allocate " + std::to_string(bytes) + " bytes");
+    return nullptr;
+}
+
+void Storage::release(void *p, int64_t bytes, bool in_file)
+{
+#ifndef _WIN32
+    if (in_file) {
+        munmap(p, (size_t)bytes);
+        return;
+    }
+#endif
+    free(p);
+    used -= bytes;
+}
+
+bool exit_value(const Unit &u, const Part &p, const Id &cid, board c,
+                Wrappers::gui_eval_elem2 &v)
+{
+    v = Wrappers::gui_eval_elem2::virt_loss_val();
+    if (cid.W + cid.WF >= 3) {
+        auto it = u.loaded.find(cid);
+        if (it == u.loaded.end()) {
+            SET_ERROR_MESSAGE(PerfectErrors::PE_DATABASE_NOT_FOUND,
+                              "Child in unexpected sector " +
+                                  Id(cid).to_string());
+            return false;
+        }
+        v = Wrappers::gui_eval_elem2(it->second->hash->hash(c).second,
+                                     it->second);
+        if (PerfectErrors::hasError())
+            return false;
+    }
+    v = v.undo_negate(p.ws);
+    return true;
+}
+
+// For each level L (the absolute values of the exits, highest first), the
+// nodes that can force a result of at least L and those that cannot avoid
+// one of -L or worse grow backwards from the exits over the moves inside the
+// unit; both only grow as L decreases, so every node and move is visited
+// once in all. The nodes left over are draws.
+bool solve_levels(Graph &g, Storage &storage)
+{
+    const int64_t n = g.n;
+    // Moves of each node not yet known to lose (to lead to a won node).
+    Array<int32_t> &left = g.out;
+
+    // The nodes with a decisive exit, by its absolute value (a counting
+    // sort, as key1 is 16 bits).
+    const int levels = 1 << 15;
+    std::vector<int64_t> start(levels + 2, 0);
+    for (int64_t i = 0; i < n; i++)
+        if (g.ek1[i] != no_exit && g.ek1[i] != 0)
+            start[std::abs(g.ek1[i]) + 1]++;
+    for (int l = 0; l <= levels; l++)
+        start[l + 1] += start[l];
+    Array<int32_t> order, queue;
+    if (!g.k1.allocate(storage, n) ||
+        !order.allocate(storage, start[levels + 1]) ||
+        !queue.allocate(storage, n))
+        return false;
+    {
+        std::vector<int64_t> fill(start.begin(), start.end() - 1);
+        for (int64_t i = 0; i < n; i++)
+            if (g.ek1[i] != no_exit && g.ek1[i] != 0)
+                order[fill[std::abs(g.ek1[i])]++] = (int32_t)i;
+    }
+
+    // Every node is decided (gets a non-zero k1) and queued once.
+    int64_t head = 0, tail = 0;
+    auto decide = [&](int32_t i, int value) {
+        if (!g.k1[i]) {
+            g.k1[i] = (int16_t)value;
+            queue[tail++] = i;
+        }
+    };
+    for (int level = levels; level > 0; level--) {
+        if (start[level] == start[level + 1])
+            continue;
+        for (int64_t k = start[level]; k < start[level + 1]; k++) {
+            const int32_t i = order[k];
+            if (g.ek1[i] > 0)
+                decide(i, level);
+            else if (left[i] == 0)
+                decide(i, -level);
+        }
+
+        for (; head < tail; head++) {
+            const int32_t c = queue[head];
+            for (int64_t e = g.offset[c]; e < g.offset[c + 1]; e++) {
+                const int32_t p = g.pred[e];
+                if (g.k1[c] < 0)
+                    decide(p, level);
+                else if (--left[p] == 0 && g.ek1[p] <= -level)
+                    decide(p, -level);
+            }
+        }
+    }
+    return true;
+}
+
+// A won node takes its quickest way to its level, a lost node the slowest.
+// The nodes are settled in the order of their key2, a won one at its first
+// settled option and a lost one when all its options are settled. The keys
+// of the nodes that start settled (the exits) are sorted; the ones reached
+// from a node settled at d get d + 1, so they come in order in a queue, and
+// the two lists are merged.
+bool solve_steps(Graph &g, Storage &storage)
+{
+    const int64_t n = g.n;
+    // Options of each lost node (moves to nodes won on the same level) not
+    // yet settled.
+    Array<int32_t> &left = g.out;
+    std::fill(left.data(), left.data() + n, 0);
+    for (int64_t c = 0; c < n; c++) {
+        if (g.k1[c] <= 0)
+            continue;
+        for (int64_t e = g.offset[c]; e < g.offset[c + 1]; e++)
+            if (g.k1[g.pred[e]] == -g.k1[c])
+                left[g.pred[e]]++;
+    }
+
+    int64_t m = 0;
+    for (int64_t i = 0; i < n; i++) {
+        const bool exit = g.k1[i] && g.ek1[i] == g.k1[i];
+        m += exit || (g.k1[i] < 0 && left[i] == 0);
+    }
+    Array<int32_t> sorted, queue;
+    Array<uint8_t> settled;
+    if (!sorted.allocate(storage, m) || !queue.allocate(storage, n) ||
+        !settled.allocate(storage, n))
+        return false;
+
+    m = 0;
+    for (int64_t i = 0; i < n; i++) {
+        g.k2[i] = 0;
+        if (g.k1[i] == 0)
+            continue;
+        const bool exit = g.ek1[i] == g.k1[i];
+        if (g.k1[i] > 0)
+            g.k2[i] = exit ? g.ek2[i] : INT32_MAX;
+        else
+            g.k2[i] = exit ? g.ek2[i] : INT32_MIN;
+        // A lost node with options waits for them; if it has an exit as
+        // well it is listed, and passed over while it waits.
+        if (exit || (g.k1[i] < 0 && left[i] == 0))
+            sorted[m++] = (int32_t)i;
+    }
+    std::sort(sorted.data(), sorted.data() + m, [&](int32_t a, int32_t b) {
+        return g.k2[a] < g.k2[b];
+    });
+
+    int64_t s = 0, head = 0, tail = 0;
+    while (s < m || head < tail) {
+        int32_t c;
+        if (head == tail || (s < m && g.k2[sorted[s]] <= g.k2[queue[head]]))
+            c = sorted[s++];
+        else
+            c = queue[head++];
+        if (settled[c] || (g.k1[c] < 0 && left[c] > 0))
+            continue;
+        settled[c] = 1;
+        const int32_t d = g.k2[c];
+        for (int64_t e = g.offset[c]; e < g.offset[c + 1]; e++) {
+            const int32_t p = g.pred[e];
+            if (g.k1[p] != -g.k1[c])
+                continue;
+            if (g.k1[p] > 0) {
+                if (d + 1 < g.k2[p]) {
+                    g.k2[p] = d + 1;
+                    queue[tail++] = p;
+                }
+            } else {
+                g.k2[p] = std::max(g.k2[p], d + 1);
+                if (--left[p] == 0 && g.k2[p] == d + 1)
+                    queue[tail++] = p;
+            }
+        }
+    }
+    return true;
+}
+
+bool encode(const Graph &g, int64_t base, int64_t count, int threads,
+            const std::function<bool(const void *, size_t)> &write)
+{
+    unsigned char header[Sector::header_size] = {};
+    const int fields[3] = {version, eval_struct_size, field2Offset};
+    memcpy(header, fields, sizeof(fields));
+    header[sizeof(fields)] = stone_diff_flag;
+    if (!write(header, sizeof(header)))
+        return false;
+
+    // The entries go out a block at a time; the em_set, for the key2 values
+    // that do not fit in an entry, follows them.
+    const int spec_field2 = -(1 << (field2Size - 1));
+    const int64_t block = chunk << 8;
+    std::vector<unsigned char> buffer;
+    std::vector<int32_t> em;
+    for (int64_t lo = 0; lo < count; lo += block) {
+        const int64_t size = std::min(block, count - lo);
+        buffer.resize((size_t)(size * eval_struct_size));
+        std::vector<std::vector<int32_t>> em_parts((size + chunk - 1) / chunk);
+        parallel(size, threads, [&](int64_t from, int64_t to, int64_t c) {
+            for (int64_t k = from; k < to; k++) {
+                const int64_t i = lo + k;
+                const int key1 = g.k1[base + i];
+                const int key2 = key1 ? g.k2[base + i] : 0;
+                int field2 = key2;
+                if (key2 <= spec_field2 || key2 > -spec_field2 - 1) {
+                    field2 = spec_field2;
+                    em_parts[c].push_back((int32_t)i);
+                    em_parts[c].push_back(key2);
+                }
+                const uint32_t a =
+                    ((uint32_t)key1 & ((1u << field1Size) - 1)) |
+                    (((uint32_t)field2 & ((1u << field2Size) - 1))
+                     << field2Offset);
+                unsigned char *e = buffer.data() + eval_struct_size * k;
+                for (int j = 0; j < eval_struct_size; j++)
+                    e[j] = (unsigned char)(a >> (8 * j));
+            }
+            return true;
+        });
+        if (!write(buffer.data(), buffer.size()))
+            return false;
+        for (auto &v : em_parts)
+            em.insert(em.end(), v.begin(), v.end());
+    }
+
+    const int32_t em_set_size = (int32_t)(em.size() / 2);
+    return write(&em_set_size, 4) &&
+           (em.empty() || write(em.data(), em.size() * 4));
+}
+
+} // namespace Retro
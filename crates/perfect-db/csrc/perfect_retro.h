@@ -0,0 +1,291 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_retro.h
+//
+// The retrograde core shared by the solvers of perfect_solve.cpp (missing
+// sectors, in memory, with the rules of the oracle) and perfect_batch.cpp
+// (whole databases for other rule sets, on disk).
+//
+// A solve unit is one or more sectors as one graph: node base + i is hash
+// index i of a part. The caller's move generator gives, for every node, the
+// best value of its moves that leave the unit (the exits, already read from
+// the solved successors) and the moves that stay in it. The graph is built
+// from these in two parallel passes (counting the predecessors of each node,
+// then storing them, so that only the reverse of the moves is kept), then
+// solve_levels finds key1 and solve_steps key2 of every node, and encode
+// writes the entries of a part in the .sec2 format of Sector::write_header.
+//
+// The arrays go through a Storage: on the heap while the bytes held there
+// stay under its budget, and beyond that in unlinked scratch files that are
+// mapped, so that the page cache keeps what fits and the rest is written out.
+
+#ifndef PERFECT_RETRO_H_INCLUDED
+#define PERFECT_RETRO_H_INCLUDED
+
+#include "perfect_common.h"
+#include "perfect_errors.h"
+#include "perfect_eval_elem.h"
+#include "perfect_wrappers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Retro {
+
+// Nodes handed to a thread at a time.
+const int64_t chunk = 1 << 12;
+
+// ek1 of a node whose moves all stay in the unit.
+const int16_t no_exit = INT16_MIN;
+
+class Storage
+{
+public:
+    // budget: bytes of heap the arrays may hold; scratch_dir: where the
+    // rest goes (empty: nowhere, the heap is used regardless of the budget).
+    explicit Storage(int64_t budget = INT64_MAX, std::string scratch_dir = {});
+
+    // Zero-filled memory, or nullptr with an error set.
+    void *acquire(int64_t bytes, bool &in_file);
+    void release(void *p, int64_t bytes, bool in_file);
+
+    int64_t heap_bytes() const { return used; }
+
+private:
+    int64_t budget;
+    std::string dir;
+    std::atomic<int64_t> used {0};
+};
+
+// A fixed-size array of a Storage.
+template <class T>
+class Array
+{
+public:
+    Array() { }
+    Array(const Array &) = delete;
+    Array &operator=(const Array &) = delete;
+    ~Array() { reset(); }
+
+    // n zero-filled elements; false with an error set.
+    bool allocate(Storage &storage, int64_t count)
+    {
+        reset();
+        const int64_t bytes = std::max<int64_t>(1, count) * sizeof(T);
+        p = static_cast<T *>(storage.acquire(bytes, in_file));
+        if (!p)
+            return false;
+        st = &storage;
+        n = count;
+        return true;
+    }
+
+    void reset()
+    {
+        if (p)
+            st->release(p, std::max<int64_t>(1, n) * sizeof(T), in_file);
+        p = nullptr;
+        n = 0;
+    }
+
+    T &operator[](int64_t i) { return p[i]; }
+    const T &operator[](int64_t i) const { return p[i]; }
+    T *data() { return p; }
+    int64_t size() const { return n; }
+
+private:
+    Storage *st {nullptr};
+    T *p {nullptr};
+    int64_t n {0};
+    bool in_file {false};
+};
+
+struct Graph
+{
+    int64_t n {0};
+
+    // The best exit of each node, from its own viewpoint.
+    Array<int16_t> ek1;
+    Array<int32_t> ek2;
+    // The moves of each node that stay in the unit, and their reverse:
+    // pred[offset[c] .. offset[c + 1]) are the nodes with a move to c.
+    Array<int32_t> out;
+    Array<int64_t> offset;
+    Array<int32_t> pred;
+
+    // The solution, as key1 and key2 of the entries.
+    Array<int16_t> k1;
+    Array<int32_t> k2;
+
+    int64_t edges() const { return n ? offset[n] : 0; }
+};
+
+struct Part
+{
+    Id id;
+    Wrappers::WSector *ws;
+    int64_t base;  // node of hash index 0
+    int64_t count; // hash_count
+};
+
+// The sectors solved together (a sector, or a sector and its partner, as in
+// the wus of the sector graph) and the successor sectors they read.
+struct Unit
+{
+    std::vector<Part> parts;
+    int64_t n {0};
+    // The successor sectors, loaded.
+    std::map<Id, Sector *> loaded;
+    Graph graph;
+
+    Part &part_of(int64_t i)
+    {
+        return parts[parts.size() > 1 && i >= parts[1].base];
+    }
+
+    const Part *find(const Id &id) const
+    {
+        for (const Part &p : parts)
+            if (p.id == id)
+                return &p;
+        return nullptr;
+    }
+};
+
+// The value, for a node of p, of its move to c in the sector cid outside
+// the unit (a loss of the mover's opponent if cid is below 3 stones). False
+// with an error set if it cannot be read.
+bool exit_value(const Unit &u, const Part &p, const Id &cid, board c,
+                Wrappers::gui_eval_elem2 &v);
+
+// Runs f(lo, hi, chunk index) over [0, n) on the given number of threads.
+// f returns false (with an error set) to stop the others; the first error is
+// passed on to the calling thread.
+template <class F>
+bool parallel(int64_t n, int threads, F f)
+{
+    const int64_t chunks = (n + chunk - 1) / chunk;
+    threads = (int)std::max<int64_t>(1, std::min<int64_t>(threads, chunks));
+
+    std::atomic<int64_t> next {0};
+    std::atomic<bool> failed {false};
+    std::mutex mutex;
+    PerfectErrors::ErrorCode code = PerfectErrors::PE_NO_ERROR;
+    std::string message;
+    auto work = [&] {
+        for (int64_t c; !failed && (c = next.fetch_add(1)) < chunks;) {
+            if (f(c * chunk, std::min(n, (c + 1) * chunk), c))
+                continue;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!failed) {
+                code = PerfectErrors::getLastErrorCode();
+                message = PerfectErrors::getLastErrorMessage();
+                failed = true;
+            }
+            PerfectErrors::clearError();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int w = 1; w < threads; w++)
+        workers.emplace_back(work);
+    work();
+    for (auto &w : workers)
+        w.join();
+
+    if (failed)
+        SET_ERROR_MESSAGE(code, message);
+    return !failed;
+}
+
+// Builds g over n nodes. expand(i, exits, inside, best, has_exit) generates
+// the moves of node i: the ones that stay in the unit are passed to
+// inside(node); with exits set, the best value of the others (or of having
+// no moves) goes to best, and has_exit tells if there was any. It returns
+// false with an error set if it could not read an exit.
+template <class Expand>
+bool build(Graph &g, Storage &storage, int64_t n, int threads, Expand expand)
+{
+    g.n = n;
+    if (!g.ek1.allocate(storage, n) || !g.ek2.allocate(storage, n) ||
+        !g.out.allocate(storage, n) || !g.k2.allocate(storage, n))
+        return false;
+    // The predecessor counts, then the fill positions, live in k2 until
+    // solve_steps.
+    Array<int32_t> &in = g.k2;
+
+    bool ok = parallel(n, threads, [&](int64_t lo, int64_t hi, int64_t) {
+        for (int64_t i = lo; i < hi; i++) {
+            Wrappers::gui_eval_elem2 best =
+                Wrappers::gui_eval_elem2::virt_loss_val();
+            bool has_exit;
+            int32_t moves = 0;
+            auto inside = [&](int64_t c) {
+                std::atomic_ref<int32_t>(in[c]).fetch_add(
+                    1, std::memory_order_relaxed);
+                moves++;
+            };
+            if (!expand(i, true, inside, best, has_exit))
+                return false;
+            g.out[i] = moves;
+            g.ek1[i] = no_exit;
+            if (has_exit) {
+                eval_elem2 e = best.keys();
+                g.ek1[i] = e.key1;
+                g.ek2[i] = e.key2;
+            }
+        }
+        return true;
+    });
+    if (!ok || !g.offset.allocate(storage, n + 1))
+        return false;
+
+    for (int64_t i = 0; i < n; i++) {
+        g.offset[i + 1] = g.offset[i] + in[i];
+        in[i] = 0;
+    }
+    if (!g.pred.allocate(storage, g.offset[n]))
+        return false;
+
+    return parallel(n, threads, [&](int64_t lo, int64_t hi, int64_t) {
+        for (int64_t i = lo; i < hi; i++) {
+            if (g.out[i] == 0)
+                continue;
+            Wrappers::gui_eval_elem2 best =
+                Wrappers::gui_eval_elem2::virt_loss_val();
+            bool has_exit;
+            auto inside = [&](int64_t c) {
+                g.pred[g.offset[c] + std::atomic_ref<int32_t>(in[c]).fetch_add(
+                                         1, std::memory_order_relaxed)] =
+                    (int32_t)i;
+            };
+            if (!expand(i, false, inside, best, has_exit))
+                return false;
+        }
+        return true;
+    });
+}
+
+// key1 of every node (after build). False with an error set if the storage
+// is exhausted.
+bool solve_levels(Graph &g, Storage &storage);
+
+// key2 of every node (after solve_levels).
+bool solve_steps(Graph &g, Storage &storage);
+
+// Writes the .sec2 file of the part [base, base + count) of g through
+// write(bytes, size), which returns false (with an error set) to stop.
+bool encode(const Graph &g, int64_t base, int64_t count, int threads,
+            const std::function<bool(const void *, size_t)> &write);
+
+} // namespace Retro
+
+#endif // PERFECT_RETRO_H_INCLUDED
@@ -13,55 +13,89 @@
 #include <cassert>
 #include <cstdint>
 #include <iostream>
+#include <string>
 #include <vector>
 
-class GameState;
+#include "perfect_game_state.h"
+#include "perfect_variant.h"
 
 class Rules
 {
 public:
-    // Define your byte arrays
-    static uint8_t millPos[20][3]; // TODO: Initial: [16][3];
-    static uint8_t stdLaskerMillPos[16][3];
-    static uint8_t moraMillPos[20][3];
-
-    // Define your integer arrays
-    static int *invMillPos[24];
-    static size_t invMillPosLengths[24];
-    static int *stdLaskerInvMillPos[24];
-    static int *moraInvMillPos[24];
-
-    // Define your boolean arrays
-    static bool boardGraph[24][24];
-    static bool stdLaskerBoardGraph[24][24];
-    static bool moraBoardGraph[24][24];
-
-    // Define your adjacency list byte arrays
-    static uint8_t aLBoardGraph[24][5];
-    static uint8_t stdLaskerALBoardGraph[24][5];
-    static uint8_t moraALBoardGraph[24][5];
-
-    // Define other variables
+    // Of the variant selected by set_variant. The mill and adjacency tables
+    // are only read through the policies of perfect_variant.h.
     static std::string variantName;
     static int maxKSZ;
     static const int lastIrrevLimit = 50;
 
 public:
-    static void init_rules();
-    static void cleanup_rules();
-
     // Returns -1 if there is no mill on the given field, otherwise returns the
     // sequence number in StdLaskerMalomPoz
-    static int check_mill(int m, GameState s);
+    template <class V>
+    static int check_mill(int m, const GameState &s)
+    {
+        int result = -1;
+        for (int i = 0; i < V::tables.invMillPosLengths[m]; i++) {
+            const int mill = V::tables.invMillPos[m][i];
+            const uint8_t *p = V::tables.millPos[mill];
+            if (s.board[p[0]] == s.board[m] && s.board[p[1]] == s.board[m] &&
+                s.board[p[2]] == s.board[m]) {
+                result = mill;
+            }
+        }
+        return result;
+    }
+    static int check_mill(int m, const GameState &s);
+
+    // Whether moving a stone of the side to move from `from` (-1: placing)
+    // to `to` closes a mill, without making the move
+    template <class V>
+    static bool makes_mill(const GameState &s, int from, int to)
+    {
+        for (int i = 0; i < V::tables.invMillPosLengths[to]; i++) {
+            const uint8_t *p = V::tables.millPos[V::tables.invMillPos[to][i]];
+            bool mill = true;
+            for (int k = 0; k < 3; k++) {
+                const int sq = p[k];
+                if (sq != to && (sq == from || s.board[sq] != s.sideToMove))
+                    mill = false;
+            }
+            if (mill) {
+                return true;
+            }
+        }
+        return false;
+    }
 
     // Tells whether the next player can move '(doesn't handle the kle case)
+    template <class V>
+    static bool can_move(const GameState &s)
+    {
+        assert(!s.kle);
+        if (s.setStoneCount[s.sideToMove] == V::maxKSZ &&
+            s.stoneCount[s.sideToMove] > 3) {
+            for (int i = 0; i <= 23; i++) {
+                if (s.board[i] == s.sideToMove) {
+                    const uint8_t *al = V::tables.aLBoardGraph[i];
+                    for (int j = 1; j <= al[0]; j++) {
+                        if (s.board[al[j]] == -1)
+                            return true;
+                    }
+                }
+            }
+        } else {
+            return true;
+        }
+        return false;
+    }
     static bool can_move(const GameState &s);
 
-    static bool all_opponent_pieces_in_mill(GameState s);
+    static bool all_opponent_pieces_in_mill(const GameState &s);
 
     // Checking if AlphaBeta is available
     static bool is_alpha_beta_available();
 
+    // Selects maxKSZ and variantName of ruleVariant
     static void set_variant();
 };
 
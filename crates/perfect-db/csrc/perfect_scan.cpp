@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_scan.cpp
+
+#include "perfect_scan.h"
+#include "perfect_errors.h"
+#include "perfect_hash.h"
+
+#include <algorithm>
+
+namespace {
+
+const int64_t read_alignment = 4096;
+
+} // namespace
+
+SectorScan::SectorScan(Sector *sector, int first)
+    : s(sector)
+    , count(sector->hash ? sector->hash->hash_count : 0)
+{
+    chunks = (count + chunk_entries - 1) / chunk_entries;
+    next_read = next_release = std::min(std::max(first, 0) / chunk_entries,
+                                        chunks);
+    s->advise_sequential();
+    reader = std::thread(&SectorScan::read_ahead, this);
+}
+
+SectorScan::~SectorScan()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    reader.join();
+}
+
+void SectorScan::read_ahead()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        cv.wait(lock, [this] {
+            return stopping ||
+                   (next_read < chunks && next_read < next_release + 2);
+        });
+        if (stopping)
+            return;
+        // The buffer last held chunk k - 2, which the caller is done with.
+        const int k = next_read++;
+        Buffer &b = buffers[k % 2];
+        lock.unlock();
+
+        const int n = std::min(chunk_entries, count - k * chunk_entries);
+        const int64_t offset = Sector::header_size +
+                               (int64_t)eval_struct_size * k * chunk_entries;
+        const int64_t start = offset & ~(read_alignment - 1);
+        b.skip = (int)(offset - start);
+        b.raw.resize(b.skip + (size_t)eval_struct_size * n);
+        const bool ok = s->read_at(start, b.raw.data(), b.raw.size());
+
+        lock.lock();
+        b.chunk = k;
+        b.ok = ok;
+        cv.notify_all();
+    }
+}
+
+bool SectorScan::get(int i, eval_elem_sym2 &out)
+{
+    if (i < 0 || i >= count) {
+        SET_ERROR_CODE(PerfectErrors::PE_OUT_OF_RANGE, "Scan index out of "
+                                                       "range");
+        return false;
+    }
+
+    const int k = i / chunk_entries;
+    if (k != decoded_chunk) {
+        assert(k > decoded_chunk);
+        Buffer &b = buffers[k % 2];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // Chunks skipped over are not read any more.
+            next_read = std::max(next_read, k);
+            next_release = k;
+            cv.notify_all();
+            cv.wait(lock, [&] { return b.chunk == k; });
+        }
+        if (!b.ok) {
+            SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR, "Failed to read "
+                                                            "the sector "
+                                                            "file");
+            return false;
+        }
+
+        const int n = (int)((b.raw.size() - b.skip) / eval_struct_size);
+        const unsigned char *entry = b.raw.data() + b.skip;
+        decoded.clear();
+        for (int e = 0; e < n; e++, entry += eval_struct_size)
+            decoded.push_back(s->decode_eval(k * chunk_entries + e, entry));
+        decoded_chunk = k;
+
+        // The buffer is free for chunk k + 2 while the entries of this one
+        // are handed out.
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            b.chunk = -1;
+            next_release = k + 1;
+        }
+        cv.notify_all();
+    }
+
+    out = decoded[i - k * chunk_entries];
+    return true;
+}
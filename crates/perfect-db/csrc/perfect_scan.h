@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_scan.h
+//
+// Reading a whole sector in index order (pd_sector_next with
+// pd_set_sector_scan), without one read_at per entry. The evaluations are
+// read in chunks of chunk_entries entries from a 4 KiB aligned offset by a
+// reader thread, which loads the next chunk into the second of two buffers
+// while the caller's thread decodes the current one. The OS is told that the
+// file is read front to back (Sector::advise_sequential), so that its
+// read-ahead runs further than for random lookups.
+
+#ifndef PERFECT_SCAN_H_INCLUDED
+#define PERFECT_SCAN_H_INCLUDED
+
+#include "perfect_eval_elem.h"
+#include "perfect_sector.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class SectorScan
+{
+public:
+    static const int chunk_entries = 1 << 20; // 3 MB of evaluations
+
+    // Starts reading the chunk of entry first. The sector must have its hash
+    // and evals loaded, and stay loaded until the scan is destroyed.
+    SectorScan(Sector *sector, int first = 0);
+    ~SectorScan();
+
+    SectorScan(const SectorScan &) = delete;
+    SectorScan &operator=(const SectorScan &) = delete;
+
+    // get_eval_inner(i) of the sector. i must not decrease from one call to
+    // the next. Returns false with an error set if i is out of range or the
+    // file cannot be read.
+    bool get(int i, eval_elem_sym2 &out);
+
+private:
+    struct Buffer
+    {
+        int chunk {-1}; // chunk held, -1 while free
+        bool ok {false};
+        int skip {0};   // bytes before the first entry (the alignment)
+        std::vector<unsigned char> raw;
+    };
+
+    void read_ahead();
+
+    Sector *s;
+    int count;
+    int chunks;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    Buffer buffers[2];
+    int next_read;     // next chunk for the reader
+    int next_release;  // chunks below are done with
+    bool stopping {false};
+
+    int decoded_chunk {-1};
+    std::vector<eval_elem_sym2> decoded;
+
+    std::thread reader;
+};
+
+#endif // PERFECT_SCAN_H_INCLUDED
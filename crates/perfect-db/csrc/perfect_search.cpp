@@ -0,0 +1,290 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_search.cpp
+
+#include "perfect_search.h"
+#include "perfect_errors.h"
+#include "perfect_rules.h"
+#include "perfect_sec_val.h"
+#include "perfect_wrappers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+
+namespace DbSearch {
+
+namespace {
+
+// Set by pd_set_search_fallback while queries may be running.
+std::atomic<bool> g_enabled(false);
+std::atomic<int64_t> g_max_nodes(1 << 20);
+std::atomic<int> g_max_ms(1000);
+
+const int win = 1 << 24;
+// Scores beyond this are wins and losses; draws are sector values.
+const int decided = win / 2;
+const int infinity = win + 2;
+
+const int max_depth = 64;
+const size_t table_capacity = 1 << 18;
+
+// One ply further from the result: a win in k is a win in k + 1 for the
+// parent (after the negation), a loss likewise.
+int step(int v)
+{
+    return v > decided ? v - 1 : (v < -decided ? v + 1 : v);
+}
+
+int score(Wrappers::gui_eval_elem2 e)
+{
+    const sec_val v = e.akey1();
+    if (v == virt_win_val)
+        return win - e.keys().key2;
+    if (v == virt_loss_val)
+        return -win + e.keys().key2;
+    return v;
+}
+
+// The stones of both sides and the stones to place; the side to move is
+// always white in the frame of the sectors.
+uint64_t key(const Id &id, board a)
+{
+    return (uint64_t)a | ((uint64_t)id.WF << 48) | ((uint64_t)id.BF << 52);
+}
+
+enum class Bound : uint8_t { exact, lower, upper };
+
+struct Entry
+{
+    int depth;
+    int score;
+    Bound bound;
+    bool estimated; // reached a missing sector at the depth limit
+    int best;       // index of the best move, tried first next time
+};
+
+class Search
+{
+public:
+    Search(PerfectPlayer &p, int64_t max_nodes, int max_ms)
+        : player(p)
+        , node_limit(max_nodes)
+        , time_limit(max_ms)
+        , start(std::chrono::steady_clock::now())
+    { }
+
+    int search(const Id &id, board a, int depth, int alpha, int beta);
+
+    // The budget is only checked once this is set, so that the first
+    // iteration completes.
+    bool bounded {false};
+    // Set when the budget ran out or a sector could not be read (with an
+    // error set); the score of the iteration is then meaningless.
+    bool stopped {false};
+    int64_t estimates {0};
+
+private:
+    bool out_of_budget();
+
+    PerfectPlayer &player;
+    int64_t node_limit;
+    int time_limit;
+    std::chrono::steady_clock::time_point start;
+    int64_t nodes {0};
+    std::unordered_map<uint64_t, Entry> table;
+};
+
+bool Search::out_of_budget()
+{
+    nodes++;
+    if (!bounded)
+        return false;
+    if (node_limit > 0 && nodes > node_limit)
+        return true;
+    return time_limit > 0 && (nodes & 255) == 0 &&
+           std::chrono::steady_clock::now() - start >
+               std::chrono::milliseconds(time_limit);
+}
+
+int Search::search(const Id &id, board a, int depth, int alpha, int beta)
+{
+    if (id.W + id.WF < 3)
+        return -win;
+    if (out_of_budget()) {
+        stopped = true;
+        return 0;
+    }
+
+    if (player.secs.count(Wrappers::WID(id))) {
+        Wrappers::gui_eval_elem2 e = player.evaluate(
+            PerfectPlayer::sector_state(id, a));
+        if (PerfectErrors::hasError()) {
+            stopped = true;
+            return 0;
+        }
+        return score(e);
+    }
+    if (depth == 0) {
+        estimates++;
+        return has_sec_val(id) ? get_sec_val(id) : 0;
+    }
+
+    const uint64_t k = key(id, a);
+    int first = -1;
+    auto it = table.find(k);
+    if (it != table.end()) {
+        const Entry &t = it->second;
+        if (t.depth >= depth &&
+            (t.bound == Bound::exact ||
+             (t.bound == Bound::lower && t.score >= beta) ||
+             (t.bound == Bound::upper && t.score <= alpha))) {
+            estimates += t.estimated;
+            return t.score;
+        }
+        first = t.best;
+    }
+
+    std::vector<AdvancedMove> moves = player.get_move_list(
+        PerfectPlayer::sector_state(id, a));
+    // A side without moves has lost.
+    if (moves.empty())
+        return -win;
+    if (first >= (int)moves.size())
+        first = -1;
+
+    const int64_t estimates_before = estimates;
+    const int alpha_before = alpha;
+    int best = -infinity, best_move = 0;
+    for (int j = -1; j < (int)moves.size(); j++) {
+        const int i = j < 0 ? first : j;
+        if (i < 0 || (j >= 0 && i == first))
+            continue;
+        Id cid = id;
+        board c = a;
+        PerfectPlayer::sector_child(moves[i], c, cid);
+        // The window is one wider on both sides, as step moves the scores
+        // of wins and losses by one.
+        const int v = step(-search(cid, c, depth - 1, -beta - 1, -alpha + 1));
+        if (stopped)
+            return 0;
+        if (v > best) {
+            best = v;
+            best_move = i;
+        }
+        alpha = std::max(alpha, best);
+        if (alpha >= beta)
+            break;
+    }
+
+    if (table.size() < table_capacity || it != table.end()) {
+        const Bound bound = best <= alpha_before ?
+                                Bound::upper :
+                                (best >= beta ? Bound::lower : Bound::exact);
+        table[k] = Entry {depth, best, bound, estimates > estimates_before,
+                          best_move};
+    }
+    return best;
+}
+
+} // namespace
+
+void configure(bool enabled, int64_t max_nodes, int max_ms)
+{
+    g_enabled = enabled;
+    g_max_nodes = max_nodes;
+    g_max_ms = max_ms;
+}
+
+bool enabled()
+{
+    return g_enabled;
+}
+
+bool best_moves(PerfectPlayer &player, const GameState &s,
+                std::vector<AdvancedMove> &moves, Value &value, bool &exact)
+{
+    std::vector<AdvancedMove> all = player.get_move_list(s);
+    if (all.empty()) {
+        SET_ERROR_MESSAGE(PerfectErrors::PE_RUNTIME_ERROR,
+                          "No moves to search");
+        return false;
+    }
+
+    // The children in the frame of the sectors, as sector_child gives them.
+    Wrappers::WID w(s.stoneCount[0], s.stoneCount[1],
+                    Rules::maxKSZ - s.setStoneCount[0],
+                    Rules::maxKSZ - s.setStoneCount[1]);
+    if (s.sideToMove == 1)
+        w.negate_id();
+    const board a = player.sector_board(s);
+    std::vector<std::pair<Id, board>> children;
+    for (const AdvancedMove &m : all) {
+        Id cid = w.tonat();
+        board c = a;
+        if (m.onlyTaking) {
+            // sector_child has no removal-only moves, which only occur here.
+            const board b = ((a >> 24) & mask24) & ~(1LL << m.takeHon);
+            c = b | ((a & mask24) << 24);
+            cid.B--;
+            cid.negate_id();
+        } else {
+            PerfectPlayer::sector_child(m, c, cid);
+        }
+        children.emplace_back(cid, c);
+    }
+
+    Search search(player, g_max_nodes, g_max_ms);
+    std::vector<int> result;
+    int result_score = 0;
+    for (int depth = 1; depth <= max_depth; depth++) {
+        search.bounded = depth > 1;
+        const int64_t estimates_before = search.estimates;
+        // The best moves of the last iteration are tried first.
+        std::vector<int> order = result;
+        for (int i = 0; i < (int)all.size(); i++)
+            if (std::find(result.begin(), result.end(), i) == result.end())
+                order.push_back(i);
+
+        std::vector<int> best_set;
+        int best = -infinity;
+        for (int i : order) {
+            // Only the moves at least as good as the best so far need exact
+            // scores.
+            const int alpha = best == -infinity ? -infinity : best - 1;
+            const int v = step(-search.search(children[i].first,
+                                              children[i].second, depth - 1,
+                                              -infinity, -alpha + 1));
+            if (search.stopped)
+                break;
+            if (v > best) {
+                best = v;
+                best_set.clear();
+            }
+            if (v == best)
+                best_set.push_back(i);
+        }
+        if (PerfectErrors::hasError())
+            return false;
+        if (search.stopped)
+            break;
+
+        result = best_set;
+        result_score = best;
+        exact = search.estimates == estimates_before;
+        if (exact)
+            break;
+    }
+
+    moves.clear();
+    for (int i : result)
+        moves.push_back(all[i]);
+    value = result_score > decided ?
+                VALUE_MATE :
+                (result_score < -decided ? -VALUE_MATE : VALUE_DRAW);
+    return true;
+}
+
+} // namespace DbSearch
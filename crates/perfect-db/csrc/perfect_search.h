@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_search.h
+//
+// Bounded search for the best moves of a position whose sector, or some of
+// whose successors' sectors, are missing from the database.
+//
+// The search is a negamax alpha-beta over the move generator of the player,
+// in the frame of the sectors (PerfectPlayer::sector_state and
+// sector_child), deepened one ply at a time. A position whose sector is
+// present is a leaf with its exact database value; a position of a missing
+// sector is expanded further, and at the depth limit it gets the value of
+// its sector (get_sec_val) as an estimate. The deepening stops once an
+// iteration reached no estimate (the result is then exact) or when the
+// budget of nodes or time is spent, in which case the last iteration that
+// completed is used. The first iteration always completes.
+//
+// Scores are from the side to move: a win in k plies is win - k, a loss
+// -win + k, and a draw the sector value of the database (akey1). A
+// transposition table, fresh for every call, keeps the bounds found for the
+// positions searched.
+
+#ifndef PERFECT_SEARCH_H_INCLUDED
+#define PERFECT_SEARCH_H_INCLUDED
+
+#include "perfect_game_state.h"
+#include "perfect_player.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace DbSearch {
+
+// enabled makes MalomSolutionAccess::get_move_from_database fall back to the
+// search when the database misses a sector (off by default). max_nodes and
+// max_ms bound each search (<= 0: no bound on that).
+void configure(bool enabled, int64_t max_nodes, int max_ms);
+
+bool enabled();
+
+// The best moves of s, and its value as get_good_moves sets it (VALUE_MATE,
+// -VALUE_MATE or VALUE_DRAW), from the search. exact tells whether the
+// result is proven by the database. Needs the caller to keep other lookups
+// out (the API mutex). Returns false, with an error set, if s has no moves
+// or a present sector cannot be read.
+bool best_moves(PerfectPlayer &player, const GameState &s,
+                std::vector<AdvancedMove> &moves, Value &value, bool &exact);
+
+} // namespace DbSearch
+
+#endif // PERFECT_SEARCH_H_INCLUDED
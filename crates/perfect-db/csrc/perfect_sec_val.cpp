@@ -5,19 +5,95 @@
 // perfect_sec_val.cpp
 
 #include "perfect_sec_val.h"
+#include "perfect_stats.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 
-// Be careful: In the case of STONE_DIFF,
-// there are also sectors that do not exist at all.
-std::map<Id, sec_val> sec_vals;
+sec_val sec_val_table[sec_val_id_count];
+bool sec_val_present[sec_val_id_count];
 
 #ifndef STONE_DIFF
-std::map<sec_val, Id> inv_sec_vals;
+// inv_sec_vals[v - inv_sec_val_base] for the non-zero values
+static std::vector<Id> inv_sec_vals;
+static int inv_sec_val_base = 0;
 #endif
 sec_val virt_loss_val = 0, virt_win_val = 0;
 static bool sec_vals_initialized = false;
 
+static void set_sec_val(const Id &id, sec_val v)
+{
+    sec_val_table[sec_val_index(id)] = v;
+    sec_val_present[sec_val_index(id)] = true;
+}
+
+#ifdef DD
+#ifndef STONE_DIFF
+static const char secval_magic[4] = {'S', 'M', 'S', 'V'};
+static const int secval_version = 1;
+static const size_t secval_header_size = 13;
+static const size_t secval_record_size = 6;
+
+static int16_t read_i16(const unsigned char *p)
+{
+    return static_cast<int16_t>(p[0] | (p[1] << 8));
+}
+
+// Loads the binary sidecar with a single read. Returns false if it is absent
+// or invalid, so that the caller falls back to the text file.
+static bool load_binary_sec_vals(const std::string &path)
+{
+    FILE *f = nullptr;
+    if (FOPEN(&f, path.c_str(), "rb") == -1)
+        return false;
+    std::vector<unsigned char> buf;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        long size = ftell(f);
+        if (size > 0 && fseek(f, 0, SEEK_SET) == 0) {
+            buf.resize(static_cast<size_t>(size));
+            if (fread(buf.data(), 1, buf.size(), f) != buf.size())
+                buf.clear();
+        }
+    }
+    fclose(f);
+    Stats::add(Stat::bytes_read, buf.size());
+
+    const unsigned char *p = buf.data();
+    uint32_t n = 0;
+    bool ok = buf.size() >= secval_header_size &&
+              memcmp(p, secval_magic, 4) == 0 && p[4] == secval_version;
+    if (ok) {
+        n = p[9] | (p[10] << 8) | (p[11] << 16) | ((uint32_t)p[12] << 24);
+        ok = buf.size() == secval_header_size + n * secval_record_size &&
+             read_i16(p + 7) == -read_i16(p + 5);
+    }
+    for (uint32_t i = 0; ok && i < n; i++) {
+        const unsigned char *r = p + secval_header_size +
+                                 i * secval_record_size;
+        ok = r[0] < sec_val_dim && r[1] < sec_val_dim && r[2] < sec_val_dim &&
+             r[3] < sec_val_dim;
+    }
+    if (!ok) {
+#ifdef DEBUG
+        LOG("Ignoring invalid sector value file %s\n", path.c_str());
+#endif
+        return false;
+    }
+
+    virt_loss_val = read_i16(p + 5);
+    virt_win_val = read_i16(p + 7);
+    for (uint32_t i = 0; i < n; i++) {
+        const unsigned char *r = p + secval_header_size +
+                                 i * secval_record_size;
+        set_sec_val(Id(r[0], r[1], r[2], r[3]), read_i16(r + 4));
+    }
+    return true;
+}
+#endif
+#endif
+
 void init_sec_vals()
 {
     if (sec_vals_initialized)
@@ -26,7 +102,6 @@ void init_sec_vals()
 
 #ifdef DD
 #ifndef STONE_DIFF
-    FILE *f = nullptr;
 #ifdef _WIN32
     secValFileName = secValPath + "\\" + (std::string)ruleVariantName +
                      ".secval";
@@ -34,29 +109,47 @@ void init_sec_vals()
     secValFileName = secValPath + "/" + (std::string)ruleVariantName +
                      ".secval";
 #endif
-    if (FOPEN(&f, secValFileName.c_str(), "rt") != 0) {
-        fail_with(ruleVariantName + ".secval file not found.");
-        return;
-    }
-    FSCANF(f, "virt_loss_val: %hd\nvirt_win_val: %hd\n", &virt_loss_val,
-           &virt_win_val);
-    assert(virt_win_val == -virt_loss_val);
-    int n;
-    FSCANF(f, "%d\n", &n);
-    for (int i = 0; i < n; i++) {
-        int w, b, whiteFree, blackFree;
-        int16_t v;
-        FSCANF(f, "%d %d %d %d  %hd\n", &w, &b, &whiteFree, &blackFree, &v);
-        sec_vals[Id(w, b, whiteFree, blackFree)] = v;
+    if (!load_binary_sec_vals(secValFileName + "b")) {
+        FILE *f = nullptr;
+        if (FOPEN(&f, secValFileName.c_str(), "rt") != 0) {
+            fail_with(ruleVariantName + ".secval file not found.");
+            return;
+        }
+        sec_val loss = 0, win = 0;
+        FSCANF(f, "virt_loss_val: %hd\nvirt_win_val: %hd\n", &loss, &win);
+        int n = -1;
+        FSCANF(f, "%d\n", &n);
+        // The records are checked like the binary ones before any is used
+        // (a field that fails to parse stays -1).
+        bool ok = win == -loss && n >= 0;
+        std::vector<std::pair<Id, sec_val>> records;
+        for (int i = 0; ok && i < n; i++) {
+            int w = -1, b = -1, whiteFree = -1, blackFree = -1;
+            int16_t v = 0;
+            FSCANF(f, "%d %d %d %d  %hd\n", &w, &b, &whiteFree, &blackFree,
+                   &v);
+            ok = w >= 0 && w < sec_val_dim && b >= 0 && b < sec_val_dim &&
+                 whiteFree >= 0 && whiteFree < sec_val_dim && blackFree >= 0 &&
+                 blackFree < sec_val_dim;
+            records.emplace_back(Id(w, b, whiteFree, blackFree), v);
+        }
+        fclose(f);
+        if (!ok) {
+            fail_with(ruleVariantName + ".secval file is invalid.");
+            return;
+        }
+        virt_loss_val = loss;
+        virt_win_val = win;
+        for (const auto &r : records)
+            set_sec_val(r.first, r.second);
     }
-    fclose(f);
 #else
     for (int W = 0; W <= maxKsz; W++) {
         for (int WF = 0; WF <= maxKsz; WF++) {
             for (int B = 0; B <= maxKsz; B++) {
                 for (int BF = 0; BF <= maxKsz; BF++) {
                     Id s = Id {W, WF, B, BF};
-                    sec_vals[s] = s.W + s.WF - s.B - s.BF;
+                    set_sec_val(s, s.W + s.WF - s.B - s.BF);
                 }
             }
         }
@@ -74,37 +167,64 @@ void init_sec_vals()
 #endif
 
 #ifndef STONE_DIFF
-    for (const auto &sv : sec_vals) {
-        if (sv.second) { // not NTREKS if DD  (if not DD, then only the virt
-                         // sectors (which btw don't get here) are non-0)
-            assert(!inv_sec_vals.count(sv.second)); // non-NTREKS sec_vals
-                                                    // should be unique
-            inv_sec_vals[sv.second] = Id(sv.first);
+    int lo = 0, hi = -1;
+    for (int i = 0; i < sec_val_id_count; i++) {
+        if (sec_val_table[i]) {
+            if (lo > hi)
+                lo = hi = sec_val_table[i];
+            lo = std::min<int>(lo, sec_val_table[i]);
+            hi = std::max<int>(hi, sec_val_table[i]);
+        }
+    }
+    inv_sec_val_base = lo;
+    inv_sec_vals.assign(hi >= lo ? hi - lo + 1 : 0, Id::null());
+    for (int i = 0; i < sec_val_id_count; i++) {
+        // not NTREKS if DD (if not DD, then only the virt sectors (which btw
+        // don't get here) are non-0)
+        if (sec_val_table[i]) {
+            Id id(i / (sec_val_dim * sec_val_dim * sec_val_dim),
+                  i / (sec_val_dim * sec_val_dim) % sec_val_dim,
+                  i / sec_val_dim % sec_val_dim, i % sec_val_dim);
+            Id &slot = inv_sec_vals[sec_val_table[i] - inv_sec_val_base];
+            assert(slot == Id::null()); // non-NTREKS sec_vals should be unique
+            slot = id;
         }
     }
 #endif
 
 #ifdef HAS_SECTOR_GRAPH
     for (auto s : sector_list) {
-        assert(sec_vals.count(s)); // every sector has a value
-        auto xx = sec_vals[s];
-        assert(s.transient() || sec_vals[s] == -sec_vals[-s]); // wus are
-                                                               // zero-sum
+        assert(has_sec_val(s)); // every sector has a value
+        assert(s.transient() || get_sec_val(s) == -get_sec_val(-s)); // wus are
+                                                                     // zero-sum
     }
 #endif
 }
 
 void reset_sec_vals()
 {
-    sec_vals.clear();
+    memset(sec_val_table, 0, sizeof(sec_val_table));
+    memset(sec_val_present, 0, sizeof(sec_val_present));
 #ifndef STONE_DIFF
     inv_sec_vals.clear();
+    inv_sec_val_base = 0;
 #endif
     virt_loss_val = 0;
     virt_win_val = 0;
     sec_vals_initialized = false;
 }
 
+#ifndef STONE_DIFF
+const Id *sec_val_to_id(sec_val v)
+{
+    int i = v - inv_sec_val_base;
+    if (v == 0 || i < 0 || i >= (int)inv_sec_vals.size() ||
+        inv_sec_vals[i] == Id::null())
+        return nullptr;
+    return &inv_sec_vals[i];
+}
+#endif
+
 std::string sec_val_to_sec_name(sec_val v)
 {
     if (v == 0)
@@ -130,8 +250,9 @@ std::string sec_val_to_sec_name(sec_val v)
             return "KLE";
         }
         // Gracefully handle missing values instead of asserting
-        if (inv_sec_vals.count(v)) {
-            return std::to_string(v) + " (" + inv_sec_vals[v].to_string() + ")";
+        if (const Id *id = sec_val_to_id(v)) {
+            Id sector = *id;
+            return std::to_string(v) + " (" + sector.to_string() + ")";
         } else {
             // Return a descriptive error string instead of crashing
             return "UNKNOWN_VAL_" + std::to_string(v);
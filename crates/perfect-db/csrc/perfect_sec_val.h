@@ -9,13 +9,59 @@
 
 #include "perfect_common.h"
 
-#include <map>
+#include <cstdint>
 #include <string>
+#include <vector>
 
-extern std::map<Id, sec_val> sec_vals;
-extern std::map<sec_val, Id> inv_sec_vals;
+// Sector values are kept in a dense table indexed by the packed sector id
+// (every piece count is in 0..12), with a dense inverse table over the range
+// of the loaded values. Be careful: In the case of STONE_DIFF, there are also
+// sectors that do not exist at all.
+//
+// init_sec_vals() reads <variant>.secvalb if present, in a single read, and
+// falls back to the text <variant>.secval. The binary sidecar is written by
+// `tgf mill db-secval` (perfect_db::file_format::SecValTable::to_binary):
+//
+//   0   char[4] magic "SMSV"
+//   4   u8      version (1)
+//   5   i16     virt_loss_val (little-endian, as all fields)
+//   7   i16     virt_win_val
+//   9   u32     count
+//   13  count * {u8 W, u8 B, u8 WF, u8 BF, i16 value}
+
+const int sec_val_dim = 13;
+const int sec_val_id_count = sec_val_dim * sec_val_dim * sec_val_dim *
+                             sec_val_dim;
+
+extern sec_val sec_val_table[sec_val_id_count];
+extern bool sec_val_present[sec_val_id_count];
 extern sec_val virt_loss_val, virt_win_val;
 
+inline int sec_val_index(const Id &id)
+{
+    assert(id.W >= 0 && id.W < sec_val_dim && id.B >= 0 &&
+           id.B < sec_val_dim && id.WF >= 0 && id.WF < sec_val_dim &&
+           id.BF >= 0 && id.BF < sec_val_dim);
+    return ((id.W * sec_val_dim + id.B) * sec_val_dim + id.WF) * sec_val_dim +
+           id.BF;
+}
+
+inline bool has_sec_val(const Id &id)
+{
+    return sec_val_present[sec_val_index(id)];
+}
+
+// 0 for sectors without a value
+inline sec_val get_sec_val(const Id &id)
+{
+    return sec_val_table[sec_val_index(id)];
+}
+
+#ifndef STONE_DIFF
+// The sector of a non-zero value, or nullptr
+const Id *sec_val_to_id(sec_val v);
+#endif
+
 std::string sec_val_to_sec_name(sec_val v);
 
 void init_sec_vals();
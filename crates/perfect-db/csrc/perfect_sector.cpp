@@ -6,18 +6,35 @@
 
 #include "perfect_sector.h"
 #include "perfect_common.h"
+#include "perfect_compressed.h"
 #include "perfect_hash.h"
+#include "perfect_load_trace.h"
+#include "perfect_stats.h"
 #include "perfect_symmetries.h"
 #include "perfect_errors.h"
+#include "perfect_wdl_plane.h"
 
 #include <chrono>
 #include <cstdio>
+#include <cstring>
 #include <vector>
 
+#ifdef _WIN32
+#include <mutex>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 std::vector<std::vector<std::vector<std::vector<Sector *>>>> sectors;
 
 std::vector<Sector *> sector_objs;
 
+#ifdef _WIN32
+// Serializes the seek + read pairs of Sector::read_at.
+static std::mutex g_read_mutex;
+#endif
+
 const int sbufsize = 1024 * 1024;
 char sbuf[sbufsize]; // Caution
 
@@ -37,18 +54,20 @@ Sector::Sector(::Id the_id)
     , sval(
 #endif
 #ifdef DD
-          sec_vals[id]
+          get_sec_val(id)
 #else
           0
 #endif
       )
 {
-    assert(sec_vals.count(id) > 0);
+    assert(has_sec_val(id));
 
     sector_objs.push_back(this);
 
     STRCPY(fileName, sizeof(fileName), id.file_name().c_str());
+#ifdef DEBUG
     LOG("Creating sector object for %s\n", fileName);
+#endif
 
 #ifndef WRAPPER
     allocate_hash();
@@ -118,8 +137,7 @@ void Sector::write_header(FILE *file)
 
 void Sector::read_em_set(FILE *file)
 {
-    auto start = std::chrono::steady_clock::now();
-    auto last_update = std::chrono::steady_clock::now();
+    LoadTrace::Span span(id, LoadTrace::Phase::em_set);
 
     int em_set_size = 0;
     size_t ret = fread(&em_set_size, 4, 1, file);
@@ -138,65 +156,8 @@ void Sector::read_em_set(FILE *file)
             return;
         }
         em_set[e[0]] = e[1];
-
-        auto now = std::chrono::steady_clock::now();
-        auto time_since_last_update =
-            std::chrono::duration_cast<std::chrono::seconds>(now - last_update)
-                .count();
-
-        // Only update the console every second
-        if (time_since_last_update >= 1) {
-            // Calculate memory usage
-            float memoryUsageMB = ((i + 1) * 8.0f) / (1024 * 1024); // MB
-
-            // Calculate elapsed time
-            auto elapsed_seconds =
-                std::chrono::duration_cast<std::chrono::seconds>(now - start)
-                    .count();
-            auto hours = elapsed_seconds / 3600;
-            int minutes = (elapsed_seconds % 3600) / 60;
-            int seconds = elapsed_seconds % 60;
-
-            // Calculate remaining time
-            int remaining_iterations = em_set_size - (i + 1);
-            auto avg_seconds_per_iteration = elapsed_seconds / (float)(i + 1);
-            auto remaining_seconds = remaining_iterations *
-                                     avg_seconds_per_iteration;
-            auto remaining_hours = remaining_seconds / 3600;
-            int remaining_minutes = ((unsigned int)remaining_seconds % 3600) /
-                                    60;
-            int remaining_secs = (unsigned int)remaining_seconds % 60;
-
-            if (memoryUsageMB < 1024) {
-                printf("\rProgress: %.2f%%, Memory Usage: %.2fMB, Elapsed "
-                       "time: %02d:%02d:%02d, Remaining time: %02d:%02d:%02d",
-                       ((float)(i + 1) / em_set_size) * 100, memoryUsageMB,
-                       static_cast<int>(hours), static_cast<int>(minutes),
-                       static_cast<int>(seconds),
-                       static_cast<int>(remaining_hours),
-                       static_cast<int>(remaining_minutes),
-                       static_cast<int>(remaining_secs));
-            } else {
-                printf("\rProgress: %.2f%%, Memory Usage: %.2fGB, Elapsed "
-                       "time: %02d:%02d:%02d, Remaining time: %02d:%02d:%02d",
-                       ((float)(i + 1) / em_set_size) * 100,
-                       memoryUsageMB / 1024.0, static_cast<int>(hours),
-                       static_cast<int>(minutes), static_cast<int>(seconds),
-                       static_cast<int>(remaining_hours),
-                       static_cast<int>(remaining_minutes),
-                       static_cast<int>(remaining_secs));
-            }
-
-            // Flush the output buffer to immediately update the output
-            fflush(stdout);
-
-            last_update = now;
-        }
     }
-
-    // Print a new line after the loop ends to avoid subsequent outputs
-    // on the same line
-    printf("\n");
+    Stats::add(Stat::bytes_read, 4 + (uint64_t)em_set_size * 8);
 }
 
 #ifdef DD
@@ -207,15 +168,28 @@ eval_elem2 Sector::get_eval(int i)
 
 eval_elem_sym2 Sector::get_eval_inner(int i)
 {
-#ifdef DD
-    field2_t spec_field2 = -(1 << (field2Size - 1));
-    // field2_t max_field2 = -(spec_field2 + 1);
-#endif
+    return with_em_set(i, extract_value(i));
+}
+
+eval_elem_sym2 Sector::decode_eval(int i, const unsigned char *entry)
+{
+    return with_em_set(i, unpack_value(entry));
+}
 
-    std::pair<sec_val, field2_t> resi = extract_value(i);
+eval_elem_sym2 Sector::with_em_set(int i, std::pair<sec_val, field2_t> resi)
+{
+    field2_t spec_field2 = -(1 << (field2Size - 1));
     if (resi.second == spec_field2) {
-        assert(em_set.count(i));
-        return eval_elem_sym2 {resi.first, em_set[i]};
+        // find, not operator[]: lookups may run on several threads.
+        auto it = em_set.find(i);
+        assert(it != em_set.end());
+        Stats::add(Stat::em_set_lookups);
+        if (it == em_set.end()) {
+            SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR, "Missing em_set "
+                                                            "entry");
+            return eval_elem_sym2 {resi.first, 0};
+        }
+        return eval_elem_sym2 {resi.first, it->second};
     } else {
         return eval_elem_sym2 {resi.first, resi.second};
     }
@@ -245,6 +219,7 @@ eval_elem_sym2 Sector::get_eval_inner(int i)
 
     if (resi == SPEC) {
         assert(em_set.count(i));
+        Stats::add(Stat::em_set_lookups);
         int x = em_set[i];
         return x >= 0 ? eval_elem_sym(eval_elem_sym::val, x) :
                         eval_elem_sym(eval_elem_sym::count, -x);
@@ -284,10 +259,9 @@ std::pair<sec_val, field2_t> Sector::extract_value(int i)
     for (int j = 0; j < eval_struct_size; j++)
         a |= (int)evaluate[eval_struct_size * i + j] << 8 * j;
 #else
-    fseek(f, header_size + eval_struct_size * i, SEEK_SET);
     unsigned char read[eval_struct_size];
-    size_t ret = fread(&read, 1, eval_struct_size, f);
-    if (ret != eval_struct_size) {
+    if (!read_at(header_size + (int64_t)eval_struct_size * i, read,
+                 eval_struct_size)) {
         SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR, "Failed to read the "
                                                         "expected number of "
                                                         "bytes");
@@ -297,26 +271,100 @@ std::pair<sec_val, field2_t> Sector::extract_value(int i)
         a |= (int)read[j] << 8 * j;
 #endif
 
-    auto r = std::make_pair(
+    return unpack_fields(a);
+}
+
+std::pair<sec_val, field2_t> Sector::unpack_value(const unsigned char *entry)
+{
+    unsigned int a = 0;
+    for (int j = 0; j < eval_struct_size; j++)
+        a |= (unsigned int)entry[j] << 8 * j;
+    return unpack_fields(a);
+}
+
+std::pair<sec_val, field2_t> Sector::unpack_fields(unsigned int a)
+{
+    return std::make_pair(
         sign_extend(static_cast<sec_val>(a & ((1 << field1Size) - 1)),
                     field1Size),
         sign_extend(static_cast<field2_t>(a >> field2Offset), field2Size));
+}
 
-    return r;
+#endif
+
+bool Sector::read_at(int64_t offset, void *buf, size_t n)
+{
+    if (z)
+        return z->read(offset, buf, n);
+    if (mapped) {
+        if (offset < 0 || offset + (int64_t)n > mapped_size)
+            return false;
+        memcpy(buf, mapped + offset, n);
+        return true;
+    }
+    if (!f)
+        return false;
+    Stats::add(Stat::bytes_read, n);
+#ifdef _WIN32
+    std::lock_guard<std::mutex> lock(g_read_mutex);
+    if (_fseeki64(f, offset, SEEK_SET) != 0)
+        return false;
+    return fread(buf, 1, n, f) == n;
+#else
+    // pread leaves the stream position alone, so readers do not race on it.
+    return pread(fileno(f), buf, n, (off_t)offset) == (ssize_t)n;
+#endif
+}
+
+bool Sector::map_file()
+{
+#ifdef _WIN32
+    return false;
+#else
+    if (mapped)
+        return true;
+    if (!f)
+        return false;
+    LoadTrace::Span span(id, LoadTrace::Phase::eval_map);
+    int fd = fileno(f);
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size <= 0)
+        return false;
+    void *p = mmap(nullptr, (size_t)size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        return false;
+    mapped = static_cast<const unsigned char *>(p);
+    mapped_size = (int64_t)size;
+    return true;
+#endif
 }
 
+void Sector::unmap_file()
+{
+#ifndef _WIN32
+    if (mapped && mapped != image.data())
+        munmap(const_cast<unsigned char *>(mapped), (size_t)mapped_size);
 #endif
+    mapped = nullptr;
+    mapped_size = 0;
+}
 
-void Sector::allocate_hash()
+void Sector::allocate_hash(bool with_evals)
 {
-    // Calculate memory requirements before allocation
-    size_t estimated_memory = (1LL << (24 - W)) * sizeof(int);
-    if (estimated_memory > 100 * 1024 * 1024) { // > 100MB
-        LOG("Large memory allocation for %s: ~%.1f MB\n", fileName,
-            estimated_memory / (1024.0 * 1024.0));
+    if (!hash) {
+        allocate_hash_tables();
+        if (!hash)
+            return;
     }
+    if (with_evals && !evals_loaded)
+        load_evals();
+}
 
+void Sector::allocate_hash_tables()
+{
 #ifdef DEBUG
+    // Calculate memory requirements before allocation
+    size_t estimated_memory = (1LL << (24 - W)) * sizeof(int);
     LOG("Allocating hash table for %s (W=%d, B=%d, estimated: %.1f MB)...\n",
         fileName, W, B, estimated_memory / (1024.0 * 1024.0));
 #endif
@@ -325,11 +373,19 @@ void Sector::allocate_hash()
     auto start_time = std::chrono::high_resolution_clock::now();
 #endif
 
-    // and read em_set (should be renamed)
-    hash = new Hash(W, B, this);
+    uint64_t build_start = Stats::now_ns();
+    {
+        LoadTrace::Span span(id, LoadTrace::Phase::hash_build);
+        hash = new Hash(W, B, this);
+    }
+    Stats::add(Stat::hash_builds);
+    Stats::add(Stat::hash_build_ns, Stats::now_ns() - build_start);
 
     if (!hash->is_initialized()) {
-        LOG("Hash initialization failed for %s, cleaning up...\n", fileName);
+        SET_ERROR_VALUES(PerfectErrors::PE_OUT_OF_MEMORY,
+                         "Cannot allocate the hash tables of W = %lld, "
+                         "B = %lld",
+                         W, B);
         delete hash;
         hash = nullptr;
         return;
@@ -348,9 +404,32 @@ void Sector::allocate_hash()
 #else
     eval_size = hash ? hash->hash_count : 0;
 #endif
+}
 
+// Opens the sector file and reads the em_set
+void Sector::load_evals()
+{
 #ifdef WRAPPER
-    if (!f) {
+    if (!image.empty()) {
+        mapped = image.data();
+        mapped_size = (int64_t)image.size();
+        int64_t pos = header_size + (int64_t)eval_size;
+        int em_set_size = 0;
+        if (!read_at(pos, &em_set_size, 4) || em_set_size < 0 ||
+            pos + 4 + 8 * (int64_t)em_set_size > mapped_size) {
+            SET_STATIC_ERROR(PerfectErrors::PE_FILE_IO_ERROR,
+                             "Sector image too short for its em_set");
+            return;
+        }
+        for (int i = 0; i < em_set_size; i++) {
+            int e[2];
+            memcpy(e, mapped + pos + 4 + 8 * (int64_t)i, 8);
+            em_set[e[0]] = e[1];
+        }
+        evals_loaded = true;
+        return;
+    }
+    if (!f && !z) {
         std::string filename = std::string(fileName);
 #ifdef _WIN32
         filename = secValPath + "\\" + filename;
@@ -358,15 +437,142 @@ void Sector::allocate_hash()
         filename = secValPath + "/" + filename;
 #endif
 
-        if (FOPEN(&f, filename.c_str(), "rb") == -1) {
-            std::cerr << "Failed to open file " << filename << '\n';
+        int opened;
+        {
+            LoadTrace::Span span(id, LoadTrace::Phase::open);
+            opened = FOPEN(&f, filename.c_str(), "rb");
+            if (opened == -1) {
+                // Fall back to the block-compressed container.
+                f = nullptr;
+                z = CompressedSectorFile::open(filename + "z");
+            }
+        }
+        if (opened == -1) {
+            if (!z) {
+                SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_NOT_FOUND,
+                                  "Failed to open file " + filename);
+                return;
+            }
+            read_compressed_header_and_em_set();
+            evals_loaded = true;
             return;
         }
-        read_header(f);
+        {
+            LoadTrace::Span span(id, LoadTrace::Phase::header);
+            read_header(f);
+        }
+    } else if (z) {
+        read_compressed_header_and_em_set();
+        evals_loaded = true;
+        return;
     }
     fseek(f, header_size + eval_size, SEEK_SET);
     read_em_set(f);
 #endif
+    evals_loaded = true;
+}
+
+#ifdef WRAPPER
+void Sector::read_compressed_header_and_em_set()
+{
+#ifdef DD
+    {
+        LoadTrace::Span span(id, LoadTrace::Phase::header);
+        int header[3];
+        char _stone_diff_flag;
+        if (!z->read(0, header, sizeof(header)) ||
+            !z->read(sizeof(header), &_stone_diff_flag, 1)) {
+            SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR,
+                           "Failed to read compressed sector header");
+            return;
+        }
+        assert(header[0] == version);
+        assert(header[1] == eval_struct_size);
+        assert(header[2] == field2Offset);
+        assert(_stone_diff_flag == stone_diff_flag);
+    }
+#endif
+
+    // The em_set is read in one go, as entry-sized reads would go through
+    // the block cache one at a time.
+    LoadTrace::Span span(id, LoadTrace::Phase::em_set);
+    int64_t pos = header_size + (int64_t)eval_size;
+    int em_set_size = 0;
+    if (!z->read(pos, &em_set_size, 4) || em_set_size < 0) {
+        SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR, "Failed to read "
+                                                        "em_set_size");
+        return;
+    }
+    // A corrupt count must not size the allocation below.
+    if (pos + 4 + 8 * (int64_t)em_set_size > (int64_t)z->size()) {
+        SET_STATIC_ERROR(PerfectErrors::PE_FILE_IO_ERROR,
+                         "em_set_size past the end of the sector");
+        return;
+    }
+    std::vector<int> e((size_t)em_set_size * 2);
+    if (em_set_size > 0 && !z->read(pos + 4, e.data(), e.size() * 4)) {
+        SET_ERROR_CODE(PerfectErrors::PE_FILE_IO_ERROR, "Failed to read "
+                                                        "array 'e'");
+        return;
+    }
+    for (int i = 0; i < em_set_size; i++)
+        em_set[e[2 * i]] = e[2 * i + 1];
+}
+#endif
+
+WdlPlane *Sector::get_wdl_plane()
+{
+    if (wdl_plane_probed || !hash)
+        return wdl_plane;
+    wdl_plane_probed = true;
+
+    // std_2_2_7_7.sec2 -> std_2_2_7_7.wdl2
+    std::string filename = std::string(fileName);
+    filename = filename.substr(0, filename.rfind('.')) + ".wdl2";
+#ifdef _WIN32
+    filename = secValPath + "\\" + filename;
+#else
+    filename = secValPath + "/" + filename;
+#endif
+    wdl_plane = WdlPlane::open(filename, hash->hash_count);
+    return wdl_plane;
+}
+
+Sector::Residency Sector::residency() const
+{
+    Residency r {};
+    r.hash_bytes = hash ? hash->table_bytes() : 0;
+    r.em_set_entries = em_set.size();
+    // A red-black tree node: the value plus three pointers and the color.
+    r.em_set_bytes = em_set.size() *
+                     (sizeof(std::pair<const int, int>) + 4 * sizeof(void *));
+    r.wdl_plane_bytes = wdl_plane ? wdl_plane->bytes() : 0;
+    r.block_cache_bytes = z ? z->resident_bytes() : 0;
+    return r;
+}
+
+void Sector::prefetch()
+{
+    if (z)
+        z->prefetch();
+    else
+        prefetch_file(f);
+}
+
+void Sector::advise_sequential()
+{
+    if (z) {
+        z->advise_sequential();
+        return;
+    }
+#ifndef _WIN32
+    if (mapped && mapped != image.data()) {
+        madvise(const_cast<unsigned char *>(mapped), (size_t)mapped_size,
+                MADV_SEQUENTIAL);
+        return;
+    }
+#endif
+    advise_sequential_file(f);
 }
 
 void Sector::release_hash()
@@ -376,11 +582,19 @@ void Sector::release_hash()
     hash = nullptr;
 
     em_set.clear();
+    evals_loaded = false;
+
+    delete wdl_plane;
+    wdl_plane = nullptr;
+    wdl_plane_probed = false;
 
 #ifdef WRAPPER
+    unmap_file();
     if (f != nullptr) {
         fclose(f);
         f = nullptr;
     }
+    delete z;
+    z = nullptr;
 #endif
 }
@@ -12,6 +12,9 @@
 #include "perfect_sec_val.h"
 #include "perfect_sector_graph.h"
 
+#include <map>
+#include <vector>
+
 #ifndef WRAPPER
 #include "movegen.h"
 #endif
@@ -22,6 +25,8 @@ extern int maxKsz;
 
 class Hash;
 class Sector;
+class CompressedSectorFile;
+class WdlPlane;
 
 class Sector
 {
@@ -29,6 +34,12 @@ class Sector
 
     int eval_size;
 
+    WdlPlane *wdl_plane {nullptr};
+    bool wdl_plane_probed {false};
+
+    void allocate_hash_tables();
+    void load_evals();
+
 public:
     std::map<int, int> em_set;
 
@@ -40,6 +51,7 @@ public:
     void read_header(FILE *file);
     void write_header(FILE *file);
     void read_em_set(FILE *file);
+    void read_compressed_header_and_em_set();
 
     int W {0};
     int B {0};
@@ -54,6 +66,17 @@ public:
 
 #ifdef DD
     std::pair<sec_val, field2_t> extract_value(int i);
+
+    // get_eval_inner of entry i from its eval_struct_size bytes, read by the
+    // caller (see perfect_scan.h).
+    eval_elem_sym2 decode_eval(int i, const unsigned char *entry);
+
+private:
+    static std::pair<sec_val, field2_t> unpack_value(const unsigned char *entry);
+    static std::pair<sec_val, field2_t> unpack_fields(unsigned int a);
+    eval_elem_sym2 with_em_set(int i, std::pair<sec_val, field2_t> resi);
+
+public:
 #endif
 
     // Statistics:
@@ -63,8 +86,67 @@ public:
 
     FILE *f {nullptr};
 
-    void allocate_hash();
+    // Set instead of f when the sector is stored as a block-compressed
+    // .sec2z container (see perfect_compressed.h).
+    CompressedSectorFile *z {nullptr};
+
+    // Reads n bytes at the given offset of the (uncompressed) sector file.
+    // Safe to call from several threads.
+    bool read_at(int64_t offset, void *buf, size_t n);
+
+    // Maps the opened .sec2 file into memory, so that read_at needs no
+    // system call; meant for readers that visit most of a sector, like the
+    // verifier. Returns false (reads keep going through the file) for
+    // .sec2z containers and where mapping is not available. The mapping is
+    // dropped by unmap_file and release_hash.
+    bool map_file();
+    void unmap_file();
+    const unsigned char *mapped {nullptr};
+    int64_t mapped_size {0};
+
+    // The file image of a sector solved in memory (see perfect_solve.h),
+    // standing in for the sector file: load_evals serves it through mapped.
+    std::vector<unsigned char> image;
+
+    // Builds the hash tables if needed and, if with_evals is set, opens the
+    // sector file and reads the em_set. Calling it again with with_evals
+    // after a hash-only allocation just loads the evals.
+    void allocate_hash(bool with_evals = true);
     void release_hash();
+    bool evals_loaded {false};
+
+    // Open pd_open_sector iterators, which read the hash and evals without
+    // the API lock. The hash cache does not evict a pinned sector.
+    int pins {0};
+
+    // Asks the OS to start reading the opened sector file (.sec2 or .sec2z)
+    // into the page cache, so the first lookups do not wait for the disk.
+    void prefetch();
+
+    // Tells the OS that the sector will be read front to back (see
+    // perfect_scan.h): madvise(MADV_SEQUENTIAL) on the mapping, otherwise
+    // posix_fadvise(SEQUENTIAL) on the file.
+    void advise_sequential();
+
+    // The .wdl2 plane next to the sector file, loaded on first use and
+    // released together with the hash. nullptr if there is none.
+    WdlPlane *get_wdl_plane();
+
+    // Memory currently held for the sector, by owner.
+    struct Residency
+    {
+        size_t hash_bytes;        // Hash lookup tables
+        size_t em_set_entries;
+        size_t em_set_bytes;      // estimated from the std::map node size
+        size_t wdl_plane_bytes;
+        size_t block_cache_bytes; // .sec2z block cache
+        size_t total() const
+        {
+            return hash_bytes + em_set_bytes + wdl_plane_bytes +
+                   block_cache_bytes;
+        }
+    };
+    Residency residency() const;
 
 public:
     sec_val sval;
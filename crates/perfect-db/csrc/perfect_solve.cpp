@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_solve.cpp
+
+#include "perfect_solve.h"
+#include "perfect_errors.h"
+#include "perfect_game_state.h"
+#include "perfect_hash.h"
+#include "perfect_log.h"
+#include "perfect_player.h"
+#include "perfect_retro.h"
+#include "perfect_sector.h"
+#include "perfect_sector_graph.h"
+#include "perfect_wrappers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SectorSolver {
+
+namespace {
+
+// Set by configure while queries may run.
+std::atomic<bool> g_on_lookup(false);
+std::atomic<int64_t> g_max_entries(1 << 24);
+std::atomic<int> g_threads(0);
+std::atomic<bool> g_write_files(false);
+
+// Generates the moves of node i for Retro::build.
+template <class Inside>
+bool expand(PerfectPlayer &player, Retro::Unit &u, int64_t i, bool exits,
+            Inside inside, Wrappers::gui_eval_elem2 &best, bool &has_exit)
+{
+    Retro::Part &p = u.part_of(i);
+    board a = p.ws->s->hash->inverse_hash((int)(i - p.base));
+    std::vector<AdvancedMove> moves = player.get_move_list(
+        PerfectPlayer::sector_state(p.id, a));
+
+    has_exit = false;
+    if (moves.empty()) {
+        // A side without moves has lost.
+        best = Wrappers::gui_eval_elem2(
+            static_cast<sec_val>(virt_loss_val - p.ws->sval()), 0, p.ws->s);
+        has_exit = true;
+        return true;
+    }
+
+    for (const AdvancedMove &m : moves) {
+        Id cid = p.id;
+        board c = a;
+        PerfectPlayer::sector_child(m, c, cid);
+        if (const Retro::Part *q = u.find(cid)) {
+            inside(q->base + q->ws->s->hash->index(c));
+            continue;
+        }
+        if (!exits)
+            continue;
+
+        Wrappers::gui_eval_elem2 v = Wrappers::gui_eval_elem2::virt_loss_val();
+        if (!Retro::exit_value(u, p, cid, c, v))
+            return false;
+        if (!has_exit || v > best)
+            best = v;
+        has_exit = true;
+    }
+    return true;
+}
+
+// Not fatal: the database directory may be read-only.
+void write_file(const Id &id, const std::vector<unsigned char> &image)
+{
+#ifdef _WIN32
+    std::string path = secValPath + "\\" + Id(id).file_name();
+#else
+    std::string path = secValPath + "/" + Id(id).file_name();
+#endif
+    std::string tmp = path + ".tmp";
+    FILE *file = nullptr;
+    if (FOPEN(&file, tmp.c_str(), "wb") == -1 || !file)
+        return;
+    bool ok = fwrite(image.data(), 1, image.size(), file) == image.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || (remove(path.c_str()), rename(tmp.c_str(), path.c_str())) != 0)
+        remove(tmp.c_str());
+}
+
+// Whether the player has the sector, taking it from an earlier solve if
+// needed.
+bool available(PerfectPlayer &player, const Id &id)
+{
+    Wrappers::WID wid(id);
+    if (player.secs.count(wid))
+        return true;
+    auto it = Sectors::sectors.find(wid);
+    if (it == Sectors::sectors.end())
+        return false;
+    player.secs.emplace(wid, it->second);
+    return true;
+}
+
+bool valid(const Id &id)
+{
+    auto in_range = [](int x) { return x >= 0 && x <= maxKsz; };
+    return in_range(id.W) && in_range(id.B) && in_range(id.WF) &&
+           in_range(id.BF) && id.W + id.WF >= 3 && id.B + id.BF >= 3 &&
+           id.W + id.WF <= maxKsz && id.B + id.BF <= maxKsz &&
+           has_sec_val(id);
+}
+
+} // namespace
+
+void configure(bool on_lookup, int64_t max_entries, int threads,
+               bool write_files)
+{
+    g_on_lookup = on_lookup;
+    g_max_entries = max_entries;
+    g_threads = threads;
+    g_write_files = write_files;
+}
+
+bool on_lookup()
+{
+    return g_on_lookup;
+}
+
+bool solve(PerfectPlayer &player, Id id)
+{
+    if (available(player, id))
+        return true;
+    if (!valid(id)) {
+        SET_ERROR_MESSAGE(PerfectErrors::PE_INVALID_ARGUMENT,
+                          "No such sector: " + id.to_string());
+        return false;
+    }
+
+    // The partner is solved along if the two have moves into each other;
+    // the values then carry over between them with the sign flipped.
+    std::vector<Id> ids {id};
+    Id partner = -id;
+    std::vector<Id> succ = graph_func(id, false);
+    if (std::find(succ.begin(), succ.end(), partner) != succ.end()) {
+        if (partner != id && !available(player, partner))
+            ids.push_back(partner);
+        if (ids.size() > 1 || partner == id) {
+            if (get_sec_val(id) + get_sec_val(partner) != 0) {
+                SET_ERROR_MESSAGE(PerfectErrors::PE_RUNTIME_ERROR,
+                                  "The sector values of " + id.to_string() +
+                                      " and " + partner.to_string() +
+                                      " are not opposite");
+                return false;
+            }
+        }
+    }
+
+    int64_t total = 0;
+    for (const Id &x : ids)
+        total += hash_count_of(x.W, x.B);
+    const int64_t max_entries = g_max_entries;
+    if (total > max_entries || total > INT32_MAX) {
+        SET_ERROR_MESSAGE(PerfectErrors::PE_OUT_OF_RANGE,
+                          id.to_string() + " has " + std::to_string(total) +
+                              " positions to solve, more than the limit of " +
+                              std::to_string(max_entries));
+        return false;
+    }
+
+    // The successors, solved first if they are missing as well.
+    std::vector<Id> needed;
+    for (const Id &x : ids)
+        for (const Id &c : graph_func(x))
+            if (std::find(ids.begin(), ids.end(), c) == ids.end() &&
+                std::find(needed.begin(), needed.end(), c) == needed.end())
+                needed.push_back(c);
+    for (const Id &c : needed)
+        if (!solve(player, c))
+            return false;
+
+#ifdef DEBUG
+    const auto start = std::chrono::steady_clock::now();
+#endif
+    const int configured_threads = g_threads;
+    const int threads = configured_threads > 0 ?
+                            configured_threads :
+                            (int)std::max(1u,
+                                          std::thread::hardware_concurrency());
+
+    // The graph is small enough for the heap (max_entries).
+    Retro::Storage storage;
+    // The sectors being solved only need their hash tables.
+    std::vector<Wrappers::WSector> ws;
+    ws.reserve(ids.size());
+    Retro::Unit u;
+    for (const Id &x : ids) {
+        ws.emplace_back(Wrappers::WID(x));
+        ws.back().s->allocate_hash(false);
+        if (!ws.back().s->hash) {
+            SET_ERROR_MESSAGE(PerfectErrors::PE_OUT_OF_MEMORY,
+                              "Cannot build the hash of " + Id(x).to_string());
+            return false;
+        }
+        u.parts.push_back(
+            Retro::Part {x, &ws.back(), u.n, ws.back().s->hash->hash_count});
+        u.n += u.parts.back().count;
+    }
+
+    // Keep the successors in the hash LRU while the threads read them.
+    const int capacity = Wrappers::hash_cache_capacity();
+    Wrappers::set_hash_cache_capacity(
+        std::max(capacity, (int)needed.size()));
+    std::vector<Sector *> mapped;
+    bool ok = true;
+    for (const Id &c : needed) {
+        Sector *s = player.secs.find(Wrappers::WID(c))->second.load();
+        if (!s) {
+            SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                              "Cannot load " + Id(c).to_string());
+            ok = false;
+            break;
+        }
+        u.loaded[c] = s;
+        if (!s->mapped && s->map_file())
+            mapped.push_back(s);
+    }
+
+    std::vector<std::vector<unsigned char>> images(ids.size());
+    auto each = [&](int64_t i, bool exits, auto inside,
+                    Wrappers::gui_eval_elem2 &best, bool &has_exit) {
+        return expand(player, u, i, exits, inside, best, has_exit);
+    };
+    ok = ok && Retro::build(u.graph, storage, u.n, threads, each) &&
+         Retro::solve_levels(u.graph, storage) &&
+         Retro::solve_steps(u.graph, storage);
+    for (size_t k = 0; ok && k < ids.size(); k++) {
+        std::vector<unsigned char> &image = images[k];
+        ok = Retro::encode(u.graph, u.parts[k].base, u.parts[k].count,
+                           threads, [&](const void *p, size_t size) {
+                               const unsigned char *b =
+                                   static_cast<const unsigned char *>(p);
+                               image.insert(image.end(), b, b + size);
+                               return true;
+                           });
+    }
+
+    for (Sector *s : mapped)
+        s->unmap_file();
+    Wrappers::set_hash_cache_capacity(capacity);
+    for (Wrappers::WSector &w : ws)
+        w.s->release_hash();
+    if (!ok)
+        return false;
+
+    for (size_t k = 0; k < ids.size(); k++) {
+        if (g_write_files)
+            write_file(ids[k], images[k]);
+        ws[k].s->image = std::move(images[k]);
+        Sectors::sectors.emplace(Wrappers::WID(ids[k]), ws[k]);
+        player.secs.emplace(Wrappers::WID(ids[k]), ws[k]);
+    }
+
+#ifdef DEBUG
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    LOG("Solved %s%s: %lld positions, %lld moves inside, in %.1f s\n",
+        id.to_string().c_str(),
+        ids.size() > 1 ? (" with " + ids[1].to_string()).c_str() : "",
+        (long long)u.n, (long long)u.graph.edges(), seconds);
+#endif
+    return true;
+}
+
+} // namespace SectorSolver
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_solve.h
+//
+// Retrograde solving of sectors that are missing from the database, in
+// memory, for endgames small enough to be solved while a lookup waits.
+//
+// A sector is solved together with its partner (the sector with the sides
+// swapped) when both are missing and moves lead from one into the other;
+// moves into any other sector are exits, whose values are read from the
+// database (missing successors are solved first, recursively). Every hash
+// index of the sector gets its own value, so the result has no symmetry
+// redirects. The passes that generate moves and read the exits, and the
+// encoding, are split across threads; the fixpoint over the moves inside the
+// solved sectors runs on one thread, level by level of the exit values,
+// followed by a shortest/longest path pass for the steps.
+//
+// Solved sectors are added to the player (and to Sectors, so that players
+// created later find them) with their .sec2 image kept in memory, and can
+// be written to the database directory as well.
+
+#ifndef PERFECT_SOLVE_H_INCLUDED
+#define PERFECT_SOLVE_H_INCLUDED
+
+#include "perfect_common.h"
+
+#include <cstdint>
+
+class PerfectPlayer;
+
+namespace SectorSolver {
+
+// on_lookup makes PerfectPlayer::get_sector solve the sectors it misses (off
+// by default). max_entries bounds the hash_count of what is solved at once
+// (a sector, or a sector and its partner); threads <= 0 uses every core; with
+// write_files the solved sectors are also saved as .sec2 files next to the
+// database (failures to write are not errors).
+void configure(bool on_lookup, int64_t max_entries, int threads,
+               bool write_files);
+
+bool on_lookup();
+
+// Makes sector id available in player.secs, solving it if it is missing from
+// the database. Needs the caller to keep other lookups out (the API mutex).
+// Returns false, with an error set, if the sector (or one it depends on) is
+// too large or cannot be solved.
+bool solve(PerfectPlayer &player, Id id);
+
+} // namespace SectorSolver
+
+#endif // PERFECT_SOLVE_H_INCLUDED
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_stats.cpp
+
+#include "perfect_stats.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+std::mutex g_stats_mutex;
+std::vector<Stats::Block *> g_blocks;
+uint64_t g_retired[Stats::stat_count];
+uint64_t g_baseline[Stats::stat_count];
+
+// Owns the block of one thread and folds it into g_retired on thread exit.
+struct ThreadBlock
+{
+    Stats::Block block;
+
+    ThreadBlock()
+    {
+        for (auto &c : block.v)
+            c.store(0, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(g_stats_mutex);
+        g_blocks.push_back(&block);
+    }
+
+    ~ThreadBlock()
+    {
+        std::lock_guard<std::mutex> lock(g_stats_mutex);
+        for (int i = 0; i < Stats::stat_count; i++)
+            g_retired[i] += block.v[i].load(std::memory_order_relaxed);
+        g_blocks.erase(std::find(g_blocks.begin(), g_blocks.end(), &block));
+    }
+};
+
+void totals(uint64_t out[Stats::stat_count])
+{
+    for (int i = 0; i < Stats::stat_count; i++)
+        out[i] = g_retired[i];
+    for (Stats::Block *b : g_blocks)
+        for (int i = 0; i < Stats::stat_count; i++)
+            out[i] += b->v[i].load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+Stats::Block &Stats::local()
+{
+    thread_local ThreadBlock tb;
+    return tb.block;
+}
+
+void Stats::snapshot(uint64_t out[stat_count])
+{
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    totals(out);
+    for (int i = 0; i < stat_count; i++)
+        out[i] -= g_baseline[i];
+}
+
+void Stats::reset()
+{
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    totals(g_baseline);
+}
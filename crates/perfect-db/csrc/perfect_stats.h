@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_stats.h
+//
+// Runtime counters of the oracle hot path. Every thread increments its own
+// block of counters (single writer, relaxed atomics, so an increment is a
+// plain load and store), and readers sum the blocks of all live threads plus
+// the totals of threads that already exited. Resetting records the current
+// sums as a baseline instead of writing into other threads' blocks.
+
+#ifndef PERFECT_STATS_H_INCLUDED
+#define PERFECT_STATS_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+enum class Stat {
+    evaluations,       // PerfectPlayer::evaluate
+    best_move_calls,   // MalomSolutionAccess::get_best_move
+    moves_generated,   // moves returned by PerfectPlayer::get_move_list
+    hash_hits,         // WSector hash tables already loaded
+    hash_misses,       // WSector hash tables had to be built
+    hash_evictions,    // hash tables released by the WSector LRU
+    hash_builds,       // Hash objects constructed
+    hash_build_ns,     // time spent constructing them
+    bytes_read,        // bytes read from .sec2/.sec2z/.wdl2 files
+    em_set_lookups,    // entries resolved through Sector::em_set
+    sym_redirects,     // symmetric entries followed in Hash::hash
+    wdl_plane_lookups, // answers served from a .wdl2 plane
+    pd_mutex_wait_ns,  // time spent waiting for g_pd_mutex
+    eval_lock_wait_ns, // time spent waiting for evalLock
+    count
+};
+
+namespace Stats {
+
+static const int stat_count = static_cast<int>(Stat::count);
+
+struct Block
+{
+    std::atomic<uint64_t> v[stat_count];
+};
+
+// The calling thread's counters, registered on first use.
+Block &local();
+
+inline void add(Stat s, uint64_t n = 1)
+{
+    std::atomic<uint64_t> &c = local().v[static_cast<int>(s)];
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline uint64_t now_ns()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Counter values since the last reset().
+void snapshot(uint64_t out[stat_count]);
+void reset();
+
+} // namespace Stats
+
+// Drop-in replacement for std::lock_guard that adds the time spent blocked to
+// a counter. The uncontended path is a single try_lock and reads no clock.
+template <class Mutex>
+class TimedLockGuard
+{
+    Mutex &m;
+
+public:
+    TimedLockGuard(Mutex &mutex, Stat wait)
+        : m(mutex)
+    {
+        if (!m.try_lock()) {
+            uint64_t start = Stats::now_ns();
+            m.lock();
+            Stats::add(wait, Stats::now_ns() - start);
+        }
+    }
+    ~TimedLockGuard() { m.unlock(); }
+
+    TimedLockGuard(const TimedLockGuard &) = delete;
+    TimedLockGuard &operator=(const TimedLockGuard &) = delete;
+};
+
+#endif // PERFECT_STATS_H_INCLUDED
@@ -0,0 +1,411 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_summary.cpp
+
+#include "perfect_summary.h"
+#include "perfect_compressed.h"
+#include "perfect_errors.h"
+#include "perfect_hash.h"
+#include "perfect_sec_val.h"
+#include "perfect_sector.h"
+#include "perfect_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace SectorSummary {
+
+namespace {
+
+const char summary_magic[4] = {'S', 'M', 'S', 'S'};
+const int summary_version = 2;
+const int summary_header = 21;
+const int summary_fields = 7 + 3 * step_buckets;
+
+// Entries decoded per batch
+const int batch = 1 << 16;
+
+// Modification time of the file in nanoseconds, -1 if it cannot be read.
+int64_t file_mtime(const std::string &path)
+{
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0)
+        return -1;
+    return (int64_t)st.st_mtime * 1000000000;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return -1;
+#ifdef __APPLE__
+    const struct timespec &t = st.st_mtimespec;
+#else
+    const struct timespec &t = st.st_mtim;
+#endif
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+#endif
+}
+
+uint64_t read_u64(const unsigned char *p)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++)
+        v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+void write_u64(unsigned char *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+// The summary as summary_fields consecutive int64_t, in file order.
+static_assert(offsetof(Summary, em_set_entries) == 6 * sizeof(int64_t) &&
+                  offsetof(Summary, steps) == 7 * sizeof(int64_t),
+              "");
+
+int64_t *fields(Summary &s, int i)
+{
+    return i < 7 ? &s.entries + i : &s.steps[0][0] + (i - 7);
+}
+
+bool load_cache(const std::string &path, int64_t source_size,
+                int64_t source_mtime, Summary &out)
+{
+    FILE *file = nullptr;
+    if (FOPEN(&file, path.c_str(), "rb") == -1 || !file)
+        return false;
+
+    unsigned char h[summary_header];
+    std::vector<unsigned char> body((size_t)summary_fields * 8);
+    bool ok = fread(h, 1, sizeof(h), file) == sizeof(h) &&
+              memcmp(h, summary_magic, 4) == 0 && h[4] == summary_version &&
+              fread(body.data(), 1, body.size(), file) == body.size();
+    fclose(file);
+    if (!ok || (int64_t)read_u64(h + 5) != source_size ||
+        (int64_t)read_u64(h + 13) != source_mtime)
+        return false;
+
+    for (int f = 0; f < summary_fields; f++)
+        *fields(out, f) = (int64_t)read_u64(&body[8 * f]);
+    return true;
+}
+
+void save_cache(const std::string &path, int64_t source_size,
+                int64_t source_mtime, Summary &s)
+{
+    std::vector<unsigned char> out(summary_header +
+                                   (size_t)summary_fields * 8);
+    memcpy(out.data(), summary_magic, 4);
+    out[4] = summary_version;
+    write_u64(&out[5], (uint64_t)source_size);
+    write_u64(&out[13], (uint64_t)source_mtime);
+    for (int f = 0; f < summary_fields; f++)
+        write_u64(&out[summary_header + 8 * f], (uint64_t)*fields(s, f));
+
+    // Not fatal: the database directory may be read-only. Every call writes
+    // its own temporary file, as several may summarize the sector at once.
+    static std::atomic<unsigned> calls {0};
+#ifdef _WIN32
+    const int pid = _getpid();
+#else
+    const int pid = (int)getpid();
+#endif
+    std::string tmp = path + "." + std::to_string(pid) + "." +
+                      std::to_string(calls++) + ".tmp";
+    FILE *file = nullptr;
+    if (FOPEN(&file, tmp.c_str(), "wb") == -1 || !file)
+        return;
+    bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || (remove(path.c_str()), rename(tmp.c_str(), path.c_str())) != 0)
+        remove(tmp.c_str());
+}
+
+// The fields of n records, split into separate arrays in one pass that the
+// compiler can vectorize; the classification runs on the arrays afterwards.
+void unpack(const unsigned char *p, int n, int16_t *k1, int16_t *k2)
+{
+    const int s1 = 32 - field1Size;
+    const int s2 = 32 - field2Size;
+    const int off = field2Offset;
+    for (int i = 0; i < n; i++) {
+        uint32_t a = (uint32_t)p[3 * i] | ((uint32_t)p[3 * i + 1] << 8) |
+                     ((uint32_t)p[3 * i + 2] << 16);
+        k1[i] = (int16_t)((int32_t)(a << s1) >> s1);
+        k2[i] = (int16_t)((int32_t)((a >> off) << s2) >> s2);
+    }
+}
+
+struct Source
+{
+    std::string path;
+    int64_t size {0};
+    bool compressed {false};
+    const unsigned char *mapped {nullptr};
+};
+
+// Summarizes the entries [lo, hi) into s.
+bool summarize_range(const Source &src, int64_t lo, int64_t hi, sec_val sval,
+                     const std::vector<std::pair<int, int>> &em_set,
+                     Summary &s)
+{
+    FILE *file = nullptr;
+    CompressedSectorFile *z = nullptr;
+    if (!src.mapped) {
+        if (src.compressed)
+            z = CompressedSectorFile::open(src.path);
+        else if (FOPEN(&file, src.path.c_str(), "rb") == -1)
+            file = nullptr;
+        if (!z && !file)
+            return false;
+    }
+
+    const field2_t spec_field2 = -(1 << (field2Size - 1));
+    std::vector<unsigned char> buf(src.mapped ? 0 : (size_t)batch * 3);
+    std::vector<int16_t> k1(batch), k2(batch);
+    bool ok = true;
+    for (int64_t start = lo; start < hi && ok; start += batch) {
+        int n = (int)std::min<int64_t>(batch, hi - start);
+        int64_t offset = Sector::header_size + 3 * start;
+        const unsigned char *p = nullptr;
+        if (src.mapped) {
+            p = src.mapped + offset;
+        } else if (z) {
+            ok = z->read(offset, buf.data(), (size_t)n * 3);
+            p = buf.data();
+        } else {
+#ifdef _WIN32
+            ok = _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+            ok = fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+            ok = ok && fread(buf.data(), 1, (size_t)n * 3, file) ==
+                           (size_t)n * 3;
+            p = buf.data();
+        }
+        if (!ok)
+            break;
+        Stats::add(Stat::bytes_read, (uint64_t)n * 3);
+
+        unpack(p, n, k1.data(), k2.data());
+        for (int i = 0; i < n; i++) {
+            int key2 = k2[i];
+            if (key2 == spec_field2) {
+                s.em_set_entries++;
+                auto it = std::lower_bound(em_set.begin(), em_set.end(),
+                                           std::make_pair((int)(start + i),
+                                                          INT32_MIN));
+                key2 = it != em_set.end() && it->first == start + i ?
+                           it->second :
+                           0;
+            }
+            if (k1[i] == 0 && key2 < 0) {
+                s.sym_entries++;
+                continue;
+            }
+
+            sec_val v = (sec_val)(k1[i] + sval);
+            int wdl = v == virt_win_val ? 1 : (v == virt_loss_val ? -1 : 0);
+            (wdl > 0 ? s.wins : wdl < 0 ? s.losses : s.draws)++;
+            if (k1[i] == 0)
+                s.count_entries++;
+            else
+                s.steps[wdl + 1][std::clamp(key2, 0, step_buckets - 1)]++;
+        }
+    }
+
+    delete z;
+    if (file)
+        fclose(file);
+    return ok;
+}
+
+bool compute(Id id, sec_val sval, const Source &src, Summary &out,
+             int threads)
+{
+    const int64_t count = hash_count_of(id.W, id.B);
+    out.entries = count;
+
+    // The em_set follows the entries: its size, then (index, value) pairs.
+    std::vector<std::pair<int, int>> em_set;
+    {
+        int64_t pos = Sector::header_size + 3 * count;
+        int32_t size = 0;
+        std::vector<int32_t> e;
+        bool ok = false;
+        if (src.mapped) {
+            memcpy(&size, src.mapped + pos, 4);
+            ok = size >= 0 && pos + 4 + (int64_t)size * 8 <= src.size;
+            if (ok) {
+                e.resize((size_t)size * 2);
+                if (size > 0)
+                    memcpy(e.data(), src.mapped + pos + 4, e.size() * 4);
+            }
+        } else if (src.compressed) {
+            CompressedSectorFile *z = CompressedSectorFile::open(src.path);
+            ok = z && z->read(pos, &size, 4) && size >= 0;
+            if (ok) {
+                e.resize((size_t)size * 2);
+                ok = size == 0 || z->read(pos + 4, e.data(), e.size() * 4);
+            }
+            delete z;
+        } else {
+            FILE *file = nullptr;
+            if (FOPEN(&file, src.path.c_str(), "rb") == 0 && file) {
+#ifdef _WIN32
+                ok = _fseeki64(file, pos, SEEK_SET) == 0;
+#else
+                ok = fseeko(file, (off_t)pos, SEEK_SET) == 0;
+#endif
+                ok = ok && fread(&size, 4, 1, file) == 1 && size >= 0;
+                if (ok) {
+                    e.resize((size_t)size * 2);
+                    ok = size == 0 ||
+                         fread(e.data(), 4, e.size(), file) == e.size();
+                }
+                fclose(file);
+            }
+        }
+        if (!ok) {
+            SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                              "Cannot read the em_set of " + src.path);
+            return false;
+        }
+        for (int32_t i = 0; i < size; i++)
+            em_set.emplace_back(e[2 * i], e[2 * i + 1]);
+        std::sort(em_set.begin(), em_set.end());
+    }
+
+    if (threads <= 0)
+        threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    threads = (int)std::max<int64_t>(
+        1, std::min<int64_t>(threads, count / batch + 1));
+
+    std::vector<Summary> parts(threads);
+    std::vector<char> ok(threads, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        int64_t lo = count * t / threads, hi = count * (t + 1) / threads;
+        memset(&parts[t], 0, sizeof(Summary));
+        workers.emplace_back([&, t, lo, hi] {
+            ok[t] = summarize_range(src, lo, hi, sval, em_set, parts[t]);
+        });
+    }
+    for (auto &w : workers)
+        w.join();
+
+    for (int t = 0; t < threads; t++) {
+        if (!ok[t]) {
+            SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                              "Cannot read the entries of " + src.path);
+            return false;
+        }
+        for (int f = 1; f < summary_fields; f++)
+            *fields(out, f) += *fields(parts[t], f);
+    }
+    return true;
+}
+
+} // namespace
+
+bool get(std::recursive_mutex &mutex, Id id, Summary &out, int threads)
+{
+    memset(&out, 0, sizeof(out));
+
+    // pd_init_* replaces both.
+    std::string path;
+    sec_val sval;
+    {
+        TimedLockGuard<std::recursive_mutex> lock(mutex,
+                                                  Stat::pd_mutex_wait_ns);
+        if (!has_sec_val(id)) {
+            SET_ERROR_MESSAGE(PerfectErrors::PE_INVALID_ARGUMENT,
+                              "Unknown sector " + id.to_string());
+            return false;
+        }
+        sval = get_sec_val(id);
+#ifdef _WIN32
+        path = secValPath + "\\" + id.file_name();
+#else
+        path = secValPath + "/" + id.file_name();
+#endif
+    }
+    std::string cache_path = path.substr(0, path.rfind('.')) + ".sum2";
+
+    Source src;
+    int64_t size = file_size(path);
+    src.path = path;
+    if (size < 0) {
+        src.path = path + "z";
+        src.compressed = true;
+        size = file_size(src.path);
+    }
+    if (size < 0) {
+        SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_NOT_FOUND,
+                          "Sector file not found: " + path);
+        return false;
+    }
+    src.size = size;
+    const int64_t mtime = file_mtime(src.path);
+
+    if (load_cache(cache_path, size, mtime, out) &&
+        out.entries == hash_count_of(id.W, id.B))
+        return true;
+    memset(&out, 0, sizeof(out));
+
+    void *map = nullptr;
+#ifndef _WIN32
+    if (!src.compressed && size > 0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            map = mmap(nullptr, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (map == MAP_FAILED)
+                map = nullptr;
+            else
+                madvise(map, (size_t)size, MADV_SEQUENTIAL);
+        }
+    }
+#endif
+    src.mapped = static_cast<const unsigned char *>(map);
+
+    // A truncated file would be read past its end through the mapping.
+    const int64_t count = hash_count_of(id.W, id.B);
+    bool ok = src.compressed ||
+              size >= Sector::header_size + 3 * count + 4;
+    if (!ok)
+        SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                          "Truncated sector file " + path);
+    ok = ok && compute(id, sval, src, out, threads);
+
+#ifndef _WIN32
+    if (map)
+        munmap(map, (size_t)size);
+#endif
+
+    if (ok)
+        save_cache(cache_path, size, mtime, out);
+    return ok;
+}
+
+} // namespace SectorSummary
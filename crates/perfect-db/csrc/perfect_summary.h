@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_summary.h
+//
+// Per-sector statistics: results, entry kinds and the step distribution,
+// decoded straight from the sector file (mapped where possible) by several
+// threads, without building the sector's hash tables.
+//
+// A computed summary is cached next to the sector file as
+// <variant>_W_B_WF_BF.sum2 (when the directory is writable), little-endian:
+//
+//   char magic[4] = "SMSS"; u8 version = 2;
+//   u64 size of the sector file the summary was computed from
+//   i64 modification time of that file (ns since the epoch)
+//   i64 entries, wins, draws, losses, sym, counts, em_set entries
+//   i64 steps[3][step_buckets]
+//
+// A cache whose recorded size or modification time differs from the sector
+// file is recomputed.
+
+#ifndef PERFECT_SUMMARY_H_INCLUDED
+#define PERFECT_SUMMARY_H_INCLUDED
+
+#include "perfect_common.h"
+
+#include <cstdint>
+#include <mutex>
+
+namespace SectorSummary {
+
+const int step_buckets = 256;
+
+struct Summary
+{
+    int64_t entries;        // hash_count of the sector
+    int64_t wins, draws, losses; // of the entries that are not redirects
+    int64_t sym_entries;    // redirects to a symmetric entry
+    int64_t count_entries;  // draws stored as a count
+    int64_t em_set_entries; // values that overflowed into the em_set
+    // Steps of the value entries by result (wdl + 1); the last bucket also
+    // counts longer ones.
+    int64_t steps[3][step_buckets];
+};
+
+// Reads the cached summary of a sector or computes (and caches) it. The
+// database directory and the sector value are read under mutex (the API
+// mutex), the files without it. threads <= 0 uses every core. Returns false
+// (with an error set) if the sector file is missing or damaged.
+bool get(std::recursive_mutex &mutex, Id id, Summary &out, int threads = 0);
+
+} // namespace SectorSummary
+
+#endif // PERFECT_SUMMARY_H_INCLUDED
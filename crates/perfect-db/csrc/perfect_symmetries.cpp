@@ -6,61 +6,75 @@
 
 #include "perfect_symmetries.h"
 #include "perfect_common.h"
-#include "perfect_symmetries_slow.h"
 
-int (*slow[16])(int) = {rotate90,
-                        rotate180,
-                        rotate270,
-                        mirror_vertical,
-                        mirror_horizontal,
-                        mirror_backslash,
-                        mirror_slash,
-                        swap,
-                        swap_rotate90,
-                        swap_rotate180,
-                        swap_rotate270,
-                        swap_mirror_vertical,
-                        swap_mirror_horizontal,
-                        swap_mirror_backslash,
-                        swap_mirror_slash,
-                        id_transform};
+#include <array>
+
+namespace {
+
+// Image of square sq under op. Every ring has 8 squares; the operations
+// 0..6 rotate or mirror within the rings, 7 swaps the inner and outer ring,
+// 8..14 are the swapped versions of 0..6 and 15 is the identity (the same
+// order as the functions in perfect_symmetries_slow.h).
+constexpr int sym_square(int op, int sq)
+{
+    int ring = sq / 8, p = sq % 8;
+    switch (op < 7 ? op : op - 8) {
+    case 0:
+        p = p + 2;
+        break;
+    case 1:
+        p = p + 4;
+        break;
+    case 2:
+        p = p + 6;
+        break;
+    case 3:
+        p = 4 - p;
+        break;
+    case 4:
+        p = -p;
+        break;
+    case 5:
+        p = 2 - p;
+        break;
+    case 6:
+        p = 6 - p;
+        break;
+    default:
+        break;
+    }
+    if (op >= 7 && op < 15)
+        ring = 2 - ring;
+    return ring * 8 + (p & 7);
+}
 
 const int patsize = 8, patc = 1 << patsize;
 static_assert(24 % patsize == 0, "");
 
-int table1[16][patc], table2[16][patc], table3[16][patc]; // 64 KB in total
+using SymTable = std::array<std::array<int, patc>, 16>;
 
-void init_symmetry_lookup_tables()
+// Images of the patterns of the byte starting at bit `shift`. Every pattern
+// is its lowest bit or-ed with an already computed smaller pattern.
+constexpr SymTable make_sym_table(int shift)
 {
-    static bool called = false;
-    if (called)
-        return;
-    called = true;
-
-    LOG("init_symmetry_lookup_tables\n");
-
-    for (int pat = 0; pat < patc; pat++) {
-        /*for(int i=0; i<16; i++)
-                table1[i][pat] = slow[i](pat << 0);
-        for(int i=0; i<16; i++)
-                table2[i][pat] = slow[i](pat << 6);
-        for(int i=0; i<16; i++)
-                table3[i][pat] = slow[i](pat << 12);
-        for(int i=0; i<16; i++)
-                table4[i][pat] = slow[i](pat << 18);*/
+    SymTable t {};
+    for (int op = 0; op < 16; op++)
+        for (int pat = 1; pat < patc; pat++) {
+            int low = pat & -pat, bit = 0;
+            while (!((low >> bit) & 1))
+                bit++;
+            t[op][pat] = t[op][pat & (pat - 1)] |
+                         1 << sym_square(op, shift + bit);
+        }
+    return t;
+}
 
-        /*for(int k = 0; k < patn; k++)
-                for(int i = 0; i<16; i++)
-                        table[k][i][pat] = slow[i](pat << k*patsize);*/
+// 48 KB in total
+constexpr SymTable table1 = make_sym_table(0);
+constexpr SymTable table2 = make_sym_table(8);
+constexpr SymTable table3 = make_sym_table(16);
 
-        for (int i = 0; i < 16; i++)
-            table1[i][pat] = slow[i](pat << 0);
-        for (int i = 0; i < 16; i++)
-            table2[i][pat] = slow[i](pat << 8);
-        for (int i = 0; i < 16; i++)
-            table3[i][pat] = slow[i](pat << 16);
-    }
-}
+} // namespace
 
 board sym24_transform(int op, board a)
 {
@@ -9,8 +9,6 @@
 
 #include "perfect_common.h"
 
-void init_symmetry_lookup_tables();
-
 board sym24_transform(int op, board a);
 board sym48_transform(int op, board a);
 
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_trace.cpp
+
+#include "perfect_trace.h"
+#include "perfect_errors.h"
+#include "perfect_platform.h"
+#include "perfect_sec_val.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+namespace AccessTrace {
+
+std::atomic<bool> g_enabled {false};
+
+namespace {
+
+// Indexed like the sector value table (sec_val_index).
+std::atomic<uint64_t> g_counts[sec_val_id_count];
+
+Id id_of_index(int i)
+{
+    Id id;
+    id.BF = i % sec_val_dim;
+    i /= sec_val_dim;
+    id.WF = i % sec_val_dim;
+    i /= sec_val_dim;
+    id.B = i % sec_val_dim;
+    id.W = i / sec_val_dim;
+    return id;
+}
+
+} // namespace
+
+void record_enabled(const Id &id)
+{
+    g_counts[sec_val_index(id)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void set_enabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void reset()
+{
+    for (auto &c : g_counts)
+        c.store(0, std::memory_order_relaxed);
+}
+
+void snapshot(std::vector<std::pair<Id, uint64_t>> &out)
+{
+    out.clear();
+    for (int i = 0; i < sec_val_id_count; i++) {
+        uint64_t n = g_counts[i].load(std::memory_order_relaxed);
+        if (n > 0)
+            out.emplace_back(id_of_index(i), n);
+    }
+    std::stable_sort(out.begin(), out.end(), [](const auto &a, const auto &b) {
+        return a.second > b.second;
+    });
+}
+
+int save_profile(const std::string &path)
+{
+    std::vector<std::pair<Id, uint64_t>> entries;
+    snapshot(entries);
+
+    FILE *f = nullptr;
+    if (FOPEN(&f, path.c_str(), "w") == -1 || !f) {
+        SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                          "Cannot write access profile " + path);
+        return -1;
+    }
+    fprintf(f, "# W B WF BF count\n");
+    for (const auto &e : entries)
+        fprintf(f, "%d %d %d %d %llu\n", e.first.W, e.first.B, e.first.WF,
+                e.first.BF, (unsigned long long)e.second);
+    bool ok = fclose(f) == 0;
+    if (!ok) {
+        SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_IO_ERROR,
+                          "Cannot write access profile " + path);
+        return -1;
+    }
+    return (int)entries.size();
+}
+
+bool load_profile(const std::string &path, std::vector<Id> &hottest_first)
+{
+    hottest_first.clear();
+
+    FILE *f = nullptr;
+    if (FOPEN(&f, path.c_str(), "r") == -1 || !f) {
+        SET_ERROR_MESSAGE(PerfectErrors::PE_FILE_NOT_FOUND,
+                          "Cannot open access profile " + path);
+        return false;
+    }
+
+    std::map<int, uint64_t> counts;
+    char line[256];
+    int line_no = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        const char *p = line;
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+            continue;
+
+        Id id;
+        unsigned long long n = 0;
+        if (sscanf(p, "%d %d %d %d %llu", &id.W, &id.B, &id.WF, &id.BF, &n) !=
+                5 ||
+            id.W < 0 || id.W >= sec_val_dim || id.B < 0 ||
+            id.B >= sec_val_dim || id.WF < 0 || id.WF >= sec_val_dim ||
+            id.BF < 0 || id.BF >= sec_val_dim) {
+            SET_ERROR_MESSAGE(PerfectErrors::PE_INVALID_ARGUMENT,
+                              "Malformed line " + std::to_string(line_no) +
+                                  " in access profile " + path);
+            ok = false;
+            break;
+        }
+        counts[sec_val_index(id)] += n;
+    }
+    fclose(f);
+    if (!ok)
+        return false;
+
+    std::vector<std::pair<int, uint64_t>> sorted(counts.begin(), counts.end());
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const auto &a, const auto &b) {
+                         return a.second > b.second;
+                     });
+    for (const auto &e : sorted)
+        hottest_first.push_back(id_of_index(e.first));
+    return true;
+}
+
+} // namespace AccessTrace
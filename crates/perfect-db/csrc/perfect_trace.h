@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_trace.h
+//
+// Optional access trace of the sectors: while enabled, every sector lookup
+// (WSector::hash, WSector::wdl, pd_open_sector) bumps a per-sector counter.
+// The counters are saved as a profile, and a profile (or several
+// concatenated ones) can be replayed at startup to build the hash tables of
+// the hottest sectors before the first query needs them (pd_preload_profile).
+//
+// Profile format, one sector per line, hottest first; '#' starts a comment:
+//
+//   W B WF BF count
+
+#ifndef PERFECT_TRACE_H_INCLUDED
+#define PERFECT_TRACE_H_INCLUDED
+
+#include "perfect_common.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace AccessTrace {
+
+extern std::atomic<bool> g_enabled;
+
+void record_enabled(const Id &id);
+
+// A single relaxed load while tracing is off.
+inline void record(const Id &id)
+{
+    if (g_enabled.load(std::memory_order_relaxed))
+        record_enabled(id);
+}
+
+void set_enabled(bool enabled);
+void reset();
+
+// The traced sectors, hottest first.
+void snapshot(std::vector<std::pair<Id, uint64_t>> &out);
+
+// Writes the snapshot to path. Returns the number of sectors written, or -1
+// (with an error set) if the file cannot be written.
+int save_profile(const std::string &path);
+
+// Reads a profile; counts of repeated sectors are summed, so profiles of
+// several processes can simply be concatenated. Returns false (with an error
+// set) if the file cannot be read or has a malformed line.
+bool load_profile(const std::string &path, std::vector<Id> &hottest_first);
+
+} // namespace AccessTrace
+
+#endif // PERFECT_TRACE_H_INCLUDED
@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_variant.h
+//
+// Compile-time description of the rule variants. Every variant is a policy
+// type with constexpr mill and adjacency tables, so the rules and the move
+// generator can be instantiated once per variant (see Rules and
+// PerfectPlayer::get_move_list) instead of reading tables that are copied
+// into globals at init.
+
+#ifndef PERFECT_VARIANT_H_INCLUDED
+#define PERFECT_VARIANT_H_INCLUDED
+
+#include "perfect_common.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Squares 0..23 are three rings of 8 (outer, middle, inner); a ring's mills
+// are its corners with the midpoint between them, the cross mills connect
+// the same square of the three rings.
+struct VariantTables
+{
+    int millCount;
+    uint8_t millPos[20][3];
+    int invMillPos[24][3]; // the mills through a square
+    int invMillPosLengths[24];
+    bool boardGraph[24][24];
+    uint8_t aLBoardGraph[24][5]; // [i][0] is the neighbour count
+};
+
+// The board graph is implied by the mills: two squares are adjacent iff they
+// are consecutive squares of a mill.
+template <int N>
+constexpr VariantTables make_variant_tables(const uint8_t (&mills)[N][3])
+{
+    static_assert(N <= 20, "");
+    VariantTables t {};
+    t.millCount = N;
+    for (int j = 0; j < N; j++)
+        for (int k = 0; k < 3; k++)
+            t.millPos[j][k] = mills[j][k];
+
+    for (int i = 0; i < 24; i++)
+        for (int j = 0; j < N; j++)
+            if (mills[j][0] == i || mills[j][1] == i || mills[j][2] == i)
+                t.invMillPos[i][t.invMillPosLengths[i]++] = j;
+
+    for (int j = 0; j < N; j++)
+        for (int k = 0; k < 2; k++) {
+            t.boardGraph[mills[j][k]][mills[j][k + 1]] = true;
+            t.boardGraph[mills[j][k + 1]][mills[j][k]] = true;
+        }
+
+    for (int i = 0; i < 24; i++)
+        for (int j = 0; j < 24; j++)
+            if (t.boardGraph[i][j])
+                t.aLBoardGraph[i][++t.aLBoardGraph[i][0]] =
+                    static_cast<uint8_t>(j);
+    return t;
+}
+
+inline constexpr uint8_t stdLaskerMills[16][3] = {
+    {1, 2, 3},    {3, 4, 5},    {5, 6, 7},    {7, 0, 1},
+    {9, 10, 11},  {11, 12, 13}, {13, 14, 15}, {15, 8, 9},
+    {17, 18, 19}, {19, 20, 21}, {21, 22, 23}, {23, 16, 17},
+    {0, 8, 16},   {2, 10, 18},  {4, 12, 20},  {6, 14, 22}};
+
+// Morabaraba also has mills on the diagonals.
+inline constexpr uint8_t moraMills[20][3] = {
+    {1, 2, 3},    {3, 4, 5},    {5, 6, 7},    {7, 0, 1},
+    {9, 10, 11},  {11, 12, 13}, {13, 14, 15}, {15, 8, 9},
+    {17, 18, 19}, {19, 20, 21}, {21, 22, 23}, {23, 16, 17},
+    {0, 8, 16},   {2, 10, 18},  {4, 12, 20},  {6, 14, 22},
+    {1, 9, 17},   {3, 11, 19},  {5, 13, 21},  {7, 15, 23}};
+
+inline constexpr VariantTables stdLaskerTables = make_variant_tables(
+    stdLaskerMills);
+inline constexpr VariantTables moraTables = make_variant_tables(moraMills);
+
+static_assert(stdLaskerTables.aLBoardGraph[1][0] == 2 &&
+                  stdLaskerTables.aLBoardGraph[0][0] == 3 &&
+                  stdLaskerTables.aLBoardGraph[8][0] == 4,
+              "");
+static_assert(moraTables.aLBoardGraph[9][0] == 4 &&
+                  moraTables.invMillPosLengths[1] == 3,
+              "");
+
+// The variant policies. mixedPlacement: placing and sliding moves can be
+// mixed (Lasker), otherwise all stones are placed before the first slide.
+struct StdVariant
+{
+    static constexpr int id = STANDARD;
+#ifdef FULL_SECTOR_GRAPH
+    static constexpr int maxKSZ = 12;
+#else
+    static constexpr int maxKSZ = 9;
+#endif
+    static constexpr const char *name = "std";
+    static constexpr bool mixedPlacement = false;
+    static constexpr const VariantTables &tables = stdLaskerTables;
+};
+
+struct LaskVariant
+{
+    static constexpr int id = LASKER;
+#ifdef FULL_SECTOR_GRAPH
+    static constexpr int maxKSZ = 12;
+#else
+    static constexpr int maxKSZ = 10;
+#endif
+    static constexpr const char *name = "lask";
+    static constexpr bool mixedPlacement = true;
+    static constexpr const VariantTables &tables = stdLaskerTables;
+};
+
+struct MoraVariant
+{
+    static constexpr int id = MORABARABA;
+    static constexpr int maxKSZ = 12;
+    static constexpr const char *name = "mora";
+    static constexpr bool mixedPlacement = false;
+    static constexpr const VariantTables &tables = moraTables;
+};
+
+// Calls f with the policy of `variant` (STANDARD, LASKER or MORABARABA, as
+// in ruleVariant); an unknown variant is treated as the standard one.
+template <class F>
+decltype(auto) visit_variant(int variant, F &&f)
+{
+    switch (variant) {
+    case LASKER:
+        return f(LaskVariant {});
+    case MORABARABA:
+        return f(MoraVariant {});
+    default:
+        return f(StdVariant {});
+    }
+}
+
+#endif // PERFECT_VARIANT_H_INCLUDED
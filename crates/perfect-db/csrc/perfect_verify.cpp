@@ -0,0 +1,499 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_verify.cpp
+
+#include "perfect_verify.h"
+#include "perfect_bulk.h"
+#include "perfect_compressed.h"
+#include "perfect_errors.h"
+#include "perfect_game_state.h"
+#include "perfect_hash.h"
+#include "perfect_log.h"
+#include "perfect_player.h"
+#include "perfect_sector.h"
+#include "perfect_sector_graph.h"
+#include "perfect_stats.h"
+#include "perfect_wrappers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace DatabaseVerify {
+
+namespace {
+
+// Entries handed to a thread at a time in the retrograde pass.
+const int chunk = 1 << 12;
+
+void add_issue(std::vector<Issue> &out, const Id &id, IssueKind kind,
+               const std::string &message, int64_t index = -1, board b = 0)
+{
+    Issue issue;
+    issue.id = id;
+    issue.kind = kind;
+    issue.index = index;
+    issue.b = b;
+    issue.message = message;
+    out.push_back(issue);
+}
+
+// The bytes of the (uncompressed) sector file, from a .sec2 or a .sec2z.
+class RawFile
+{
+    FILE *f {nullptr};
+    CompressedSectorFile *z {nullptr};
+
+public:
+    ~RawFile()
+    {
+        delete z;
+        if (f)
+            fclose(f);
+    }
+
+    bool open_plain(const std::string &path)
+    {
+        return FOPEN(&f, path.c_str(), "rb") == 0 && f;
+    }
+
+    CompressedSectorFile *open_compressed(const std::string &path)
+    {
+        z = CompressedSectorFile::open(path);
+        return z;
+    }
+
+    bool read(int64_t offset, void *buf, size_t n)
+    {
+        if (z)
+            return z->read((uint64_t)offset, buf, n);
+#ifdef _WIN32
+        if (_fseeki64(f, offset, SEEK_SET) != 0)
+            return false;
+#else
+        if (fseeko(f, (off_t)offset, SEEK_SET) != 0)
+            return false;
+#endif
+        return fread(buf, 1, n, f) == n;
+    }
+};
+
+// Header, size and em_set of one sector file. Returns false if anything is
+// wrong, so that the retrograde pass does not load the sector.
+bool check_structure(Id id, std::vector<Issue> &issues)
+{
+#ifdef _WIN32
+    std::string path = secValPath + "\\" + id.file_name();
+#else
+    std::string path = secValPath + "/" + id.file_name();
+#endif
+    const size_t first_issue = issues.size();
+
+    RawFile file;
+    int64_t size = file_size(path);
+    if (size >= 0) {
+        if (!file.open_plain(path)) {
+            add_issue(issues, id, IssueKind::unreadable,
+                      "Cannot open " + path);
+            return false;
+        }
+    } else {
+        path += "z";
+        int64_t stored = file_size(path);
+        if (stored < 0) {
+            add_issue(issues, id, IssueKind::unreadable,
+                      "Sector file not found");
+            return false;
+        }
+        CompressedSectorFile *z = file.open_compressed(path);
+        if (!z) {
+            add_issue(issues, id, IssueKind::size,
+                      "Invalid container: " +
+                          PerfectErrors::getLastErrorMessage());
+            PerfectErrors::clearError();
+            return false;
+        }
+        if ((int64_t)z->compressed_size() != stored) {
+            add_issue(issues, id, IssueKind::size,
+                      "Container is " + std::to_string(stored) +
+                          " bytes, its index ends at " +
+                          std::to_string(z->compressed_size()));
+            return false;
+        }
+        size = (int64_t)z->size();
+    }
+
+    const int64_t count = hash_count_of(id.W, id.B);
+    const int64_t em_set_pos = Sector::header_size + eval_struct_size * count;
+    if (size < em_set_pos + 4) {
+        add_issue(issues, id, IssueKind::size,
+                  "Truncated: " + std::to_string(size) +
+                      " bytes, the entries alone need " +
+                      std::to_string(em_set_pos + 4));
+        return false;
+    }
+
+#ifdef DD
+    int header[3];
+    char flag;
+    if (!file.read(0, header, sizeof(header)) ||
+        !file.read(sizeof(header), &flag, 1)) {
+        add_issue(issues, id, IssueKind::unreadable, "Cannot read the header");
+        PerfectErrors::clearError();
+        return false;
+    }
+    const int expected[3] = {version, eval_struct_size, field2Offset};
+    const char *names[3] = {"version", "eval_struct_size", "field2Offset"};
+    for (int i = 0; i < 3; i++)
+        if (header[i] != expected[i])
+            add_issue(issues, id, IssueKind::header,
+                      std::string(names[i]) + " is " +
+                          std::to_string(header[i]) + ", expected " +
+                          std::to_string(expected[i]));
+    if (flag != stone_diff_flag)
+        add_issue(issues, id, IssueKind::header,
+                  "stone_diff_flag is " + std::to_string((int)flag) +
+                      ", expected " + std::to_string((int)stone_diff_flag));
+#endif
+
+    int32_t em_set_size = 0;
+    if (!file.read(em_set_pos, &em_set_size, 4)) {
+        add_issue(issues, id, IssueKind::unreadable,
+                  "Cannot read em_set_size");
+        PerfectErrors::clearError();
+        return false;
+    }
+    const int64_t expected_size = em_set_pos + 4 + 8 * (int64_t)em_set_size;
+    if (em_set_size < 0 || size != expected_size) {
+        add_issue(issues, id, IssueKind::size,
+                  "File is " + std::to_string(size) + " bytes, expected " +
+                      std::to_string(expected_size) + " for " +
+                      std::to_string(em_set_size) + " em_set entries");
+        return false;
+    }
+
+    std::vector<int32_t> e((size_t)em_set_size * 2);
+    if (em_set_size > 0 && !file.read(em_set_pos + 4, e.data(), e.size() * 4)) {
+        add_issue(issues, id, IssueKind::unreadable, "Cannot read the em_set");
+        PerfectErrors::clearError();
+        return false;
+    }
+    for (int32_t i = 0; i < em_set_size; i++) {
+        if (e[2 * i] < 0 || e[2 * i] >= count) {
+            add_issue(issues, id, IssueKind::em_set,
+                      "em_set entry " + std::to_string(i) + " has index " +
+                          std::to_string(e[2 * i]),
+                      e[2 * i]);
+            break;
+        }
+    }
+
+    return issues.size() == first_issue;
+}
+
+// What the retrograde pass of one sector needs.
+struct Task
+{
+    PerfectPlayer &player;
+    Wrappers::WSector *wsec;
+    Sector *sec;
+    // The sector itself and its successors, loaded.
+    std::map<Id, Sector *> loaded;
+    int max_issues;
+};
+
+// PerfectPlayer::move_value of m in position a (white to move in sector
+// id), reading the loaded sectors directly instead of through the hash LRU
+// (which is not thread-safe).
+bool child_value(const Task &t, Id id, board a, const AdvancedMove &m,
+                 Wrappers::gui_eval_elem2 &out)
+{
+    PerfectPlayer::sector_child(m, a, id);
+
+    Wrappers::gui_eval_elem2 v = Wrappers::gui_eval_elem2::virt_loss_val();
+    if (id.W + id.WF >= 3) {
+        auto it = t.loaded.find(id);
+        if (it == t.loaded.end()) {
+            SET_ERROR_MESSAGE(PerfectErrors::PE_DATABASE_NOT_FOUND,
+                              "Child in unexpected sector " +
+                                  id.to_string());
+            return false;
+        }
+        Sector *cs = it->second;
+        v = Wrappers::gui_eval_elem2(cs->hash->hash(a).second, cs);
+        if (PerfectErrors::hasError())
+            return false;
+    }
+    out = v.undo_negate(t.wsec);
+    return true;
+}
+
+struct Part
+{
+    int64_t positions {0};
+    int64_t mismatches {0};
+    std::vector<Issue> issues;
+};
+
+void check_chunk(const Task &t, int64_t lo, int64_t hi, Part &part)
+{
+    const Id &id = t.sec->id;
+    for (int64_t i = lo; i < hi; i++) {
+        eval_elem_sym2 e = t.sec->get_eval_inner((int)i);
+        if (PerfectErrors::hasError()) {
+            part.mismatches++;
+            if ((int)part.issues.size() < t.max_issues)
+                add_issue(part.issues, id, IssueKind::unreadable,
+                          PerfectErrors::getLastErrorMessage(), i);
+            PerfectErrors::clearError();
+            continue;
+        }
+        if (e.cas() == eval_elem_sym2::Sym)
+            continue;
+
+        board a = t.sec->hash->inverse_hash((int)i);
+        GameState s = PerfectPlayer::sector_state(id, a);
+
+        // A side without moves has lost.
+        Wrappers::gui_eval_elem2 best(
+            static_cast<sec_val>(virt_loss_val - t.sec->sval), 0, t.sec);
+        bool first = true;
+        bool ok = true;
+        for (AdvancedMove &m : t.player.get_move_list(s)) {
+            Wrappers::gui_eval_elem2 v = best;
+            if (!child_value(t, id, a, m, v)) {
+                ok = false;
+                break;
+            }
+            if (first || v > best)
+                best = v;
+            first = false;
+        }
+        if (!ok) {
+            part.mismatches++;
+            if ((int)part.issues.size() < t.max_issues)
+                add_issue(part.issues, id, IssueKind::unreadable,
+                          PerfectErrors::getLastErrorMessage(), i, a);
+            PerfectErrors::clearError();
+            continue;
+        }
+
+        part.positions++;
+        Wrappers::gui_eval_elem2 stored(eval_elem2(e), t.sec);
+        if (!(best == stored)) {
+            part.mismatches++;
+            if ((int)part.issues.size() < t.max_issues)
+                add_issue(part.issues, id, IssueKind::value,
+                          "stored " + stored.to_string() + ", children give " +
+                              best.to_string(),
+                          i, a);
+        }
+    }
+}
+
+void check_values(Task &t, int threads, Report &report,
+                  std::vector<Issue> &issues)
+{
+    const int64_t count = t.sec->hash->hash_count;
+    const int64_t chunks = (count + chunk - 1) / chunk;
+    threads = (int)std::max<int64_t>(1, std::min<int64_t>(threads, chunks));
+
+    std::atomic<int64_t> next {0};
+    std::vector<Part> parts(threads);
+    std::vector<std::thread> workers;
+    for (int w = 0; w < threads; w++) {
+        workers.emplace_back([&, w] {
+            // Chunks are taken in increasing order, so each thread's issues
+            // are its lowest indices.
+            for (int64_t c; (c = next.fetch_add(1)) < chunks;)
+                check_chunk(t, c * chunk, std::min(count, (c + 1) * chunk),
+                            parts[w]);
+        });
+    }
+    for (auto &w : workers)
+        w.join();
+
+    std::vector<Issue> found;
+    for (Part &p : parts) {
+        report.positions_checked += p.positions;
+        report.mismatches += p.mismatches;
+        found.insert(found.end(), p.issues.begin(), p.issues.end());
+    }
+    std::sort(found.begin(), found.end(), [](const Issue &a, const Issue &b) {
+        return a.index < b.index;
+    });
+    if ((int)found.size() > t.max_issues)
+        found.resize(t.max_issues);
+    issues.insert(issues.end(), found.begin(), found.end());
+}
+
+} // namespace
+
+bool run(std::recursive_mutex &mutex, PerfectPlayer *const &player,
+         const std::vector<Id> &ids, int threads, bool retrograde,
+         int max_issues, Report &report)
+{
+    report = Report();
+    if (threads <= 0)
+        threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    max_issues = std::max(max_issues, 0);
+
+    // The structure pass reads the files only.
+    std::vector<char> present(ids.size(), 0);
+    {
+        TimedLockGuard<std::recursive_mutex> lock(mutex,
+                                                  Stat::pd_mutex_wait_ns);
+        if (!player)
+            return false;
+        for (size_t i = 0; i < ids.size(); i++)
+            present[i] = player->secs.count(Wrappers::WID(ids[i])) != 0;
+    }
+
+    // Structure of every sector, several at a time.
+    std::vector<std::vector<Issue>> found(ids.size());
+    std::vector<char> sound(ids.size(), 0);
+    {
+        std::atomic<size_t> next {0};
+        std::vector<std::thread> workers;
+        int n = (int)std::min<size_t>(threads, ids.size());
+        for (int w = 0; w < n; w++) {
+            workers.emplace_back([&] {
+                for (size_t i; (i = next.fetch_add(1)) < ids.size();) {
+                    if (!present[i]) {
+                        add_issue(found[i], ids[i], IssueKind::unreadable,
+                                  "Sector is not in the database");
+                        continue;
+                    }
+                    sound[i] = check_structure(ids[i], found[i]);
+                }
+            });
+        }
+        for (auto &w : workers)
+            w.join();
+    }
+    std::map<Id, bool> sound_by_id;
+    for (size_t i = 0; i < ids.size(); i++)
+        sound_by_id[ids[i]] = sound[i];
+
+    auto take = [&](const std::vector<Issue> &from) {
+        for (const Issue &issue : from) {
+            if ((int)report.issues.size() >= max_issues)
+                break;
+            report.issues.push_back(issue);
+        }
+    };
+
+    // The retrograde pass takes the sectors in the order of BulkSchedule, to
+    // build the hash tables of each W once; the issues still follow ids.
+    std::vector<std::vector<Issue>> checked(ids.size());
+    std::vector<size_t> schedule(retrograde ? ids.size() : 0);
+    std::iota(schedule.begin(), schedule.end(), 0);
+    {
+        std::map<Id, size_t> rank;
+        for (const Id &id : BulkSchedule::order(ids))
+            rank.emplace(id, rank.size());
+        std::stable_sort(schedule.begin(), schedule.end(),
+                         [&](size_t a, size_t b) {
+                             return rank[ids[a]] < rank[ids[b]];
+                         });
+    }
+    BulkSchedule::Pin pin;
+
+    for (size_t i : schedule) {
+        Id id = ids[i];
+
+        TimedLockGuard<std::recursive_mutex> lock(mutex,
+                                                  Stat::pd_mutex_wait_ns);
+        if (!player) {
+            SET_ERROR_CODE(PerfectErrors::PE_RUNTIME_ERROR,
+                           "The database was closed during the "
+                           "verification");
+            return false;
+        }
+
+        // The successors must be in the database and sound, too.
+        std::vector<Id> needed {id};
+        for (const Id &c : graph_func(id))
+            needed.push_back(c);
+        bool available = sound[i];
+        for (const Id &c : needed) {
+            if (!available)
+                break;
+            auto it = sound_by_id.find(c);
+            if (it != sound_by_id.end()) {
+                available = it->second;
+            } else {
+                available = player->secs.count(Wrappers::WID(c)) != 0;
+                if (available) {
+                    std::vector<Issue> ignored;
+                    available = sound_by_id[c] = check_structure(c, ignored);
+                }
+            }
+        }
+        if (!available) {
+            report.sectors_skipped++;
+            continue;
+        }
+
+        // Keep every needed sector in the hash LRU while the threads read.
+        const int capacity = Wrappers::hash_cache_capacity();
+        Wrappers::set_hash_cache_capacity(
+            std::max(capacity, (int)needed.size()));
+
+        pin.hold(id.W);
+        Task t {*player, &player->secs.find(Wrappers::WID(id))->second,
+                nullptr, {}, max_issues};
+        for (const Id &c : needed) {
+            Sector *s = player->secs.find(Wrappers::WID(c))->second.load();
+            if (!s) {
+                available = false;
+                break;
+            }
+            t.loaded[c] = s;
+        }
+        // Every entry of the sector and many of its children are read.
+        std::vector<Sector *> mapped;
+        for (auto &entry : t.loaded)
+            if (!entry.second->mapped && entry.second->map_file())
+                mapped.push_back(entry.second);
+        t.sec = available ? t.loaded[id] : nullptr;
+
+        if (!available) {
+            std::vector<Issue> issues;
+            add_issue(issues, id, IssueKind::unreadable,
+                      "Cannot load the sector or its successors: " +
+                          PerfectErrors::getLastErrorMessage());
+            PerfectErrors::clearError();
+            checked[i] = issues;
+            report.sectors_skipped++;
+        } else {
+#ifdef DEBUG
+            const int64_t before = report.mismatches;
+#endif
+            check_values(t, threads, report, checked[i]);
+#ifdef DEBUG
+            LOG("Verified %s: %lld mismatches\n", id.to_string().c_str(),
+                (long long)(report.mismatches - before));
+#endif
+        }
+
+        for (Sector *s : mapped)
+            s->unmap_file();
+        Wrappers::set_hash_cache_capacity(capacity);
+    }
+
+    for (size_t i = 0; i < ids.size(); i++) {
+        report.sectors_checked++;
+        take(found[i]);
+        take(checked[i]);
+    }
+    return true;
+}
+
+} // namespace DatabaseVerify
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_verify.h
+//
+// Integrity checks of the database files, in two passes:
+//
+// - structure: the header fields, the file size implied by the hash_count
+//   and the em_set, and the em_set indices, for every sector in parallel;
+// - retrograde: every stored value is recomputed from the values of the
+//   position's children (PerfectPlayer::get_move_list, looked up in the
+//   successor sectors from graph_func) and compared with the stored one. The
+//   hash range of a sector is split across threads. Sectors whose successors
+//   are missing from the database (or failed the first pass) are skipped. The
+//   sectors go in the order of BulkSchedule.
+//
+// The retrograde pass holds the sector and its successors in the hash LRU,
+// so it keeps other lookups out (the API mutex) while it checks a sector;
+// queries run between the sectors.
+
+#ifndef PERFECT_VERIFY_H_INCLUDED
+#define PERFECT_VERIFY_H_INCLUDED
+
+#include "perfect_common.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class PerfectPlayer;
+
+namespace DatabaseVerify {
+
+enum class IssueKind {
+    header = 1,     // wrong version, entry size, field offset or flag
+    size = 2,       // truncated file, trailing bytes, bad container
+    em_set = 3,     // em_set entry outside the sector
+    value = 4,      // the stored value differs from the recomputed one
+    unreadable = 5, // an entry or a child could not be read
+};
+
+struct Issue
+{
+    Id id;
+    IssueKind kind;
+    int64_t index {-1}; // hash index, -1 for file-level issues
+    board b {0};        // the position at index, as Hash::inverse_hash
+    std::string message;
+};
+
+struct Report
+{
+    int64_t sectors_checked {0};
+    int64_t sectors_skipped {0}; // retrograde pass only
+    int64_t positions_checked {0};
+    int64_t mismatches {0};
+    // The first issues of each sector (lowest hash indices first), in the
+    // order of the sectors, at most max_issues in total.
+    std::vector<Issue> issues;
+};
+
+// Checks the given sectors. threads <= 0 uses every core; the retrograde
+// pass is skipped unless retrograde is set. player is only read with mutex
+// held, which is taken for the sector list and then once per sector of the
+// retrograde pass; if player has become nullptr (the database was closed),
+// the pass stops. Returns false (with an error set) only if the
+// verification itself could not run; damaged files are reported as issues.
+bool run(std::recursive_mutex &mutex, PerfectPlayer *const &player,
+         const std::vector<Id> &ids, int threads, bool retrograde,
+         int max_issues, Report &report);
+
+} // namespace DatabaseVerify
+
+#endif // PERFECT_VERIFY_H_INCLUDED
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_wdl_plane.cpp
+
+#include "perfect_wdl_plane.h"
+#include "perfect_common.h"
+#include "perfect_stats.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const char plane_magic[4] = {'S', 'M', 'W', 'D'};
+static const int plane_header_size = 13;
+
+WdlPlane *WdlPlane::open(const std::string &path, int64_t expected_count)
+{
+    FILE *file = nullptr;
+    if (FOPEN(&file, path.c_str(), "rb") == -1)
+        return nullptr;
+
+    unsigned char h[plane_header_size];
+    int64_t count = 0;
+    bool ok = fread(h, 1, sizeof(h), file) == sizeof(h) &&
+              memcmp(h, plane_magic, 4) == 0 && h[4] == version;
+    if (ok) {
+        for (int i = 0; i < 8; i++)
+            count |= (int64_t)h[5 + i] << (8 * i);
+        ok = count == expected_count;
+    }
+
+    WdlPlane *plane = nullptr;
+    if (ok) {
+        plane = new WdlPlane();
+        plane->count = count;
+        plane->bits.resize((size_t)((count + 3) / 4));
+        ok = fread(plane->bits.data(), 1, plane->bits.size(), file) ==
+             plane->bits.size();
+        Stats::add(Stat::bytes_read, sizeof(h) + plane->bits.size());
+    }
+    fclose(file);
+
+    if (!ok) {
+        // Not fatal: the caller falls back to the sector file.
+#ifdef DEBUG
+        LOG("Ignoring invalid or stale WDL plane %s\n", path.c_str());
+#endif
+        delete plane;
+        return nullptr;
+    }
+    return plane;
+}
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+// perfect_wdl_plane.h
+//
+// Reader for the per-sector 2-bit win/draw/loss planes (.wdl2) written by
+// `tgf mill db-wdl` (perfect_db::wdl_plane::WdlPlane on the Rust side):
+//
+//   0   char[4] magic "SMWD"
+//   4   u8      version (1)
+//   5   u64     hash count (little-endian)
+//   13  u8      bits[(hash count + 3) / 4]
+//
+// Entry i is (bits[i / 4] >> (i % 4 * 2)) & 3 with 0 = loss, 1 = draw,
+// 2 = win, from the point of view of the side to move of the sector. Symmetry
+// redirects are already resolved, so the plane is indexed by Hash::index().
+
+#ifndef PERFECT_WDL_PLANE_H_INCLUDED
+#define PERFECT_WDL_PLANE_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class WdlPlane
+{
+    std::vector<unsigned char> bits;
+    int64_t count {0};
+
+    WdlPlane() { }
+
+public:
+    static const int version = 1;
+
+    // Returns nullptr if the file does not exist or is not a valid plane for
+    // expected_count positions.
+    static WdlPlane *open(const std::string &path, int64_t expected_count);
+
+    int64_t hash_count() const { return count; }
+    size_t bytes() const { return bits.size(); }
+
+    // -1, 0 or 1
+    int wdl_at(int64_t i) const
+    {
+        return ((bits[i >> 2] >> ((i & 3) * 2)) & 3) - 1;
+    }
+};
+
+#endif // PERFECT_WDL_PLANE_H_INCLUDED
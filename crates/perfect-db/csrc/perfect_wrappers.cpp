@@ -5,6 +5,10 @@
 // perfect_wrappers.cpp
 
 #include "perfect_wrappers.h"
+#include "perfect_errors.h"
+#include "perfect_stats.h"
+#include "perfect_trace.h"
+#include "perfect_wdl_plane.h"
 
 int ruleVariant;
 
@@ -15,9 +19,20 @@ namespace {
 std::set<std::pair<int, ::Sector *>> g_loaded_hashes;
 std::map<::Sector *, int> g_loaded_hashes_inv;
 int g_loaded_hash_timestamp = 0;
+int g_hash_cache_capacity = 8;
 
 } // namespace
 
+void Wrappers::set_hash_cache_capacity(int sectors)
+{
+    g_hash_cache_capacity = sectors;
+}
+
+int Wrappers::hash_cache_capacity()
+{
+    return g_hash_cache_capacity;
+}
+
 void Wrappers::reset_hash_cache()
 {
     g_loaded_hashes.clear();
@@ -27,21 +42,30 @@ void Wrappers::reset_hash_cache()
 
 // This manages the lookup tables of the hash function: it keeps them in memory
 // for a few most recently accessed sectors.
-std::pair<int, Wrappers::gui_eval_elem2> Wrappers::WSector::hash(board a)
+void Wrappers::WSector::touch_hash(bool with_evals)
 {
     ::Sector *tmp = s;
 
     if (s->hash == nullptr) {
         // hash object is not present
 
-        if (g_loaded_hashes.size() == 8) {
-            // release one if there are too many
-            ::Sector *to_release = g_loaded_hashes.begin()->second;
+        Stats::add(Stat::hash_misses);
+        auto victim = g_loaded_hashes.begin();
+        while (victim != g_loaded_hashes.end() &&
+               (int)g_loaded_hashes.size() >= g_hash_cache_capacity) {
+            // release one if there are too many (the least recently used
+            // one that no iterator has pinned)
+            ::Sector *to_release = victim->second;
+            if (to_release->pins > 0) {
+                ++victim;
+                continue;
+            }
+            Stats::add(Stat::hash_evictions);
 #ifdef DEBUG
             LOG("Releasing hash: %s\n", to_release->id.to_string().c_str());
 #endif
             to_release->release_hash();
-            g_loaded_hashes.erase(g_loaded_hashes.begin());
+            victim = g_loaded_hashes.erase(victim);
             g_loaded_hashes_inv.erase(to_release);
         }
 
@@ -49,20 +73,32 @@ std::pair<int, Wrappers::gui_eval_elem2> Wrappers::WSector::hash(board a)
 #ifdef DEBUG
         LOG("Loading hash: %s\n", s->id.to_string().c_str());
 #endif
-        s->allocate_hash();
+        s->allocate_hash(with_evals);
     } else {
         // update access time
+        Stats::add(Stat::hash_hits);
         g_loaded_hashes.erase(std::make_pair(g_loaded_hashes_inv[tmp], tmp));
+        if (with_evals && !s->evals_loaded)
+            s->allocate_hash();
     }
     g_loaded_hashes.insert(std::make_pair(g_loaded_hash_timestamp, tmp));
     // s doesn't work here, which is probably a compiler bug!
     g_loaded_hashes_inv[tmp] = g_loaded_hash_timestamp;
 
     g_loaded_hash_timestamp++;
+}
+
+std::pair<int, Wrappers::gui_eval_elem2> Wrappers::WSector::hash(board a)
+{
+    AccessTrace::record(s->id);
+    touch_hash(true);
 
     if (!s->hash) {
-        LOG("Error: hash not initialized for sector %s\n",
-            s->id.to_string().c_str());
+        // allocate_hash set the error, unless it failed to open the file.
+        if (!PerfectErrors::hasError())
+            SET_ERROR_MESSAGE(PerfectErrors::PE_RUNTIME_ERROR,
+                              "Hash not initialized for sector " +
+                                  s->id.to_string());
         return std::make_pair(-1,
                               Wrappers::gui_eval_elem2(eval_elem2(val()), s));
     }
@@ -71,6 +107,49 @@ std::pair<int, Wrappers::gui_eval_elem2> Wrappers::WSector::hash(board a)
     return std::make_pair(e.first, Wrappers::gui_eval_elem2(e.second, s));
 }
 
+bool Wrappers::WSector::wdl(board a, int &out)
+{
+    AccessTrace::record(s->id);
+    touch_hash(false);
+
+    WdlPlane *plane = s->hash ? s->get_wdl_plane() : nullptr;
+    if (!plane)
+        return false;
+
+    out = plane->wdl_at(s->hash->index(a));
+    Stats::add(Stat::wdl_plane_lookups);
+    return true;
+}
+
+bool Wrappers::WSector::canonical_index(board a, int &index, int &op)
+{
+    AccessTrace::record(s->id);
+    touch_hash(false);
+
+    if (!s->hash) {
+        if (!PerfectErrors::hasError())
+            SET_ERROR_MESSAGE(PerfectErrors::PE_RUNTIME_ERROR,
+                              "Hash not initialized for sector " +
+                                  s->id.to_string());
+        return false;
+    }
+
+    index = s->hash->canonical_index(a, op);
+    return true;
+}
+
+void Wrappers::WSector::preload()
+{
+    if (load())
+        s->prefetch();
+}
+
+::Sector *Wrappers::WSector::load()
+{
+    touch_hash(true);
+    return s->hash ? s : nullptr;
+}
+
 void Wrappers::WID::negate_id()
 {
     int t = W;
@@ -34,6 +34,10 @@ extern std::unordered_map<Id, int> sector_sizes;
 
 void reset_hash_cache();
 
+// Number of sectors whose hash tables are kept in memory (default 8).
+void set_hash_cache_capacity(int sectors);
+int hash_cache_capacity();
+
 struct WID
 {
     int W, B, WF, BF;
@@ -95,10 +99,34 @@ public:
     WSector(WID Id)
         : s(new ::Sector(Id.tonat()))
     { }
+    // Wraps an existing sector object.
+    explicit WSector(::Sector *sector)
+        : s(sector)
+    { }
 
     std::pair<int, Wrappers::gui_eval_elem2> hash(board a);
 
+    // Win/draw/loss of a from the sector's .wdl2 plane, without touching the
+    // sector file. Returns false if the sector has no plane.
+    bool wdl(board a, int &out);
+
+    // Hash::canonical_index of a, building the hash tables through the LRU
+    // but not opening the sector file. Returns false, with an error set, if
+    // the tables cannot be built.
+    bool canonical_index(board a, int &index, int &op);
+
+    // Loads the hash tables and evals as a lookup would, and prefetches the
+    // sector file, without counting as an access in the trace.
+    void preload();
+
+    // Loads the hash tables and evals through the LRU, without counting as
+    // an access in the trace. Returns nullptr if the sector cannot be loaded.
+    ::Sector *load();
+
     sec_val sval() { return s->sval; }
+
+private:
+    void touch_hash(bool with_evals);
 };
 
 struct gui_eval_elem2
@@ -126,6 +154,9 @@ public:
         : gui_eval_elem2 {e.key1, e.key2, sec}
     { }
 
+    // key1 and key2 as the sector of the viewpoint stores them.
+    eval_elem2 keys() const { return to_eval_elem2(); }
+
     gui_eval_elem2 undo_negate(WSector *sector)
     {
         auto a = this->to_eval_elem2().corr(
@@ -283,10 +314,6 @@ public:
 class Init
 {
 public:
-    static void init_symmetry_lookup_tables()
-    {
-        ::init_symmetry_lookup_tables();
-    }
     static void init_sec_vals() { ::init_sec_vals(); }
 };
 
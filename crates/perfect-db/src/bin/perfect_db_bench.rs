@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+//! Benchmark executable of the C++ oracle kernels.
+//!
+//! The benchmarks live in `csrc/perfect_bench.cpp` so they can time internals
+//! that are not part of the C API; this binary only forwards the command
+//! line. Example:
+//!
+//! ```text
+//! cargo run --release -p perfect-db --features oracle-bench --bin perfect-db-bench -- \
+//!     --db src/ui/flutter_app/assets/databases --seed 1 --out oracle-bench.json
+//! ```
+//!
+//! `perfect-db-bench replay --db DIR [--games FILE] --cache-sizes 2,4,8`
+//! replays games through the best-move and evaluation entry points and
+//! reports per-phase latency percentiles of cold and warm runs.
+
+use std::ffi::{CString, c_char};
+
+// Links the static C++ library built by this package.
+use perfect_db as _;
+
+unsafe extern "C" {
+    fn pd_bench_main(argc: i32, argv: *mut *mut c_char) -> i32;
+}
+
+fn main() {
+    let args: Vec<CString> = std::env::args()
+        .map(|arg| CString::new(arg).expect("arguments must not contain NUL"))
+        .collect();
+    let mut argv: Vec<*mut c_char> = args.iter().map(|arg| arg.as_ptr().cast_mut()).collect();
+    argv.push(std::ptr::null_mut());
+    // SAFETY: argv holds argc valid NUL-terminated strings followed by a null
+    // pointer, and `args` outlives the call.
+    let code = unsafe { pd_bench_main(args.len() as i32, argv.as_mut_ptr()) };
+    std::process::exit(code);
+}
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+//! Batch retrograde solver of the C++ oracle, for rule sets the shipped
+//! databases do not cover.
+//!
+//! The solver lives in `csrc/perfect_batch.cpp`; this binary only forwards
+//! the command line. Example, Nine Men's Morris without flying:
+//!
+//! ```text
+//! cargo run --release -p perfect-db --features oracle-solve --bin perfect-db-solve -- \
+//!     --out nofly-db --variant std --fly 0 --memory 8192
+//! ```
+//!
+//! `--diagonal` adds the Morabaraba diagonals, `--remove-from-mills` allows
+//! removing stones from mills, and `--sector W,B,WF,BF` limits the run to the
+//! given sectors and the ones they depend on.
+
+use std::ffi::{CString, c_char};
+
+// Links the static C++ library built by this package.
+use perfect_db as _;
+
+unsafe extern "C" {
+    fn pd_solve_main(argc: i32, argv: *mut *mut c_char) -> i32;
+}
+
+fn main() {
+    let args: Vec<CString> = std::env::args()
+        .map(|arg| CString::new(arg).expect("arguments must not contain NUL"))
+        .collect();
+    let mut argv: Vec<*mut c_char> = args.iter().map(|arg| arg.as_ptr().cast_mut()).collect();
+    argv.push(std::ptr::null_mut());
+    // SAFETY: argv holds argc valid NUL-terminated strings followed by a null
+    // pointer, and `args` outlives the call.
+    let code = unsafe { pd_solve_main(args.len() as i32, argv.as_mut_ptr()) };
+    std::process::exit(code);
+}
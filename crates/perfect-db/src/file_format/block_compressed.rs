@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
+
+//! Seekable block-compressed sector container (`.sec2z`).
+//!
+//! The bytes of a `.sec2` file are split into fixed-size blocks that are
+//! zstd-compressed independently, followed by an index of block offsets, so a
+//! reader can serve a random `eval_at` probe by decompressing one block
+//! instead of the whole sector. The C++ oracle reads this format in
+//! `csrc/perfect_compressed.cpp`; both sides must agree on the layout:
+//!
+//! ```text
+//! 0   [u8; 4]  magic "SMZ2"
+//! 4   u32      version (1)
+//! 8   u32      block size (uncompressed bytes per block, last may be short)
+//! 12  u32      block count
+//! 16  u64      size of the original .sec2 file
+//! 24  u64      offsets[block count + 1] of the compressed blocks
+//! ```
+//!
+//! All integers are little-endian; `offsets[block count]` is the file length.
+
+use super::{ParseError, ParseResult};
+
+pub const BLOCK_COMPRESSED_MAGIC: [u8; 4] = *b"SMZ2";
+pub const BLOCK_COMPRESSED_VERSION: u32 = 1;
+/// Large enough for zstd to find the repetition in eval arrays, small enough
+/// that a single probe decompresses well under a millisecond.
+pub const DEFAULT_BLOCK_SIZE: u32 = 64 * 1024;
+
+const FIXED_HEADER_LEN: usize = 24;
+
+/// Compress a whole `.sec2` buffer into the `.sec2z` container.
+pub fn compress_sector(raw: &[u8], block_size: u32, zstd_level: i32) -> std::io::Result<Vec<u8>> {
+    assert!(block_size > 0, "block size must be positive");
+    let block_count = raw.len().div_ceil(block_size as usize);
+    let block_count_u32 = u32::try_from(block_count).map_err(|_| {
+        std::io::Error::new(
+            std::io::ErrorKind::InvalidInput,
+            "sector has too many blocks for the .sec2z index",
+        )
+    })?;
+
+    let index_len = (block_count + 1) * 8;
+    let mut blocks = Vec::with_capacity(raw.len() / 4);
+    let mut offsets = Vec::with_capacity(block_count + 1);
+    let data_start = (FIXED_HEADER_LEN + index_len) as u64;
+    for block in raw.chunks(block_size as usize) {
+        offsets.push(data_start + blocks.len() as u64);
+        blocks.extend_from_slice(&zstd::bulk::compress(block, zstd_level)?);
+    }
+    offsets.push(data_start + blocks.len() as u64);
+
+    let mut out = Vec::with_capacity(FIXED_HEADER_LEN + index_len + blocks.len());
+    out.extend_from_slice(&BLOCK_COMPRESSED_MAGIC);
+    out.extend_from_slice(&BLOCK_COMPRESSED_VERSION.to_le_bytes());
+    out.extend_from_slice(&block_size.to_le_bytes());
+    out.extend_from_slice(&block_count_u32.to_le_bytes());
+    out.extend_from_slice(&(raw.len() as u64).to_le_bytes());
+    for offset in offsets {
+        out.extend_from_slice(&offset.to_le_bytes());
+    }
+    out.extend_from_slice(&blocks);
+    Ok(out)
+}
+
+/// A parsed `.sec2z` buffer, decompressing blocks on request.
+#[derive(Clone, Debug)]
+pub struct BlockCompressedSector<'a> {
+    bytes: &'a [u8],
+    block_size: u32,
+    raw_len: u64,
+    offsets: Vec<u64>,
+}
+
+impl<'a> BlockCompressedSector<'a> {
+    pub fn parse(bytes: &'a [u8]) -> ParseResult<Self> {
+        if bytes.len() < FIXED_HEADER_LEN || bytes[0..4] != BLOCK_COMPRESSED_MAGIC {
+            return Err(ParseError::InvalidHeader {
+                message: "not a block-compressed sector file".to_owned(),
+            });
+        }
+        let u32_at = |offset: usize| {
+            u32::from_le_bytes(bytes[offset..offset + 4].try_into().expect("4 bytes"))
+        };
+        let version = u32_at(4);
+        if version != BLOCK_COMPRESSED_VERSION {
+            return Err(ParseError::InvalidHeader {
+                message: format!("unsupported block-compressed sector version {version}"),
+            });
+        }
+        let block_size = u32_at(8);
+        let block_count = u32_at(12) as usize;
+        let raw_len = u64::from_le_bytes(bytes[16..24].try_into().expect("8 bytes"));
+        if block_size == 0 || (block_count as u64) * u64::from(block_size) < raw_len {
+            return Err(ParseError::InvalidHeader {
+                message: "block size and count do not cover the sector".to_owned(),
+            });
+        }
+
+        let index_end = FIXED_HEADER_LEN + (block_count + 1) * 8;
+        if bytes.len() < index_end {
+            return Err(ParseError::InvalidLength {
+                expected: index_end,
+                actual: bytes.len(),
+            });
+        }
+        let offsets: Vec<u64> = bytes[FIXED_HEADER_LEN..index_end]
+            .chunks_exact(8)
+            .map(|chunk| u64::from_le_bytes(chunk.try_into().expect("8 bytes")))
+            .collect();
+        let ordered = offsets.windows(2).all(|pair| pair[0] <= pair[1]);
+        let last = *offsets.last().expect("index has block_count + 1 entries");
+        if !ordered || offsets[0] < index_end as u64 || last != bytes.len() as u64 {
+            return Err(ParseError::InvalidHeader {
+                message: "corrupt block offset index".to_owned(),
+            });
+        }
+
+        Ok(Self {
+            bytes,
+            block_size,
+            raw_len,
+            offsets,
+        })
+    }
+
+    pub fn block_size(&self) -> u32 {
+        self.block_size
+    }
+
+    pub fn block_count(&self) -> usize {
+        self.offsets.len() - 1
+    }
+
+    /// Size of the original `.sec2` file.
+    pub fn raw_len(&self) -> u64 {
+        self.raw_len
+    }
+
+    pub fn decompress_block(&self, block: usize) -> ParseResult<Vec<u8>> {
+        if block >= self.block_count() {
+            return Err(ParseError::OutOfBounds {
+                index: block,
+                len: self.block_count(),
+            });
+        }
+        let start = self.offsets[block] as usize;
+        let end = self.offsets[block + 1] as usize;
+        let expected = if block + 1 == self.block_count() {
+            (self.raw_len - u64::from(self.block_size) * block as u64) as usize
+        } else {
+            self.block_size as usize
+        };
+        let data = zstd::bulk::decompress(&self.bytes[start..end], expected).map_err(|err| {
+            ParseError::InvalidHeader {
+                message: format!("block {block} does not decompress: {err}"),
+            }
+        })?;
+        if data.len() != expected {
+            return Err(ParseError::InvalidLength {
+                expected,
+                actual: data.len(),
+            });
+        }
+        Ok(data)
+    }
+
+    /// Reconstruct the original `.sec2` bytes.
+    pub fn decompress_all(&self) -> ParseResult<Vec<u8>> {
+        let mut out = Vec::with_capacity(self.raw_len as usize);
+        for block in 0..self.block_count() {
+            out.extend_from_slice(&self.decompress_block(block)?);
+        }
+        Ok(out)
+    }
+}
@@ -7,13 +7,18 @@
 //! can feed it bytes read from disk, while a future Web implementation can feed
 //! it bytes loaded from Flutter assets or fetched over HTTP.
 
+mod block_compressed;
 mod sector;
 mod secval;
 
+pub use block_compressed::{
+    BLOCK_COMPRESSED_MAGIC, BLOCK_COMPRESSED_VERSION, BlockCompressedSector, DEFAULT_BLOCK_SIZE,
+    compress_sector,
+};
 pub use sector::{
     RawEval, RawEvalKind, SECTOR_FORMAT_VERSION, SECTOR_HEADER_SIZE, SectorFile, SectorHeader,
 };
-pub use secval::{SecValTable, SectorId};
+pub use secval::{SECVAL_BINARY_MAGIC, SECVAL_BINARY_VERSION, SecValTable, SectorId};
 
 use std::fmt;
 
@@ -120,6 +125,21 @@ mod tests {
         assert_eq!(table.value(SectorId::new(1, 2, 9, 8)), Some(-386));
     }
 
+    #[test]
+    fn secval_binary_sidecar_round_trips() {
+        for name in ["std.secval", "mora.secval", "lask.secval"] {
+            let text = std::fs::read_to_string(asset_path(name)).unwrap();
+            let table = SecValTable::parse(&text).unwrap();
+            let bytes = table.to_binary();
+
+            assert_eq!(bytes[0..4], SECVAL_BINARY_MAGIC);
+            assert_eq!(bytes.len(), 13 + 6 * table.len());
+            assert_eq!(SecValTable::parse_binary(&bytes).unwrap(), table);
+
+            assert!(SecValTable::parse_binary(&bytes[..bytes.len() - 1]).is_err());
+        }
+    }
+
     #[test]
     fn parses_empty_board_sector_asset() {
         let bytes = std::fs::read(asset_path("std_0_0_9_9.sec2")).unwrap();
@@ -160,6 +180,24 @@ mod tests {
         assert_eq!(sector.em_set_len(), 0);
     }
 
+    #[test]
+    fn block_compressed_sector_round_trips() {
+        let raw = std::fs::read(asset_path("std_2_2_7_7.sec2")).unwrap();
+        // A small block size so the asset spans several blocks with a short
+        // last one.
+        let packed = compress_sector(&raw, 4096, 3).unwrap();
+        let sector = BlockCompressedSector::parse(&packed).unwrap();
+
+        assert_eq!(sector.raw_len(), raw.len() as u64);
+        assert_eq!(sector.block_count(), raw.len().div_ceil(4096));
+        assert_eq!(sector.decompress_block(1).unwrap(), raw[4096..8192]);
+        assert_eq!(sector.decompress_all().unwrap(), raw);
+
+        let mut truncated = packed.clone();
+        truncated.pop();
+        assert!(BlockCompressedSector::parse(&truncated).is_err());
+    }
+
     #[test]
     fn parses_single_black_stone_sector_asset() {
         let bytes = std::fs::read(asset_path("std_0_1_9_8.sec2")).unwrap();
@@ -1,10 +1,31 @@
 // SPDX-License-Identifier: AGPL-3.0-or-later
 // Copyright (C) 2019-2026 The Sanmill developers (see AUTHORS file)
 
+//! Sector values (`<variant>.secval`) and their binary sidecar.
+//!
+//! The C++ oracle loads `<variant>.secvalb` with a single read when it is
+//! present and falls back to the text file otherwise
+//! (`csrc/perfect_sec_val.cpp`). Layout, all integers little-endian:
+//!
+//! ```text
+//! 0   [u8; 4]  magic "SMSV"
+//! 4   u8       version (1)
+//! 5   i16      virt_loss_val
+//! 7   i16      virt_win_val
+//! 9   u32      record count
+//! 13  records  {u8 W, u8 B, u8 WF, u8 BF, i16 value}
+//! ```
+
 use std::collections::BTreeMap;
 
 use super::{ParseError, ParseResult};
 
+pub const SECVAL_BINARY_MAGIC: [u8; 4] = *b"SMSV";
+pub const SECVAL_BINARY_VERSION: u8 = 1;
+
+const SECVAL_BINARY_HEADER_LEN: usize = 13;
+const SECVAL_BINARY_RECORD_LEN: usize = 6;
+
 #[derive(Clone, Copy, Debug, PartialEq, Eq, PartialOrd, Ord, Hash)]
 pub struct SectorId {
     pub white_on_board: u8,
@@ -143,6 +164,85 @@ impl SecValTable {
     pub fn sector_ids(&self) -> impl Iterator<Item = SectorId> + '_ {
         self.values.keys().copied()
     }
+
+    /// Encode the table as a `.secvalb` sidecar.
+    pub fn to_binary(&self) -> Vec<u8> {
+        let count = u32::try_from(self.values.len()).expect("sector count fits u32");
+        let mut out = Vec::with_capacity(
+            SECVAL_BINARY_HEADER_LEN + self.values.len() * SECVAL_BINARY_RECORD_LEN,
+        );
+        out.extend_from_slice(&SECVAL_BINARY_MAGIC);
+        out.push(SECVAL_BINARY_VERSION);
+        out.extend_from_slice(&self.virt_loss_val.to_le_bytes());
+        out.extend_from_slice(&self.virt_win_val.to_le_bytes());
+        out.extend_from_slice(&count.to_le_bytes());
+        for (id, value) in &self.values {
+            out.extend_from_slice(&[
+                id.white_on_board,
+                id.black_on_board,
+                id.white_in_hand,
+                id.black_in_hand,
+            ]);
+            out.extend_from_slice(&value.to_le_bytes());
+        }
+        out
+    }
+
+    /// Decode a `.secvalb` sidecar written by [`Self::to_binary`].
+    pub fn parse_binary(bytes: &[u8]) -> ParseResult<Self> {
+        if bytes.len() < SECVAL_BINARY_HEADER_LEN
+            || bytes[0..4] != SECVAL_BINARY_MAGIC
+            || bytes[4] != SECVAL_BINARY_VERSION
+        {
+            return Err(ParseError::InvalidHeader {
+                message: "not a version 1 .secvalb file".to_owned(),
+            });
+        }
+        let virt_loss_val = i16::from_le_bytes([bytes[5], bytes[6]]);
+        let virt_win_val = i16::from_le_bytes([bytes[7], bytes[8]]);
+        if virt_win_val != -virt_loss_val {
+            return Err(ParseError::InvalidHeader {
+                message: "Perfect DB virtual win/loss values must be symmetric".to_owned(),
+            });
+        }
+        let count = u32::from_le_bytes(bytes[9..13].try_into().expect("4 bytes")) as usize;
+        let expected = SECVAL_BINARY_HEADER_LEN + count * SECVAL_BINARY_RECORD_LEN;
+        if bytes.len() != expected {
+            return Err(ParseError::InvalidLength {
+                expected,
+                actual: bytes.len(),
+            });
+        }
+
+        let mut values = BTreeMap::new();
+        for (index, record) in bytes[SECVAL_BINARY_HEADER_LEN..]
+            .chunks_exact(SECVAL_BINARY_RECORD_LEN)
+            .enumerate()
+        {
+            if record[..4].iter().any(|&count| count > 12) {
+                return Err(ParseError::InvalidLine {
+                    line: index + 1,
+                    message: "Perfect DB sector piece counts must be in 0..=12".to_owned(),
+                });
+            }
+            let id = SectorId::new(record[0], record[1], record[2], record[3]);
+            if values
+                .insert(id, i16::from_le_bytes([record[4], record[5]]))
+                .is_some()
+            {
+                return Err(ParseError::InvalidLine {
+                    line: index + 1,
+                    message: format!("duplicate Perfect DB sector id: {id:?}"),
+                });
+            }
+        }
+
+        Ok(Self {
+            virt_loss_val,
+            virt_win_val,
+            values,
+        })
+    }
 }
 
 fn next_line<'a>(
@@ -285,7 +285,9 @@ impl<P: DatabaseProvider> WdlPlaneCache<P> {
             .or_insert_with(|| PerfectHasher::new(id.white_on_board, id.black_on_board))
     }
 
-    fn cache_file_name(&self, id: SectorId) -> String {
+    /// `<variant>_W_B_WF_BF.wdl2`, the name the C++ oracle looks for next to
+    /// the sector file (`pd_evaluate_wdl`).
+    pub fn plane_file_name(&self, id: SectorId) -> String {
         format!(
             "{}_{}_{}_{}_{}.wdl2",
             self.variant.name,
@@ -321,9 +323,15 @@ impl<P: DatabaseProvider> WdlPlaneCache<P> {
             .expect("plane must be present after insertion"))
     }
 
+    /// Build (or load from `cache_dir`) the plane of `id` without keeping it
+    /// in the LRU, for offline generators that write planes out.
+    pub fn build_plane(&mut self, id: SectorId) -> Result<WdlPlane, DatabaseError> {
+        self.load_or_build_plane(id)
+    }
+
     fn load_or_build_plane(&mut self, id: SectorId) -> Result<WdlPlane, DatabaseError> {
         if let Some(dir) = &self.options.cache_dir {
-            let path = dir.join(self.cache_file_name(id));
+            let path = dir.join(self.plane_file_name(id));
             if let Ok(bytes) = std::fs::read(&path)
                 && let Ok(plane) = WdlPlane::from_bytes(&bytes)
             {
@@ -344,7 +352,7 @@ impl<P: DatabaseProvider> WdlPlaneCache<P> {
 
         if let Some(dir) = &self.options.cache_dir {
             let _ = std::fs::create_dir_all(dir);
-            let _ = std::fs::write(dir.join(self.cache_file_name(id)), plane.to_bytes());
+            let _ = std::fs::write(dir.join(self.plane_file_name(id)), plane.to_bytes());
         }
         Ok(plane)
     }
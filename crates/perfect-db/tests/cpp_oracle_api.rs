@@ -0,0 +1,781 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+//! Tests of the C API of the C++ oracle (csrc/perfect_c_api.h) that the
+//! Rust wrappers do not cover.
+
+#![cfg(feature = "cpp-oracle")]
+
+// Links the oracle built by build.rs.
+use perfect_db as _;
+
+use std::ffi::CString;
+use std::os::raw::c_char;
+use std::path::{Path, PathBuf};
+use std::sync::{LazyLock, Mutex, MutexGuard};
+
+unsafe extern "C" {
+    fn pd_init_std(db_path: *const c_char) -> i32;
+    fn pd_deinit();
+    fn pd_evaluate(
+        white_bits: i32,
+        black_bits: i32,
+        white_stones_to_place: i32,
+        black_stones_to_place: i32,
+        player_to_move: i32,
+        only_stone_taking: i32,
+        out_wdl: *mut i32,
+        out_steps: *mut i32,
+    ) -> i32;
+    fn pd_set_hash_index_mode(mode: i32) -> i32;
+    fn pd_submit(query: *const Query, tag: i64) -> i32;
+    fn pd_sample(seed: u64, n: i32, filter: *const std::ffi::c_void, out: *mut SampleEntry) -> i32;
+    fn pd_set_sector_solving(
+        on_lookup: i32,
+        max_entries: i64,
+        threads: i32,
+        write_files: i32,
+    ) -> i32;
+    fn pd_set_search_fallback(enabled: i32, max_nodes: i64, max_ms: i32);
+    fn pd_build_opening_table(plies: i32, path: *const c_char) -> i64;
+    fn pd_principal_variation(
+        query: *const Query,
+        max_plies: i32,
+        out_moves: *mut [c_char; 16],
+        out_evals: *mut PvEval,
+    ) -> i32;
+    fn pd_open_sector(w: i32, b: i32, wf: i32, bf: i32) -> i32;
+    fn pd_close_sector(handle: i32) -> i32;
+    fn pd_sector_next(
+        handle: i32,
+        white_bits: *mut i32,
+        black_bits: *mut i32,
+        wdl: *mut i32,
+        steps: *mut i32,
+    ) -> i32;
+    fn pd_canonical_index(positions: *const Query, count: i32, out: *mut Canonical) -> i32;
+    fn pd_verify_database(
+        threads: i32,
+        retrograde: i32,
+        report: *mut VerifyReport,
+        issues: *mut VerifyIssue,
+        max_issues: i32,
+    ) -> i32;
+    fn pd_verify_sector(
+        w: i32,
+        b: i32,
+        wf: i32,
+        bf: i32,
+        threads: i32,
+        retrograde: i32,
+        report: *mut VerifyReport,
+        issues: *mut VerifyIssue,
+        max_issues: i32,
+    ) -> i32;
+    fn pd_reset_stats() -> i32;
+    fn pd_get_stats(out: *mut Stats) -> i32;
+    fn pd_best_move_exact(
+        white_bits: i32,
+        black_bits: i32,
+        white_stones_to_place: i32,
+        black_stones_to_place: i32,
+        player_to_move: i32,
+        only_stone_taking: i32,
+        out_buf: *mut c_char,
+        out_buf_len: i32,
+        out_exact: *mut i32,
+    ) -> i32;
+}
+
+// pd_query
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct Query {
+    kind: i32,
+    white_bits: i32,
+    black_bits: i32,
+    white_stones_to_place: i32,
+    black_stones_to_place: i32,
+    player_to_move: i32,
+    only_stone_taking: i32,
+}
+
+// pd_sample_entry
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+struct SampleEntry {
+    white_bits: i32,
+    black_bits: i32,
+    white_stones_to_place: i32,
+    black_stones_to_place: i32,
+    w: i32,
+    b: i32,
+    wf: i32,
+    bf: i32,
+    wdl: i32,
+    steps: i32,
+}
+
+// pd_pv_eval
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default, PartialEq)]
+struct PvEval {
+    wdl: i32,
+    steps: i32,
+}
+
+// pd_canonical
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default, PartialEq)]
+struct Canonical {
+    w: i32,
+    b: i32,
+    wf: i32,
+    bf: i32,
+    index: i32,
+    op: i32,
+}
+
+// pd_verify_report
+#[repr(C)]
+#[derive(Default)]
+struct VerifyReport {
+    sectors_checked: i64,
+    sectors_skipped: i64,
+    positions_checked: i64,
+    mismatches: i64,
+}
+
+// pd_verify_issue
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct VerifyIssue {
+    w: i32,
+    b: i32,
+    wf: i32,
+    bf: i32,
+    kind: i32,
+    index: i64,
+    white_bits: i32,
+    black_bits: i32,
+    message: [c_char; 96],
+}
+
+// pd_stats
+#[repr(C)]
+#[derive(Default)]
+struct Stats {
+    evaluations: i64,
+    best_move_calls: i64,
+    moves_generated: i64,
+    hash_hits: i64,
+    hash_misses: i64,
+    hash_evictions: i64,
+    hash_builds: i64,
+    hash_build_ns: i64,
+    bytes_read: i64,
+    em_set_lookups: i64,
+    sym_redirects: i64,
+    wdl_plane_lookups: i64,
+    pd_mutex_wait_ns: i64,
+    eval_lock_wait_ns: i64,
+    loaded_sectors: i32,
+    resident_bytes: i64,
+}
+
+fn db_path() -> &'static str {
+    concat!(
+        env!("CARGO_MANIFEST_DIR"),
+        "/../../src/ui/flutter_app/assets/databases"
+    )
+}
+
+// The oracle is process-global.
+fn oracle_lock() -> MutexGuard<'static, ()> {
+    static LOCK: LazyLock<Mutex<()>> = LazyLock::new(|| Mutex::new(()));
+    LOCK.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+fn init_std(dir: &Path) -> bool {
+    let path = CString::new(dir.to_str().expect("UTF-8 path")).expect("no NUL in path");
+    unsafe { pd_init_std(path.as_ptr()) != 0 }
+}
+
+fn evaluate(
+    white: i32,
+    black: i32,
+    white_free: i32,
+    black_free: i32,
+    side: i32,
+) -> Option<(i32, i32)> {
+    let (mut wdl, mut steps) = (0, 0);
+    let ok = unsafe {
+        pd_evaluate(
+            white, black, white_free, black_free, side, 0, &mut wdl, &mut steps,
+        )
+    };
+    (ok != 0).then_some((wdl, steps))
+}
+
+// A fresh directory holding the sector values of the bundled database.
+fn scratch_database(name: &str) -> PathBuf {
+    let dir = std::env::temp_dir().join(format!("perfect-db-{name}-{}", std::process::id()));
+    let _ = std::fs::remove_dir_all(&dir);
+    std::fs::create_dir_all(&dir).expect("create scratch database directory");
+    std::fs::copy(
+        Path::new(db_path()).join("std.secval"),
+        dir.join("std.secval"),
+    )
+    .expect("copy std.secval");
+    dir
+}
+
+// A .sec2z header (see csrc/perfect_compressed.h) with the given block count
+// and offsets, followed by `tail` bytes of block data.
+fn sec2z(block_count: u32, raw_size: u64, offsets: &[u64], tail: usize) -> Vec<u8> {
+    let mut out = b"SMZ2".to_vec();
+    out.extend_from_slice(&1u32.to_le_bytes());
+    out.extend_from_slice(&4096u32.to_le_bytes());
+    out.extend_from_slice(&block_count.to_le_bytes());
+    out.extend_from_slice(&raw_size.to_le_bytes());
+    for offset in offsets {
+        out.extend_from_slice(&offset.to_le_bytes());
+    }
+    out.resize(out.len() + tail, 0);
+    out
+}
+
+// A zstd frame holding data in raw (uncompressed) blocks.
+fn zstd_stored(data: &[u8]) -> Vec<u8> {
+    let mut out = 0xFD2F_B528u32.to_le_bytes().to_vec();
+    // Single segment, 4-byte content size.
+    out.push(0xa0);
+    out.extend_from_slice(&(data.len() as u32).to_le_bytes());
+    let chunks: Vec<&[u8]> = data.chunks(128 * 1024).collect();
+    for (i, chunk) in chunks.iter().enumerate() {
+        let last = (i + 1 == chunks.len()) as u32;
+        let header = last | ((chunk.len() as u32) << 3);
+        out.extend_from_slice(&header.to_le_bytes()[..3]);
+        out.extend_from_slice(chunk);
+    }
+    out
+}
+
+// A .sec2z container of a whole .sec2 file.
+fn sec2z_of(raw: &[u8]) -> Vec<u8> {
+    let blocks: Vec<Vec<u8>> = raw.chunks(4096).map(zstd_stored).collect();
+    let mut offsets = vec![24 + 8 * (blocks.len() as u64 + 1)];
+    for block in &blocks {
+        offsets.push(offsets.last().unwrap() + block.len() as u64);
+    }
+    let mut out = sec2z(blocks.len() as u32, raw.len() as u64, &offsets, 0);
+    for block in &blocks {
+        out.extend_from_slice(block);
+    }
+    out
+}
+
+// The offset of the em_set count of a .sec2 file, which ends with the count
+// and that many 8-byte entries.
+fn em_set_count_offset(raw: &[u8]) -> usize {
+    (0..raw.len() / 8)
+        .map(|k| raw.len() - 4 - 8 * k)
+        .find(|&pos| {
+            i32::from_le_bytes(raw[pos..pos + 4].try_into().unwrap()) as usize
+                == (raw.len() - 4 - pos) / 8
+        })
+        .expect("em_set count")
+}
+
+#[test]
+fn corrupt_compressed_sector_headers_are_rejected() {
+    let _guard = oracle_lock();
+    let index_end = 24 + 3 * 8;
+    let cases: [(&str, Vec<u8>); 4] = [
+        // block_count + 1 overflows 32 bits.
+        ("block count overflow", sec2z(u32::MAX, 4096, &[], 64)),
+        (
+            "offset inside the header",
+            sec2z(2, 8192, &[8, index_end + 10, index_end + 20], 20),
+        ),
+        (
+            "offsets out of order",
+            sec2z(2, 8192, &[index_end, index_end + 20, index_end + 10], 20),
+        ),
+        (
+            "offset past the end of the file",
+            sec2z(2, 8192, &[index_end, index_end + 10, index_end + 4000], 20),
+        ),
+    ];
+    for (name, bytes) in cases {
+        let dir = scratch_database("corrupt-sec2z");
+        std::fs::write(dir.join("std_3_3_0_0.sec2z"), bytes).expect("write sector");
+        assert!(init_std(&dir), "{name}: init must only list the sectors");
+        // A position of std_3_3_0_0: three stones each, none to place.
+        assert_eq!(
+            evaluate(0x7, 0x700, 0, 0, 0),
+            None,
+            "{name} must be rejected"
+        );
+        unsafe { pd_deinit() };
+        let _ = std::fs::remove_dir_all(&dir);
+    }
+}
+
+#[test]
+fn corrupt_compressed_em_set_size_is_rejected() {
+    let _guard = oracle_lock();
+    let dir = scratch_database("corrupt-em-set");
+    let mut raw =
+        std::fs::read(Path::new(db_path()).join("std_1_1_8_8.sec2")).expect("read sector");
+    let pos = em_set_count_offset(&raw);
+
+    // The intact container reads like the .sec2 file.
+    std::fs::write(dir.join("std_1_1_8_8.sec2z"), sec2z_of(&raw)).expect("write sector");
+    assert!(init_std(&dir));
+    let expected = evaluate(0x1, 0x100, 8, 8, 0);
+    unsafe { pd_deinit() };
+    assert!(expected.is_some());
+
+    // A count of entries far past the end of the sector.
+    raw[pos..pos + 4].copy_from_slice(&i32::MAX.to_le_bytes());
+    std::fs::write(dir.join("std_1_1_8_8.sec2z"), sec2z_of(&raw)).expect("write sector");
+    assert!(init_std(&dir));
+    assert_eq!(evaluate(0x1, 0x100, 8, 8, 0), None);
+    unsafe { pd_deinit() };
+    let _ = std::fs::remove_dir_all(&dir);
+}
+
+#[test]
+fn out_of_range_text_sector_values_are_rejected() {
+    let _guard = oracle_lock();
+    let dir = scratch_database("bad-secval");
+    let text = std::fs::read_to_string(dir.join("std.secval")).expect("read std.secval");
+    let bad = text.replacen("\n0 1 3 2 ", "\n0 1 3 99 ", 1);
+    assert_ne!(bad, text, "the first record of std.secval moved");
+    std::fs::write(dir.join("std.secval"), bad).expect("write std.secval");
+    if init_std(&dir) {
+        assert_eq!(evaluate(0x7, 0x700, 0, 0, 0), None);
+    }
+    unsafe { pd_deinit() };
+    let _ = std::fs::remove_dir_all(&dir);
+}
+
+// Evaluates a sampled position (or a symmetric image of it): in the
+// placement phase of the standard game the side to move has as many stones
+// left as the other one, or one more if it is black.
+fn evaluate_sample(e: &SampleEntry, white: i32, black: i32) -> Option<(i32, i32)> {
+    if e.white_stones_to_place > e.black_stones_to_place {
+        evaluate(
+            black,
+            white,
+            e.black_stones_to_place,
+            e.white_stones_to_place,
+            1,
+        )
+    } else {
+        evaluate(
+            white,
+            black,
+            e.white_stones_to_place,
+            e.black_stones_to_place,
+            0,
+        )
+    }
+}
+
+// Rotates the board by 90 degrees: every ring of 8 squares turns by 2.
+fn rotate(bits: i32) -> i32 {
+    (0..3).fold(0, |out, ring| {
+        let r = (bits >> (8 * ring)) & 0xff;
+        out | ((((r << 2) | (r >> 6)) & 0xff) << (8 * ring))
+    })
+}
+
+// Mirrors the board: square i of every ring goes to 8 - i.
+fn mirror(bits: i32) -> i32 {
+    (0..24)
+        .filter(|&sq| bits & (1 << sq) != 0)
+        .fold(0, |out, sq| {
+            let (ring, i) = (sq / 8, sq % 8);
+            out | (1 << (8 * ring + (8 - i) % 8))
+        })
+}
+
+// Swaps the inner and the outer ring.
+fn swap_rings(bits: i32) -> i32 {
+    ((bits & 0xff) << 16) | (bits & 0xff00) | ((bits >> 16) & 0xff)
+}
+
+// The 16 symmetric images of a board, the board itself included.
+fn images(bits: i32) -> Vec<i32> {
+    let mut out = Vec::new();
+    for swapped in [bits, swap_rings(bits)] {
+        for mirrored in [swapped, mirror(swapped)] {
+            let mut b = mirrored;
+            for _ in 0..4 {
+                out.push(b);
+                b = rotate(b);
+            }
+        }
+    }
+    out
+}
+
+#[test]
+fn hash_index_modes_agree() {
+    let _guard = oracle_lock();
+    let dir = PathBuf::from(db_path());
+    let mut samples = vec![SampleEntry::default(); 5000];
+    assert!(init_std(&dir));
+    let n = unsafe {
+        pd_sample(
+            7,
+            samples.len() as i32,
+            std::ptr::null(),
+            samples.as_mut_ptr(),
+        )
+    };
+    assert!(n > 0, "pd_sample failed");
+    samples.truncate(n as usize);
+
+    // The sampled entries, and rotations of them that the sectors redirect.
+    let evaluate_all = || -> Vec<Option<(i32, i32)>> {
+        samples
+            .iter()
+            .flat_map(|e| {
+                [
+                    (e.white_bits, e.black_bits),
+                    (rotate(e.white_bits), rotate(e.black_bits)),
+                ]
+                .map(|(white, black)| evaluate_sample(e, white, black))
+            })
+            .collect()
+    };
+    let tables = evaluate_all();
+    unsafe { pd_deinit() };
+
+    assert_eq!(unsafe { pd_set_hash_index_mode(1) }, 1);
+    assert!(init_std(&dir));
+    let compact = evaluate_all();
+    unsafe {
+        pd_deinit();
+        pd_set_hash_index_mode(0);
+    }
+
+    assert!(tables.iter().all(Option::is_some));
+    assert!(tables == compact, "the index modes disagree");
+}
+
+#[test]
+fn exit_with_queued_queries() {
+    // The child submits queries and exits without pd_deinit.
+    if std::env::var_os("PD_EXIT_WITH_QUEUED_QUERIES").is_some() {
+        assert!(init_std(Path::new(db_path())));
+        for tag in 0..64 {
+            let query = Query {
+                kind: 0,
+                white_bits: 0x7,
+                black_bits: 0x700,
+                white_stones_to_place: 0,
+                black_stones_to_place: 0,
+                player_to_move: 0,
+                only_stone_taking: 0,
+            };
+            assert_eq!(unsafe { pd_submit(&query, tag) }, 1);
+        }
+        std::process::exit(0);
+    }
+
+    let status = std::process::Command::new(std::env::current_exe().expect("test binary"))
+        .args(["exit_with_queued_queries", "--exact", "--test-threads=1"])
+        .env("PD_EXIT_WITH_QUEUED_QUERIES", "1")
+        .status()
+        .expect("run the test binary");
+    assert!(status.success(), "exit with workers running: {status}");
+}
+
+// The move token and the exact flag of pd_best_move_exact.
+fn best_move_exact(
+    white: i32,
+    black: i32,
+    white_free: i32,
+    black_free: i32,
+) -> Option<(String, i32)> {
+    let mut buf = [0 as c_char; 32];
+    let mut exact = -1;
+    let ok = unsafe {
+        pd_best_move_exact(
+            white,
+            black,
+            white_free,
+            black_free,
+            0,
+            0,
+            buf.as_mut_ptr(),
+            buf.len() as i32,
+            &mut exact,
+        )
+    };
+    let token = unsafe { std::ffi::CStr::from_ptr(buf.as_ptr()) };
+    (ok != 0).then(|| (token.to_string_lossy().into_owned(), exact))
+}
+
+#[test]
+fn best_move_of_a_missing_sector() {
+    let _guard = oracle_lock();
+    assert!(init_std(Path::new(db_path())));
+    // std_4_4_0_0 is not bundled, and too large for the solver here.
+    let (white, black) = (0x55, 0x5500);
+
+    assert_eq!(best_move_exact(white, black, 0, 0), None);
+    assert_eq!(unsafe { pd_set_sector_solving(1, 1000, 1, 0) }, 1);
+    assert_eq!(best_move_exact(white, black, 0, 0), None);
+
+    // The search reaches no present sector on every line within its budget.
+    unsafe { pd_set_search_fallback(1, 1000, 0) };
+    let searched = best_move_exact(white, black, 0, 0);
+    unsafe {
+        pd_set_search_fallback(0, 1 << 20, 1000);
+        pd_set_sector_solving(0, 1 << 24, 0, 0);
+        pd_deinit();
+    }
+    let (token, exact) = searched.expect("a move from the search");
+    assert!(!token.is_empty());
+    assert_eq!(exact, 0);
+}
+
+#[test]
+fn opening_table_at_a_path_is_consulted() {
+    let _guard = oracle_lock();
+    let dir = scratch_database("opening");
+    let table = CString::new(dir.join("std.opening").to_str().expect("UTF-8 path"))
+        .expect("no NUL in path");
+    assert!(init_std(Path::new(db_path())));
+    let entries = unsafe { pd_build_opening_table(2, table.as_ptr()) };
+
+    // The empty board, answered from the table without an evaluation.
+    let mut stats = Stats::default();
+    unsafe { pd_reset_stats() };
+    let reply = best_move_exact(0, 0, 9, 9);
+    unsafe {
+        pd_get_stats(&mut stats);
+        pd_deinit();
+    }
+    let _ = std::fs::remove_dir_all(&dir);
+
+    assert!(entries > 0, "pd_build_opening_table failed");
+    assert_eq!(reply.map(|(_, exact)| exact), Some(1));
+    assert_eq!(stats.best_move_calls, 1);
+    assert_eq!(stats.evaluations, 0, "the table was not consulted");
+}
+
+// A directory with a copy of every standard sector of the bundled database.
+fn copy_of_std_database(name: &str) -> PathBuf {
+    let dir = scratch_database(name);
+    for entry in std::fs::read_dir(db_path()).expect("list the database") {
+        let path = entry.expect("database entry").path();
+        let file = path.file_name().and_then(|f| f.to_str()).unwrap_or("");
+        if file.starts_with("std_") && file.ends_with(".sec2") {
+            std::fs::copy(&path, dir.join(file)).expect("copy sector");
+        }
+    }
+    dir
+}
+
+#[test]
+fn verifier_finds_corrupted_values_only() {
+    let _guard = oracle_lock();
+    let no_issue = VerifyIssue {
+        w: 0,
+        b: 0,
+        wf: 0,
+        bf: 0,
+        kind: 0,
+        index: 0,
+        white_bits: 0,
+        black_bits: 0,
+        message: [0; 96],
+    };
+    let mut issues = [no_issue; 8];
+
+    assert!(init_std(Path::new(db_path())));
+    let mut report = VerifyReport::default();
+    let found =
+        unsafe { pd_verify_database(0, 1, &mut report, issues.as_mut_ptr(), issues.len() as i32) };
+    unsafe { pd_deinit() };
+    assert_eq!(found, 0, "issues in the bundled database");
+    assert_eq!(report.mismatches, 0);
+    assert!(report.positions_checked > 0);
+
+    // 100 records in the middle of std_2_2_7_7 zeroed: the file is still
+    // well-formed, but its values no longer follow from the successors.
+    let dir = copy_of_std_database("verify");
+    let sector = dir.join("std_2_2_7_7.sec2");
+    let mut raw = std::fs::read(&sector).expect("read sector");
+    let middle = raw.len() / 2;
+    raw[middle..middle + 300].fill(0);
+    std::fs::write(&sector, raw).expect("write sector");
+
+    assert!(init_std(&dir));
+    let mut report = VerifyReport::default();
+    let found = unsafe {
+        pd_verify_sector(
+            2,
+            2,
+            7,
+            7,
+            0,
+            1,
+            &mut report,
+            issues.as_mut_ptr(),
+            issues.len() as i32,
+        )
+    };
+    unsafe { pd_deinit() };
+    let _ = std::fs::remove_dir_all(&dir);
+    assert!(found > 0);
+    assert!(report.mismatches > 0);
+    let issue = &issues[0];
+    assert_eq!(
+        (issue.w, issue.b, issue.wf, issue.bf, issue.kind),
+        (2, 2, 7, 7, 4)
+    );
+    assert!(issue.index >= 0);
+}
+
+#[test]
+fn principal_variation_evaluations_chain() {
+    let _guard = oracle_lock();
+    assert!(init_std(Path::new(db_path())));
+
+    let mut seed = 0x2545_f491_4f6c_dd1du64;
+    let mut next = move |n: u64| {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        (seed % n) as i32
+    };
+    let (mut decisive, mut removals) = (0, 0);
+    for line in 0..200 {
+        // Three white and three or four black stones, none left to place.
+        let (mut white, mut black) = (0i32, 0i32);
+        while white.count_ones() < 3 {
+            white |= 1 << next(24);
+        }
+        while black.count_ones() < 3 + line % 2 {
+            black |= (1 << next(24)) & !white;
+        }
+        let query = Query {
+            kind: 0,
+            white_bits: white,
+            black_bits: black,
+            white_stones_to_place: 0,
+            black_stones_to_place: 0,
+            player_to_move: next(2),
+            only_stone_taking: 0,
+        };
+        let mut moves = [[0 as c_char; 16]; 80];
+        let mut evals = [PvEval::default(); 80];
+        let n =
+            unsafe { pd_principal_variation(&query, 80, moves.as_mut_ptr(), evals.as_mut_ptr()) };
+        if n <= 0 || evals[0].wdl == 0 {
+            continue;
+        }
+        decisive += 1;
+
+        // Every ply brings the result one step closer, for the other side.
+        let n = n as usize;
+        for i in 1..n {
+            let expected = PvEval {
+                wdl: -evals[i - 1].wdl,
+                steps: evals[i - 1].steps - 1,
+            };
+            assert_eq!(evals[i], expected, "ply {i} of line {line}");
+            if moves[i - 1].contains(&(b'x' as c_char)) {
+                removals += 1;
+            }
+        }
+        assert_eq!(evals[n - 1].steps, 1, "line {line} ends with the win");
+    }
+    unsafe { pd_deinit() };
+
+    assert!(decisive > 0);
+    assert!(removals > 0, "no removal inside a line");
+}
+
+// The entries of std_2_2_7_7 that are not redirects, in index order.
+fn stored_boards() -> Vec<(i32, i32)> {
+    let handle = unsafe { pd_open_sector(2, 2, 7, 7) };
+    assert!(handle > 0, "pd_open_sector failed");
+    let mut out = Vec::new();
+    let (mut white, mut black, mut wdl, mut steps) = (0, 0, 0, 0);
+    while unsafe { pd_sector_next(handle, &mut white, &mut black, &mut wdl, &mut steps) } != 0 {
+        out.push((white, black));
+    }
+    unsafe { pd_close_sector(handle) };
+    out
+}
+
+fn canonical(boards: &[(i32, i32)]) -> Vec<Canonical> {
+    let queries: Vec<Query> = boards
+        .iter()
+        .map(|&(white, black)| Query {
+            kind: 0,
+            white_bits: white,
+            black_bits: black,
+            white_stones_to_place: 7,
+            black_stones_to_place: 7,
+            player_to_move: 0,
+            only_stone_taking: 0,
+        })
+        .collect();
+    let mut out = vec![Canonical::default(); queries.len()];
+    let n = unsafe { pd_canonical_index(queries.as_ptr(), queries.len() as i32, out.as_mut_ptr()) };
+    assert_eq!(n, queries.len() as i32);
+    out
+}
+
+#[test]
+fn canonical_index_of_symmetric_images() {
+    let _guard = oracle_lock();
+    let mut by_mode = Vec::new();
+    for mode in [0, 1] {
+        assert_eq!(unsafe { pd_set_hash_index_mode(mode) }, 1);
+        assert!(init_std(Path::new(db_path())));
+        let stored = stored_boards();
+        let own = canonical(&stored);
+        let all_images: Vec<(i32, i32)> = stored
+            .iter()
+            .flat_map(|&(white, black)| images(white).into_iter().zip(images(black)))
+            .collect();
+        let of_images = canonical(&all_images);
+        unsafe { pd_deinit() };
+
+        // A stored board is its own entry, and its images are redirected to it.
+        assert!(!stored.is_empty());
+        let mut last = -1;
+        for (i, c) in own.iter().enumerate() {
+            assert_eq!((c.w, c.b, c.wf, c.bf), (2, 2, 7, 7), "entry {i}");
+            // Any symmetry that keeps the board may be reported for it.
+            let (white, black) = stored[i];
+            let fixed = images(white)
+                .into_iter()
+                .zip(images(black))
+                .filter(|&image| image == (white, black))
+                .count();
+            assert!(c.op == 15 || fixed > 1, "entry {i} moved by op {}", c.op);
+            assert!(c.index > last, "entry {i} out of index order");
+            last = c.index;
+            for (k, image) in of_images[16 * i..16 * (i + 1)].iter().enumerate() {
+                assert_eq!(
+                    (image.w, image.b, image.wf, image.bf, image.index),
+                    (c.w, c.b, c.wf, c.bf, c.index),
+                    "image {k} of entry {i}, mode {mode}"
+                );
+            }
+        }
+        by_mode.push((own, of_images));
+    }
+    unsafe { pd_set_hash_index_mode(0) };
+    assert!(by_mode[0] == by_mode[1], "the index modes disagree");
+}
@@ -25,6 +25,9 @@ const CMD_DATA_QUERY: CommandId = CommandId::new("data-query");
 const CMD_H2H_ANALYZE: CommandId = CommandId::new("h2h-analyze");
 const CMD_H2H_BASELINE: CommandId = CommandId::new("h2h-baseline");
 const CMD_MIF_INTEROP: CommandId = CommandId::new("mif-interop");
+const CMD_DB_COMPRESS: CommandId = CommandId::new("db-compress");
+const CMD_DB_WDL: CommandId = CommandId::new("db-wdl");
+const CMD_DB_SECVAL: CommandId = CommandId::new("db-secval");
 
 const MILL_COMMANDS: &[CommandSpec] = &[
     CommandSpec {
@@ -135,6 +138,24 @@ const MILL_COMMANDS: &[CommandSpec] = &[
         aliases: &[],
         description: "run the independent MIF-INTEROP/1 adapter loop",
     },
+    CommandSpec {
+        id: CMD_DB_COMPRESS,
+        name: "db-compress",
+        aliases: &[],
+        description: "convert Perfect DB sectors to seekable block-compressed .sec2z files",
+    },
+    CommandSpec {
+        id: CMD_DB_WDL,
+        name: "db-wdl",
+        aliases: &[],
+        description: "generate 2-bit win/draw/loss planes (.wdl2) for Perfect DB sectors",
+    },
+    CommandSpec {
+        id: CMD_DB_SECVAL,
+        name: "db-secval",
+        aliases: &[],
+        description: "write binary sector value sidecars (.secvalb) for Perfect DB variants",
+    },
 ];
 
 impl CliGame for MillCli {
@@ -175,6 +196,9 @@ impl CliGame for MillCli {
             CMD_DATA_QUERY => crate::mill_data_query::run(args),
             CMD_H2H_ANALYZE => crate::mill_h2h_analyze::run_h2h_analyze(args),
             CMD_H2H_BASELINE => crate::mill_h2h_analyze::run_h2h_baseline(args),
+            CMD_DB_COMPRESS => crate::mill_db_tools::run_compress(args),
+            CMD_DB_WDL => crate::mill_db_tools::run_wdl(args),
+            CMD_DB_SECVAL => crate::mill_db_tools::run_secval(args),
             CMD_MIF_INTEROP => {
                 warn_unused_args("mif-interop", args);
                 crate::mill_mif_interop::run();
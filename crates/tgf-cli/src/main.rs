@@ -12,6 +12,7 @@ mod games;
 mod human_db_fen;
 mod mill_arena;
 mod mill_data_query;
+mod mill_db_tools;
 mod mill_endgame;
 mod mill_h2h_analyze;
 mod mill_mif_interop;
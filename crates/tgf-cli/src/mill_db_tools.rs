@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//! Offline conversions of Perfect Database directories.
+//!
+//! `db-compress` rewrites every `.sec2` sector of a database directory into
+//! the seekable block-compressed `.sec2z` container
+//! ([`perfect_db::file_format::compress_sector`]). The C++ oracle opens a
+//! `.sec2z` transparently when the matching `.sec2` is absent, so a converted
+//! directory only needs the `.secval` file and the `.sec2z` sectors.
+//!
+//! `db-wdl` derives the 2-bit win/draw/loss plane
+//! ([`perfect_db::wdl_plane::WdlPlane`]) of every available sector. Placed
+//! next to the sectors, the `.wdl2` files let the oracle's `pd_evaluate_wdl`
+//! answer without reading the sector files.
+//!
+//! `db-secval` writes the binary `.secvalb` sidecar
+//! ([`perfect_db::file_format::SecValTable::to_binary`]) next to every
+//! `.secval` file, which the oracle loads with a single read at init.
+
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::time::Instant;
+
+use perfect_db::database::{FileDatabaseProvider, SupportedPerfectVariants};
+use perfect_db::file_format::{
+    BlockCompressedSector, DEFAULT_BLOCK_SIZE, SecValTable, compress_sector,
+};
+use perfect_db::wdl_plane::WdlPlaneCache;
+
+use crate::cli_args::{flag_present, parse_flag, parse_flag_strict};
+
+pub(crate) fn run_compress(args: &[String]) {
+    if let Err(error) = run_compress_inner(args) {
+        eprintln!("[db-compress] ERROR: {error}");
+        std::process::exit(1);
+    }
+}
+
+fn run_compress_inner(args: &[String]) -> Result<(), String> {
+    let db = parse_flag(args, "--db", String::new());
+    if db.is_empty() {
+        return Err("--db DIR is required; example: \
+                    tgf mill db-compress --db databases/std --out databases/std-z"
+            .to_owned());
+    }
+    let db = PathBuf::from(db);
+    let out = PathBuf::from(parse_flag(args, "--out", db.display().to_string()));
+    let variant = parse_flag(args, "--variant", String::new());
+    let block_size = parse_flag_strict(args, "--block-size", DEFAULT_BLOCK_SIZE)?;
+    let level = parse_flag_strict(args, "--zstd-level", 12_i32)?;
+    let verify = flag_present(args, "--verify");
+    if block_size == 0 {
+        return Err("--block-size must be positive".to_owned());
+    }
+
+    fs::create_dir_all(&out).map_err(|e| format!("cannot create {}: {e}", out.display()))?;
+    let sectors = sector_files(&db, &variant)?;
+    if sectors.is_empty() {
+        return Err(format!("no .sec2 files found in {}", db.display()));
+    }
+
+    let started = Instant::now();
+    let (mut raw_total, mut packed_total) = (0_u64, 0_u64);
+    for path in &sectors {
+        let name = path
+            .file_name()
+            .and_then(|n| n.to_str())
+            .expect("utf-8 name");
+        let raw = fs::read(path).map_err(|e| format!("cannot read {}: {e}", path.display()))?;
+        let packed = compress_sector(&raw, block_size, level)
+            .map_err(|e| format!("cannot compress {name}: {e}"))?;
+        if verify {
+            let restored = BlockCompressedSector::parse(&packed)
+                .and_then(|sector| sector.decompress_all())
+                .map_err(|e| format!("{name}: round trip failed: {e}"))?;
+            if restored != raw {
+                return Err(format!("{name}: round trip changed the sector bytes"));
+            }
+        }
+        let target = out.join(format!("{name}z"));
+        fs::write(&target, &packed)
+            .map_err(|e| format!("cannot write {}: {e}", target.display()))?;
+        raw_total += raw.len() as u64;
+        packed_total += packed.len() as u64;
+        eprintln!(
+            "[db-compress] {name}: {} -> {} bytes ({:.1}%)",
+            raw.len(),
+            packed.len(),
+            percent(packed.len() as u64, raw.len() as u64)
+        );
+    }
+
+    // The sector values are needed next to the sectors and are tiny.
+    if out != db {
+        for entry in fs::read_dir(&db).map_err(|e| format!("cannot list {}: {e}", db.display()))? {
+            let path = entry.map_err(|e| e.to_string())?.path();
+            if path
+                .extension()
+                .is_some_and(|ext| ext == "secval" || ext == "secvalb")
+            {
+                let target = out.join(path.file_name().expect("file name"));
+                fs::copy(&path, &target)
+                    .map_err(|e| format!("cannot copy {}: {e}", path.display()))?;
+            }
+        }
+    }
+
+    println!(
+        "{{\"sectors\":{},\"raw_bytes\":{raw_total},\"compressed_bytes\":{packed_total},\
+         \"ratio\":{:.4},\"block_size\":{block_size},\"zstd_level\":{level},\"seconds\":{:.3}}}",
+        sectors.len(),
+        packed_total as f64 / raw_total.max(1) as f64,
+        started.elapsed().as_secs_f64()
+    );
+    Ok(())
+}
+
+pub(crate) fn run_wdl(args: &[String]) {
+    if let Err(error) = run_wdl_inner(args) {
+        eprintln!("[db-wdl] ERROR: {error}");
+        std::process::exit(1);
+    }
+}
+
+fn run_wdl_inner(args: &[String]) -> Result<(), String> {
+    let db = parse_flag(args, "--db", String::new());
+    if db.is_empty() {
+        return Err("--db DIR is required; example: \
+                    tgf mill db-wdl --db databases/std"
+            .to_owned());
+    }
+    let db = PathBuf::from(db);
+    let out = PathBuf::from(parse_flag(args, "--out", db.display().to_string()));
+    let only_variant = parse_flag(args, "--variant", String::new());
+    let force = flag_present(args, "--force");
+
+    fs::create_dir_all(&out).map_err(|e| format!("cannot create {}: {e}", out.display()))?;
+    let provider = FileDatabaseProvider::new(&db);
+    let variants = SupportedPerfectVariants::from_provider(&provider).map_err(|e| e.to_string())?;
+
+    let started = Instant::now();
+    let (mut written, mut skipped, mut positions, mut plane_bytes) =
+        (0_usize, 0_usize, 0_u64, 0_u64);
+    for supported in variants.iter() {
+        if !only_variant.is_empty() && supported.variant.name != only_variant {
+            continue;
+        }
+        let mut planes = WdlPlaneCache::new(FileDatabaseProvider::new(&db), supported.variant)
+            .map_err(|e| e.to_string())?;
+        for &id in &supported.available_sector_ids {
+            let target = out.join(planes.plane_file_name(id));
+            if !force && target.exists() {
+                skipped += 1;
+                continue;
+            }
+            let plane = planes.build_plane(id).map_err(|e| e.to_string())?;
+            let bytes = plane.to_bytes();
+            fs::write(&target, &bytes)
+                .map_err(|e| format!("cannot write {}: {e}", target.display()))?;
+            written += 1;
+            positions += plane.hash_count() as u64;
+            plane_bytes += bytes.len() as u64;
+        }
+    }
+    if written + skipped == 0 {
+        return Err(format!("no Perfect DB sectors found in {}", db.display()));
+    }
+
+    println!(
+        "{{\"written\":{written},\"skipped\":{skipped},\"positions\":{positions},\
+         \"plane_bytes\":{plane_bytes},\"seconds\":{:.3}}}",
+        started.elapsed().as_secs_f64()
+    );
+    Ok(())
+}
+
+pub(crate) fn run_secval(args: &[String]) {
+    if let Err(error) = run_secval_inner(args) {
+        eprintln!("[db-secval] ERROR: {error}");
+        std::process::exit(1);
+    }
+}
+
+fn run_secval_inner(args: &[String]) -> Result<(), String> {
+    let db = parse_flag(args, "--db", String::new());
+    if db.is_empty() {
+        return Err("--db DIR is required; example: \
+                    tgf mill db-secval --db databases/std"
+            .to_owned());
+    }
+    let db = PathBuf::from(db);
+    let out = PathBuf::from(parse_flag(args, "--out", db.display().to_string()));
+    fs::create_dir_all(&out).map_err(|e| format!("cannot create {}: {e}", out.display()))?;
+
+    let mut written = 0_usize;
+    for entry in fs::read_dir(&db).map_err(|e| format!("cannot list {}: {e}", db.display()))? {
+        let path = entry.map_err(|e| e.to_string())?.path();
+        if !path.extension().is_some_and(|ext| ext == "secval") {
+            continue;
+        }
+        let name = path
+            .file_name()
+            .and_then(|n| n.to_str())
+            .expect("utf-8 name");
+        let text = fs::read_to_string(&path)
+            .map_err(|e| format!("cannot read {}: {e}", path.display()))?;
+        let table = SecValTable::parse(&text).map_err(|e| format!("{name}: {e}"))?;
+        let target = out.join(format!("{name}b"));
+        fs::write(&target, table.to_binary())
+            .map_err(|e| format!("cannot write {}: {e}", target.display()))?;
+        eprintln!("[db-secval] {name}: {} sectors", table.len());
+        written += 1;
+    }
+    if written == 0 {
+        return Err(format!("no .secval files found in {}", db.display()));
+    }
+    println!("{{\"written\":{written}}}");
+    Ok(())
+}
+
+fn sector_files(db: &Path, variant: &str) -> Result<Vec<PathBuf>, String> {
+    let prefix = if variant.is_empty() {
+        String::new()
+    } else {
+        format!("{variant}_")
+    };
+    let mut files = Vec::new();
+    for entry in fs::read_dir(db).map_err(|e| format!("cannot list {}: {e}", db.display()))? {
+        let path = entry.map_err(|e| e.to_string())?.path();
+        let Some(name) = path.file_name().and_then(|n| n.to_str()) else {
+            continue;
+        };
+        if name.ends_with(".sec2") && name.starts_with(&prefix) {
+            files.push(path);
+        }
+    }
+    files.sort();
+    Ok(files)
+}
+
+fn percent(part: u64, whole: u64) -> f64 {
+    100.0 * part as f64 / whole.max(1) as f64
+}